@@ -0,0 +1,363 @@
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include "hf_csv.h"
+
+//usage:
+//  hf_csv_bench [size_in_bytes]                     runs every workload, printing one csv line per measurement
+//  hf_csv_bench --generate <workload> <lf|crlf> <size_in_bytes> <file>   only writes the generated input to file
+
+#define HF_CSV_BENCH_DEFAULT_SIZE (32u << 20)
+#define HF_CSV_BENCH_REPEATS 3
+#define HF_CSV_BENCH_LOOKUPS 16
+#define HF_CSV_BENCH_THREADS 4
+
+//allocation counting replaces the C library allocator, only available with glibc
+#if defined(__GLIBC__)
+#define HF_CSV_BENCH_COUNT_ALLOCATIONS
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t count, size_t size);
+extern void* __libc_realloc(void* block, size_t size);
+extern void __libc_free(void* block);
+
+static size_t hf_csv_bench_allocations = 0;
+
+void* malloc(size_t size) {
+    __atomic_fetch_add(&hf_csv_bench_allocations, 1, __ATOMIC_RELAXED);
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+    __atomic_fetch_add(&hf_csv_bench_allocations, 1, __ATOMIC_RELAXED);
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* block, size_t size) {
+    __atomic_fetch_add(&hf_csv_bench_allocations, 1, __ATOMIC_RELAXED);
+    return __libc_realloc(block, size);
+}
+
+void free(void* block) {
+    __libc_free(block);
+}
+#endif
+
+static long long hf_csv_bench_allocation_count(void) {
+#if defined(HF_CSV_BENCH_COUNT_ALLOCATIONS)
+    return (long long)__atomic_load_n(&hf_csv_bench_allocations, __ATOMIC_RELAXED);
+#else
+    return -1;
+#endif
+}
+
+static double hf_csv_bench_now(void) {
+#if defined(_WIN32)
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (double)time.tv_sec + (double)time.tv_nsec * 1e-9;
+#endif
+}
+
+//xorshift, so generated inputs are the same on every platform and version
+static uint64_t hf_csv_bench_random(uint64_t* state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+typedef struct {
+    char* data;
+    size_t size;
+    size_t capacity;
+} HF_CSV_bench_buffer;
+
+static void hf_csv_bench_append(HF_CSV_bench_buffer* buffer, const char* data, size_t size) {
+    if(buffer->size + size + 1 > buffer->capacity) {
+        buffer->capacity = (buffer->size + size + 1) * 2;
+        buffer->data = (char*)realloc(buffer->data, buffer->capacity);
+        if(!buffer->data) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+    }
+    memcpy(buffer->data + buffer->size, data, size);
+    buffer->size += size;
+    buffer->data[buffer->size] = '\0';
+}
+
+static void hf_csv_bench_append_string(HF_CSV_bench_buffer* buffer, const char* string) {
+    hf_csv_bench_append(buffer, string, strlen(string));
+}
+
+static const char* hf_csv_bench_words[] = {
+    "alpha", "bravo", "charlie", "delta", "echo", "foxtrot", "golf", "hotel",
+    "india", "juliett", "kilo", "lima", "mike", "november", "oscar", "papa",
+};
+#define HF_CSV_BENCH_WORD_COUNT (sizeof(hf_csv_bench_words) / sizeof(hf_csv_bench_words[0]))
+
+typedef enum {
+    HF_CSV_BENCH_WIDE_NUMERIC,
+    HF_CSV_BENCH_NARROW_TEXT,
+    HF_CSV_BENCH_QUOTE_HEAVY,
+    HF_CSV_BENCH_MULTILINE,
+    HF_CSV_BENCH_WORKLOAD_COUNT,
+} HF_CSV_bench_workload;
+
+static const char* hf_csv_bench_workload_names[HF_CSV_BENCH_WORKLOAD_COUNT] = {
+    "wide_numeric", "narrow_text", "quote_heavy", "multiline",
+};
+
+//appends one value of workload. Values of column 0 are unique keys, so lookups have a single match
+static void hf_csv_bench_append_value(HF_CSV_bench_buffer* buffer, HF_CSV_bench_workload workload, uint64_t* state, size_t row, size_t column) {
+    char value[64];
+    const char* word = hf_csv_bench_words[hf_csv_bench_random(state) % HF_CSV_BENCH_WORD_COUNT];
+    if(column == 0) {
+        snprintf(value, sizeof(value), "key%zu", row);
+        hf_csv_bench_append_string(buffer, value);
+        return;
+    }
+
+    switch(workload) {
+    case HF_CSV_BENCH_WIDE_NUMERIC:
+        if(column % 2) {
+            snprintf(value, sizeof(value), "%u", (unsigned)(hf_csv_bench_random(state) % 1000000u));
+        }
+        else {
+            snprintf(value, sizeof(value), "%u.%02u", (unsigned)(hf_csv_bench_random(state) % 10000u), (unsigned)(hf_csv_bench_random(state) % 100u));
+        }
+        hf_csv_bench_append_string(buffer, value);
+        break;
+    case HF_CSV_BENCH_NARROW_TEXT:
+        snprintf(value, sizeof(value), "%s %s", word, hf_csv_bench_words[hf_csv_bench_random(state) % HF_CSV_BENCH_WORD_COUNT]);
+        hf_csv_bench_append_string(buffer, value);
+        break;
+    case HF_CSV_BENCH_QUOTE_HEAVY:
+        snprintf(value, sizeof(value), "\"%s, \"\"%s\"\"\"", word, hf_csv_bench_words[hf_csv_bench_random(state) % HF_CSV_BENCH_WORD_COUNT]);
+        hf_csv_bench_append_string(buffer, value);
+        break;
+    case HF_CSV_BENCH_MULTILINE:
+        if(column == 2) {
+            snprintf(value, sizeof(value), "\"%s\n%s\nend\"", word, hf_csv_bench_words[hf_csv_bench_random(state) % HF_CSV_BENCH_WORD_COUNT]);
+        }
+        else {
+            snprintf(value, sizeof(value), "%s", word);
+        }
+        hf_csv_bench_append_string(buffer, value);
+        break;
+    default:
+        break;
+    }
+}
+
+//generates about size bytes of workload, ending every row with a line break
+static HF_CSV_bench_buffer hf_csv_bench_generate(HF_CSV_bench_workload workload, bool crlf, size_t size) {
+    static const size_t column_counts[HF_CSV_BENCH_WORKLOAD_COUNT] = { 50, 4, 6, 5 };
+    size_t columns = column_counts[workload];
+    uint64_t state = 0x9E3779B97F4A7C15ull ^ (uint64_t)workload;
+
+    HF_CSV_bench_buffer buffer = { NULL, 0, 0 };
+    hf_csv_bench_append(&buffer, "", 0);
+    for(size_t row = 0; buffer.size < size; row++) {
+        for(size_t column = 0; column < columns; column++) {
+            if(column > 0) {
+                hf_csv_bench_append(&buffer, ",", 1);
+            }
+            hf_csv_bench_append_value(&buffer, workload, &state, row, column);
+        }
+        hf_csv_bench_append_string(&buffer, crlf ? "\r\n" : "\n");
+    }
+    return buffer;
+}
+
+static bool hf_csv_bench_write_file(const char* filename, const HF_CSV_bench_buffer* buffer) {
+    FILE* file = fopen(filename, "wb");
+    if(!file) {
+        return false;
+    }
+    bool success = fwrite(buffer->data, 1, buffer->size, file) == buffer->size;
+    return fclose(file) == 0 && success;
+}
+
+//throughput is left empty for operations that don't go through the whole input, like a single lookup
+static void hf_csv_bench_report(const char* workload, bool crlf, const char* operation, size_t bytes, double seconds, bool throughput, long long allocations) {
+    char megabytes_per_second[32] = "";
+    if(throughput) {
+        snprintf(megabytes_per_second, sizeof(megabytes_per_second), "%.2f", seconds > 0.0 ? (double)bytes / (1024.0 * 1024.0) / seconds : 0.0);
+    }
+    printf("%s,%s,%s,%zu,%.6f,%s,%lld\n", workload, crlf ? "crlf" : "lf", operation, bytes, seconds, megabytes_per_second, allocations);
+    fflush(stdout);
+}
+
+//measures every operation on a single input, reporting the fastest of the repeats
+static int hf_csv_bench_run(HF_CSV_bench_workload workload, bool crlf, size_t size) {
+    const char* name = hf_csv_bench_workload_names[workload];
+    HF_CSV_bench_buffer input = hf_csv_bench_generate(workload, crlf, size);
+    const char* filename = "./hf_csv_bench_input.csv";
+    //every failure goes through cleanup, so neither the input nor its file outlive a run
+    int result = 1;
+    HF_CSV* csv = NULL;
+    char* string = NULL;
+    char* parallel_string = NULL;
+    if(!hf_csv_bench_write_file(filename, &input)) {
+        fprintf(stderr, "could not write %s\n", filename);
+        goto cleanup;
+    }
+
+    double best[6] = { 1e30, 1e30, 1e30, 1e30, 1e30, 1e30 };
+    long long allocations[6] = { 0, 0, 0, 0, 0, 0 };
+    size_t rows = 0, columns = 0;
+    for(int repeat = 0; repeat < HF_CSV_BENCH_REPEATS; repeat++) {
+        long long allocations_before = hf_csv_bench_allocation_count();
+        double start = hf_csv_bench_now();
+        csv = hf_csv_create_from_string(input.data);
+        double seconds = hf_csv_bench_now() - start;
+        if(!csv) {
+            fprintf(stderr, "%s: hf_csv_create_from_string failed\n", name);
+            goto cleanup;
+        }
+        if(seconds < best[0]) {
+            best[0] = seconds;
+            allocations[0] = hf_csv_bench_allocation_count() - allocations_before;
+        }
+        hf_csv_destroy(csv);
+
+        allocations_before = hf_csv_bench_allocation_count();
+        start = hf_csv_bench_now();
+        csv = hf_csv_create_from_file(filename);
+        seconds = hf_csv_bench_now() - start;
+        if(!csv) {
+            fprintf(stderr, "%s: hf_csv_create_from_file failed\n", name);
+            goto cleanup;
+        }
+        if(seconds < best[1]) {
+            best[1] = seconds;
+            allocations[1] = hf_csv_bench_allocation_count() - allocations_before;
+        }
+        hf_csv_get_size(csv, &rows, &columns);
+
+        allocations_before = hf_csv_bench_allocation_count();
+        start = hf_csv_bench_now();
+        string = hf_csv_to_string(csv);
+        seconds = hf_csv_bench_now() - start;
+        if(seconds < best[2]) {
+            best[2] = seconds;
+            allocations[2] = hf_csv_bench_allocation_count() - allocations_before;
+        }
+
+        allocations_before = hf_csv_bench_allocation_count();
+        start = hf_csv_bench_now();
+        parallel_string = hf_csv_to_string_parallel(csv, HF_CSV_BENCH_THREADS);
+        seconds = hf_csv_bench_now() - start;
+        if(!string || !parallel_string || strcmp(string, parallel_string) != 0) {
+            fprintf(stderr, "%s: hf_csv_to_string_parallel output differs\n", name);
+            goto cleanup;
+        }
+        if(seconds < best[3]) {
+            best[3] = seconds;
+            allocations[3] = hf_csv_bench_allocation_count() - allocations_before;
+        }
+        hf_csv_free_string(parallel_string);
+        hf_csv_free_string(string);
+        parallel_string = NULL;
+        string = NULL;
+
+        //keys of the last rows are the worst case of a linear scan
+        char key[32];
+        allocations_before = hf_csv_bench_allocation_count();
+        start = hf_csv_bench_now();
+        for(size_t lookup = 0; lookup < HF_CSV_BENCH_LOOKUPS; lookup++) {
+            size_t found = 0;
+            snprintf(key, sizeof(key), "key%zu", rows - 1 - lookup % rows);
+            if(!hf_csv_find_row(csv, 0, key, &found)) {
+                fprintf(stderr, "%s: hf_csv_find_row failed\n", name);
+                goto cleanup;
+            }
+        }
+        seconds = (hf_csv_bench_now() - start) / HF_CSV_BENCH_LOOKUPS;
+        if(seconds < best[4]) {
+            best[4] = seconds;
+            allocations[4] = (hf_csv_bench_allocation_count() - allocations_before) / HF_CSV_BENCH_LOOKUPS;
+        }
+
+        allocations_before = hf_csv_bench_allocation_count();
+        start = hf_csv_bench_now();
+        bool resized = hf_csv_resize(csv, rows + rows / 2, columns + 1) && hf_csv_resize(csv, rows, columns);
+        seconds = hf_csv_bench_now() - start;
+        if(!resized) {
+            fprintf(stderr, "%s: hf_csv_resize failed\n", name);
+            goto cleanup;
+        }
+        if(seconds < best[5]) {
+            best[5] = seconds;
+            allocations[5] = hf_csv_bench_allocation_count() - allocations_before;
+        }
+        hf_csv_destroy(csv);
+        csv = NULL;
+    }
+
+    //find_row is timed per lookup, which reads a single column rather than the whole input
+    static const char* operations[6] = { "create_from_string", "create_from_file", "to_string", "to_string_parallel", "find_row", "resize" };
+    for(int i = 0; i < 6; i++) {
+        hf_csv_bench_report(name, crlf, operations[i], input.size, best[i], i != 4, allocations[i]);
+    }
+    result = 0;
+
+cleanup:
+    hf_csv_free_string(parallel_string);
+    hf_csv_free_string(string);
+    hf_csv_destroy(csv);
+    remove(filename);
+    free(input.data);
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    if(argc == 6 && strcmp(argv[1], "--generate") == 0) {
+        for(int workload = 0; workload < HF_CSV_BENCH_WORKLOAD_COUNT; workload++) {
+            if(strcmp(argv[2], hf_csv_bench_workload_names[workload]) == 0) {
+                HF_CSV_bench_buffer buffer = hf_csv_bench_generate((HF_CSV_bench_workload)workload, strcmp(argv[3], "crlf") == 0, (size_t)strtoull(argv[4], NULL, 10));
+                bool success = hf_csv_bench_write_file(argv[5], &buffer);
+                free(buffer.data);
+                return success ? 0 : 1;
+            }
+        }
+        fprintf(stderr, "unknown workload %s\n", argv[2]);
+        return 1;
+    }
+
+    size_t size = argc > 1 ? (size_t)strtoull(argv[1], NULL, 10) : HF_CSV_BENCH_DEFAULT_SIZE;
+    if(size == 0) {
+        fprintf(stderr, "usage: %s [size_in_bytes] | --generate <workload> <lf|crlf> <size_in_bytes> <file>\n", argv[0]);
+        return 1;
+    }
+
+    printf("workload,line_ending,operation,bytes,seconds,mb_per_s,allocations\n");
+    for(int workload = 0; workload < HF_CSV_BENCH_WORKLOAD_COUNT; workload++) {
+        for(int crlf = 0; crlf < 2; crlf++) {
+            if(hf_csv_bench_run((HF_CSV_bench_workload)workload, crlf != 0, size) != 0) {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
@@ -1,15 +1,207 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include "hf_csv.h"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <locale.h>
 #include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#if !defined(HF_CSV_NO_SIMD) && (defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86))
+#define HF_CSV__X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#include <immintrin.h>
+#elif !defined(HF_CSV_NO_SIMD) && (defined(__aarch64__) || defined(_M_ARM64))
+#define HF_CSV__NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define HF_CSV__TARGET(features) __attribute__((target(features)))
+#else
+#define HF_CSV__TARGET(features)
+#endif
+
+//functions specialized for every dialect they are called with. Dialects passed as pointers to constants are folded into immediates
+#if defined(__GNUC__) || defined(__clang__)
+#define HF_CSV__INLINE static inline __attribute__((always_inline))
+#elif defined(_MSC_VER)
+#define HF_CSV__INLINE static __forceinline
+#else
+#define HF_CSV__INLINE static inline
+#endif
+
+//hints that address will soon be read, so the cache misses of independent lookups overlap
+#if defined(__GNUC__) || defined(__clang__)
+#define HF_CSV__PREFETCH(address) __builtin_prefetch(address)
+#else
+#define HF_CSV__PREFETCH(address) ((void)(address))
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <pthread.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define HF_CSV__ARENA_BLOCK_SIZE 65536
+#define HF_CSV__WRITER_BUFFER_SIZE 65536
+#ifndef HF_CSV__READER_BUFFER_SIZE
+#define HF_CSV__READER_BUFFER_SIZE 65536
+#endif
+#ifndef HF_CSV__MIN_CHUNK_SIZE
+#define HF_CSV__MIN_CHUNK_SIZE (1 << 20)
+#endif
+#ifndef HF_CSV__MIN_CHUNK_ROWS
+#define HF_CSV__MIN_CHUNK_ROWS 16384
+#endif
+
+//a single value of the csv. value points either to an arena block, to an allocation owned by the cell, or into a file mapping
+typedef struct HF_CSV__cell_s {
+    char* value;//NULL for values that were never set
+    size_t length;
+    bool owned;
+    bool view;//value was loaded from the file mapping and points into it, NOT null-terminated, until hf_csv_get_value publishes a terminated copy
+    uint32_t code;//position plus one of value in the dictionary of its column, 0 if the column is not encoded or the value was never set
+} HF_CSV__cell;
+
+//header of a memory block owned by a csv struct. Blocks hold value arenas and cell storage, and are only released on destroy
+typedef struct HF_CSV__block_s {
+    struct HF_CSV__block_s* next;
+    size_t size;//usable bytes after the header
+} HF_CSV__block;
+
+struct HF_CSV_reader_s {
+    FILE* file;
+    char* buffer;//holds buffer_size bytes plus one for the terminator of a value ending at end of file
+    size_t buffer_size;
+    size_t start;//first byte not consumed yet
+    size_t filled;
+    bool eof;
+    bool error;
+    size_t rows_read;
+    size_t columns;
+    HF_CSV_value* values;
+    size_t values_capacity;
+};
+
+struct HF_CSV_writer_s {
+    FILE* file;
+    bool owns_file;
+    bool error;
+    HF_CSV_dialect dialect;
+    size_t rows_written;
+    size_t filled;
+    char buffer[HF_CSV__WRITER_BUFFER_SIZE];
+};
+
+//slot of an index hash table. position is the row (column index) or column (row index) of the cell plus one, 0 for empty slots
+typedef struct HF_CSV__index_entry_s {
+    uint64_t hash;
+    size_t position;
+} HF_CSV__index_entry;
+
+#define HF_CSV__INDEX_TOMBSTONE ((size_t)-1)
+
+//hash table over the values of a column, or of a row if by_row is set. Every cell has its own entry, so duplicate values share a probe sequence
+typedef struct HF_CSV__index_s {
+    struct HF_CSV__index_s* next;
+    bool by_row;
+    size_t line;
+    HF_CSV__index_entry* entries;
+    size_t capacity;//power of two
+    size_t used;//entries and tombstones
+    bool mapped;//entries point into a loaded snapshot, and are copied before csv is modified
+} HF_CSV__index;
 
 struct HF_CSV_s {
-    char*** values;
+    HF_CSV_allocator allocator;//every allocation owned by the csv goes through it
+    HF_CSV__cell** values;//row pointers, reordering or removing rows never moves cells
     size_t rows;
     size_t columns;
+    size_t row_capacity;//rows values can hold before growing
+    size_t column_capacity;//cells every row storage can hold
+    HF_CSV__block* blocks;//value arenas
+    HF_CSV__block* row_blocks;//cell storage of rows
+    HF_CSV__cell* spare_cells;//unused rows at the end of the last row block
+    size_t spare_rows;
+    HF_CSV__cell** free_rows;//storage of deleted rows, reused by new ones
+    size_t free_row_count;
+    size_t free_row_capacity;
+    size_t owned_count;//number of cells holding their own allocation
+    char* arena;//free space of the current arena block
+    size_t arena_left;
+    void* mapping;//file contents referenced by view cells, kept for the whole csv lifetime
+    size_t mapping_size;
+    struct HF_CSV__view_lock_s* view_lock;//held while hf_csv_get_value copies a view value to the arena, set along with mapping
+    HF_CSV__index* indexes;
+    struct HF_CSV__dictionary_s** dictionaries;//per column, NULL for columns not encoded
+    size_t dictionary_count;//entries of dictionaries, columns past them are not encoded
+    struct HF_CSV__typed_s* typed;
+    struct HF_CSV__lazy_s* lazy;//set while rows are only decoded on access, values is NULL then
+    const uint64_t* snapshot_offsets;//set while values are read in place from a loaded snapshot, values is NULL then
+    const char* snapshot_blob;
+    struct HF_CSV_s* source;//set for views, whose rows are cells of source until the view is modified
+    HF_CSV_dialect dialect;//used when saving
+    char* tail_filename;//file followed by hf_csv_refresh, NULL if not loaded with hf_csv_create_from_file_tail
+    uint64_t tail_offset;//bytes of the file parsed so far, always at a row start
 };
 
+typedef struct HF_CSV__lazy_s HF_CSV__lazy;
+
+//dialects with their own parser instances. Any other dialect is parsed by a generic instance reading its fields at runtime
+static const HF_CSV_dialect hf_csv__dialect_csv = {',', '\"', HF_CSV_ESCAPE_DOUBLE, '\0', false, false};
+static const HF_CSV_dialect hf_csv__dialect_tsv = {'\t', '\"', HF_CSV_ESCAPE_DOUBLE, '\0', false, false};
+static const HF_CSV_dialect hf_csv__dialect_semicolon = {';', '\"', HF_CSV_ESCAPE_DOUBLE, '\0', false, false};
+
+static bool hf_csv__dialect_valid(const HF_CSV_dialect* dialect) {
+    char delimiter = dialect->delimiter;
+    char quote = dialect->quote;
+    char comment = dialect->comment;
+    if(delimiter == '\0' || delimiter == '\n' || delimiter == '\r' || delimiter == quote || (dialect->trim && (delimiter == ' ' || delimiter == '\t'))) {
+        return false;
+    }
+    if(quote == '\n' || quote == '\r' || (dialect->trim && (quote == ' ' || quote == '\t')) || (dialect->escape == HF_CSV_ESCAPE_BACKSLASH && (quote == '\\' || delimiter == '\\'))) {
+        return false;
+    }
+    if(dialect->escape != HF_CSV_ESCAPE_DOUBLE && dialect->escape != HF_CSV_ESCAPE_BACKSLASH) {
+        return false;
+    }
+    return comment == '\0' || (comment != delimiter && comment != quote && comment != '\n' && comment != '\r');
+}
+
+//tells if dialects parse and save the same way. The header flag only matters to predicates
+static inline bool hf_csv__dialect_same_syntax(const HF_CSV_dialect* dialect, const HF_CSV_dialect* other) {
+    return dialect->delimiter == other->delimiter && dialect->quote == other->quote && dialect->escape == other->escape && dialect->comment == other->comment && dialect->trim == other->trim;
+}
+
+//comments, trimming and backslashes can't be told apart from values by the block classifier, so such dialects are parsed a byte at a time
+static inline bool hf_csv__dialect_scalar(const HF_CSV_dialect* dialect) {
+    return dialect->escape != HF_CSV_ESCAPE_DOUBLE || dialect->comment != '\0' || dialect->trim;
+}
+
+static inline bool hf_csv__is_blank(char c) {
+    return c == ' ' || c == '\t';
+}
+
+//placed in front of strings returned by hf_csv_to_string
+typedef struct HF_CSV__string_header_s {
+    HF_CSV_allocator allocator;
+    size_t size;
+} HF_CSV__string_header;
+
 static inline FILE* hf_csv__fopen(const char* filename, const char* mode) {
     FILE* file;
 #if _MSC_VER >= 1400
@@ -22,496 +214,6943 @@ static inline FILE* hf_csv__fopen(const char* filename, const char* mode) {
     return file;
 }
 
-//push a char to buffer at index, resize buffer if necessary. returns false if buffer resize failed
-static bool hf_csv__push_char_to_buffer(char value, size_t index, char** buffer_ptr, size_t* buffer_size_ptr) {
-    while(index >= *buffer_size_ptr) {
-        *buffer_size_ptr += 128;
-        char* new_memory = (char*)realloc(*buffer_ptr, *buffer_size_ptr);
-        if(!new_memory) {
-            return false;
-        }
-        *buffer_ptr = new_memory;
+static void* hf_csv__default_alloc(void* user, size_t size) {
+    (void)user;
+    return malloc(size);
+}
+
+static void* hf_csv__default_realloc(void* user, void* block, size_t old_size, size_t new_size) {
+    (void)user;
+    (void)old_size;
+    return realloc(block, new_size);
+}
+
+static void hf_csv__default_free(void* user, void* block, size_t size) {
+    (void)user;
+    (void)size;
+    free(block);
+}
+
+static const HF_CSV_allocator hf_csv__default_allocator = { hf_csv__default_alloc, hf_csv__default_realloc, hf_csv__default_free, NULL };
+
+static inline void* hf_csv__alloc(const HF_CSV_allocator* allocator, size_t size) {
+    return allocator->alloc(allocator->user, size);
+}
+
+//allocators are never asked to reallocate NULL, it becomes a plain allocation
+static inline void* hf_csv__realloc(const HF_CSV_allocator* allocator, void* block, size_t old_size, size_t new_size) {
+    if(!block) {
+        return allocator->alloc(allocator->user, new_size);
     }
+    return allocator->realloc(allocator->user, block, old_size, new_size);
+}
 
-    (*buffer_ptr)[index] = value;
-    return true;
+static inline void hf_csv__free(const HF_CSV_allocator* allocator, void* block, size_t size) {
+    if(block) {
+        allocator->free(allocator->user, block, size);
+    }
 }
 
-//given string pointer parses next value and inserts it into buffer. On success, modifies string pointer so that it points to the token that terminated the value
-static bool hf_csv__parse_value(const char** string_ptr, char** buffer_ptr, size_t* buffer_size_ptr) {
-    size_t buffer_index = 0;
-    const char* char_itr = *string_ptr;
+typedef void (*HF_CSV__task_fn)(void* context, size_t index);
 
-    bool is_quoted = *char_itr == '\"';
-    bool in_quotes = is_quoted;
-    if(is_quoted) {
-        char_itr++;
+//share of the tasks of a parallel for run by a single thread
+typedef struct HF_CSV__worker_s {
+    HF_CSV__task_fn task;
+    void* context;
+    size_t first;
+    size_t step;
+    size_t count;
+} HF_CSV__worker;
+
+static void hf_csv__run_worker(HF_CSV__worker* worker) {
+    for(size_t index = worker->first; index < worker->count; index += worker->step) {
+        worker->task(worker->context, index);
     }
+}
 
-    while(true) {
-        if(in_quotes) {//just read values, check for end of quotes
-            if(*char_itr == '\"') {
-                char peek = *(char_itr + 1);
-                if(peek == '\"') {//double quotes, push '\"'
-                    if(!hf_csv__push_char_to_buffer('\"', buffer_index++, buffer_ptr, buffer_size_ptr)) {
-                        return false;
-                    }
-                    char_itr++;
-                }
-                else {
-                    in_quotes = false;
-                }
-            }
-            else {
-                if(!hf_csv__push_char_to_buffer(*char_itr, buffer_index++, buffer_ptr, buffer_size_ptr)) {
-                    return false;
-                }
-            }
-        }
-        else {
-            if(*char_itr == '\r') {//ignore carriage since not relevant(?) for parsing
-                char_itr++;
-            }
+#ifdef _WIN32
+typedef HANDLE HF_CSV__thread;
 
-            if(*char_itr == ',' || *char_itr == '\n' || *char_itr == '\0') {//end of value, null-terminate and check for end of string
-                if(*char_itr != '\0') {
-                    char peek = *(char_itr + 1);
-                    if(peek == '\0') {
-                        char_itr++;
-                    }
-                }
+static DWORD WINAPI hf_csv__thread_main(LPVOID worker) {
+    hf_csv__run_worker((HF_CSV__worker*)worker);
+    return 0;
+}
 
-                if(!hf_csv__push_char_to_buffer('\0', buffer_index++, buffer_ptr, buffer_size_ptr)) {
-                    return false;
-                }
-                *string_ptr = char_itr;
-                return true;
-            }
+static bool hf_csv__thread_start(HF_CSV__thread* thread, HF_CSV__worker* worker) {
+    *thread = CreateThread(NULL, 0, hf_csv__thread_main, worker, 0, NULL);
+    return *thread != NULL;
+}
 
-            if(is_quoted) {//error, values found after end of quote
-                return false;
-            }
-            else if(*char_itr == '\"') {//error, quotes inside non quoted value
-                return false;
-            }
+static void hf_csv__thread_join(HF_CSV__thread thread) {
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+}
+#else
+typedef pthread_t HF_CSV__thread;
 
-            //simply push current value
-            if(!hf_csv__push_char_to_buffer(*char_itr, buffer_index++, buffer_ptr, buffer_size_ptr)) {
-                return false;
-            }
+static void* hf_csv__thread_main(void* worker) {
+    hf_csv__run_worker((HF_CSV__worker*)worker);
+    return NULL;
+}
+
+static bool hf_csv__thread_start(HF_CSV__thread* thread, HF_CSV__worker* worker) {
+    return pthread_create(thread, NULL, hf_csv__thread_main, worker) == 0;
+}
+
+static void hf_csv__thread_join(HF_CSV__thread thread) {
+    pthread_join(thread, NULL);
+}
+#endif
+
+//runs task for every index in [0, count), spread over up to threads threads including the calling one. Returns once every task finished.
+//Bookkeeping is allocated from allocator. If threads can't be started their share runs on the calling thread
+static void hf_csv__parallel_for(const HF_CSV_allocator* allocator, size_t count, size_t threads, HF_CSV__task_fn task, void* context) {
+    if(threads > count) {
+        threads = count;
+    }
+
+    size_t workers_size = (sizeof(HF_CSV__worker) + sizeof(HF_CSV__thread)) * threads;
+    HF_CSV__worker* workers = threads > 1 ? (HF_CSV__worker*)hf_csv__alloc(allocator, workers_size) : NULL;
+    if(!workers) {
+        for(size_t index = 0; index < count; index++) {
+            task(context, index);
         }
+        return;
+    }
+    HF_CSV__thread* thread_handles = (HF_CSV__thread*)(void*)(workers + threads);
 
-        char_itr++;
+    bool* started = (bool*)hf_csv__alloc(allocator, sizeof(bool) * threads);
+    if(started) {
+        memset(started, 0, sizeof(bool) * threads);
+    }
+    for(size_t i = 0; i < threads; i++) {
+        workers[i].task = task;
+        workers[i].context = context;
+        workers[i].first = i;
+        workers[i].step = threads;
+        workers[i].count = count;
+        if(i > 0 && started) {
+            started[i] = hf_csv__thread_start(&thread_handles[i], &workers[i]);
+        }
     }
+
+    for(size_t i = 0; i < threads; i++) {
+        if(!started || !started[i]) {
+            hf_csv__run_worker(&workers[i]);
+        }
+    }
+    for(size_t i = 1; i < threads && started; i++) {
+        if(started[i]) {
+            hf_csv__thread_join(thread_handles[i]);
+        }
+    }
+
+    hf_csv__free(allocator, started, sizeof(bool) * threads);
+    hf_csv__free(allocator, workers, workers_size);
 }
 
-HF_CSV* hf_csv_create_from_file(const char* filename) {
-    FILE* file = hf_csv__fopen(filename, "r");
-    if(file) {
-        size_t arr_size = 1;
-
-        //calc file character count
-        char c;
-        while((c = (char)fgetc(file)) != EOF) {
-            if(c == '\0') {//disregard null-terminator values
-                continue;
-            }
-            arr_size++;
+//synchronization of HF_CSV_shared. Pointer accesses are sequentially consistent, so a reader publishing the version it holds and
+//checking it is still the current one can't miss a writer publishing another version and looking for readers
+#ifdef _WIN32
+typedef CRITICAL_SECTION HF_CSV__mutex;
+
+static bool hf_csv__mutex_init(HF_CSV__mutex* mutex) {
+    InitializeCriticalSection(mutex);
+    return true;
+}
+
+static void hf_csv__mutex_destroy(HF_CSV__mutex* mutex) {
+    DeleteCriticalSection(mutex);
+}
+
+static void hf_csv__mutex_lock(HF_CSV__mutex* mutex) {
+    EnterCriticalSection(mutex);
+}
+
+static void hf_csv__mutex_unlock(HF_CSV__mutex* mutex) {
+    LeaveCriticalSection(mutex);
+}
+#else
+typedef pthread_mutex_t HF_CSV__mutex;
+
+static bool hf_csv__mutex_init(HF_CSV__mutex* mutex) {
+    return pthread_mutex_init(mutex, NULL) == 0;
+}
+
+static void hf_csv__mutex_destroy(HF_CSV__mutex* mutex) {
+    pthread_mutex_destroy(mutex);
+}
+
+static void hf_csv__mutex_lock(HF_CSV__mutex* mutex) {
+    pthread_mutex_lock(mutex);
+}
+
+static void hf_csv__mutex_unlock(HF_CSV__mutex* mutex) {
+    pthread_mutex_unlock(mutex);
+}
+#endif
+
+//lets the readers of a streamed load and its parser wait for each other
+#ifdef _WIN32
+typedef CONDITION_VARIABLE HF_CSV__cond;
+
+static bool hf_csv__cond_init(HF_CSV__cond* cond) {
+    InitializeConditionVariable(cond);
+    return true;
+}
+
+static void hf_csv__cond_destroy(HF_CSV__cond* cond) {
+    (void)cond;
+}
+
+static void hf_csv__cond_wait(HF_CSV__cond* cond, HF_CSV__mutex* mutex) {
+    SleepConditionVariableCS(cond, mutex, INFINITE);
+}
+
+static void hf_csv__cond_broadcast(HF_CSV__cond* cond) {
+    WakeAllConditionVariable(cond);
+}
+#else
+typedef pthread_cond_t HF_CSV__cond;
+
+static bool hf_csv__cond_init(HF_CSV__cond* cond) {
+    return pthread_cond_init(cond, NULL) == 0;
+}
+
+static void hf_csv__cond_destroy(HF_CSV__cond* cond) {
+    pthread_cond_destroy(cond);
+}
+
+static void hf_csv__cond_wait(HF_CSV__cond* cond, HF_CSV__mutex* mutex) {
+    pthread_cond_wait(cond, mutex);
+}
+
+static void hf_csv__cond_broadcast(HF_CSV__cond* cond) {
+    pthread_cond_broadcast(cond);
+}
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+static inline void* hf_csv__atomic_load(void* volatile* pointer) {
+    return InterlockedCompareExchangePointer(pointer, NULL, NULL);
+}
+
+static inline void hf_csv__atomic_store(void* volatile* pointer, void* value) {
+    InterlockedExchangePointer(pointer, value);
+}
+
+static inline bool hf_csv__atomic_replace(void* volatile* pointer, void* expected, void* value) {
+    return InterlockedCompareExchangePointer(pointer, value, expected) == expected;
+}
+
+static inline size_t hf_csv__atomic_increment(volatile size_t* counter) {
+#ifdef _WIN64
+    return (size_t)InterlockedIncrement64((volatile LONG64*)counter);
+#else
+    return (size_t)InterlockedIncrement((volatile LONG*)counter);
+#endif
+}
+#else
+static inline void* hf_csv__atomic_load(void* volatile* pointer) {
+    return __atomic_load_n(pointer, __ATOMIC_SEQ_CST);
+}
+
+static inline void hf_csv__atomic_store(void* volatile* pointer, void* value) {
+    __atomic_store_n(pointer, value, __ATOMIC_SEQ_CST);
+}
+
+static inline bool hf_csv__atomic_replace(void* volatile* pointer, void* expected, void* value) {
+    return __atomic_compare_exchange_n(pointer, &expected, value, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+static inline size_t hf_csv__atomic_increment(volatile size_t* counter) {
+    return __atomic_add_fetch(counter, 1, __ATOMIC_RELAXED);
+}
+#endif
+
+//small allocations of the pool are rounded up to a size class and kept in per class free lists
+#define HF_CSV__POOL_CLASS_SIZE 16
+#define HF_CSV__POOL_CLASS_COUNT 16
+#define HF_CSV__POOL_SLAB_SIZE 65536
+
+//header of allocations too big for a size class, so the pool can release them all on destroy
+typedef struct HF_CSV__pool_large_s {
+    struct HF_CSV__pool_large_s* prev;
+    struct HF_CSV__pool_large_s* next;
+} HF_CSV__pool_large;
+
+struct HF_CSV_pool_s {
+    void* free_lists[HF_CSV__POOL_CLASS_COUNT];//first bytes of a free chunk point to the next one
+    HF_CSV__block* slabs;
+    char* slab;//free space of the current slab
+    size_t slab_left;
+    HF_CSV__pool_large* large;
+};
+
+static inline size_t hf_csv__pool_class(size_t size) {
+    return size == 0 ? 0 : (size - 1) / HF_CSV__POOL_CLASS_SIZE;
+}
+
+static void* hf_csv__pool_alloc(void* user, size_t size) {
+    HF_CSV_pool* pool = (HF_CSV_pool*)user;
+    size_t size_class = hf_csv__pool_class(size);
+    if(size_class >= HF_CSV__POOL_CLASS_COUNT) {
+        HF_CSV__pool_large* large = (HF_CSV__pool_large*)malloc(sizeof(HF_CSV__pool_large) + size);
+        if(!large) {
+            return NULL;
+        }
+        large->prev = NULL;
+        large->next = pool->large;
+        if(pool->large) {
+            pool->large->prev = large;
         }
+        pool->large = large;
+        return large + 1;
+    }
+
+    void* chunk = pool->free_lists[size_class];
+    if(chunk) {
+        memcpy(&pool->free_lists[size_class], chunk, sizeof(void*));
+        return chunk;
+    }
 
-        //transform file into a null-terminated string
-        char* string = (char*)malloc(arr_size);
-        if(!string) {
-            fclose(file);
+    size_t chunk_size = (size_class + 1) * HF_CSV__POOL_CLASS_SIZE;
+    if(chunk_size > pool->slab_left) {
+        HF_CSV__block* slab = (HF_CSV__block*)malloc(sizeof(HF_CSV__block) + HF_CSV__POOL_SLAB_SIZE);
+        if(!slab) {
             return NULL;
         }
-        rewind(file);
-        
-        size_t curr_index = 0;
-        while((c = (char)fgetc(file)) != EOF) {
-            if(c == '\0') {//disregard null-terminator values
-                continue;
-            }
-            string[curr_index++] = c;
+        slab->next = pool->slabs;
+        slab->size = HF_CSV__POOL_SLAB_SIZE;
+        pool->slabs = slab;
+        pool->slab = (char*)(slab + 1);
+        pool->slab_left = HF_CSV__POOL_SLAB_SIZE;
+    }
+    chunk = pool->slab;
+    pool->slab += chunk_size;
+    pool->slab_left -= chunk_size;
+    return chunk;
+}
+
+static void hf_csv__pool_free(void* user, void* block, size_t size) {
+    HF_CSV_pool* pool = (HF_CSV_pool*)user;
+    size_t size_class = hf_csv__pool_class(size);
+    if(size_class >= HF_CSV__POOL_CLASS_COUNT) {
+        HF_CSV__pool_large* large = (HF_CSV__pool_large*)block - 1;
+        if(large->prev) {
+            large->prev->next = large->next;
         }
-        string[curr_index] = '\0';
-        fclose(file);
+        else {
+            pool->large = large->next;
+        }
+        if(large->next) {
+            large->next->prev = large->prev;
+        }
+        free(large);
+        return;
+    }
+
+    memcpy(block, &pool->free_lists[size_class], sizeof(void*));
+    pool->free_lists[size_class] = block;
+}
 
-        HF_CSV* new_csv = hf_csv_create_from_string(string);
-        free(string);
-        return new_csv;
+static void* hf_csv__pool_realloc(void* user, void* block, size_t old_size, size_t new_size) {
+    size_t old_class = hf_csv__pool_class(old_size);
+    size_t new_class = hf_csv__pool_class(new_size);
+    if(old_class == new_class && old_class < HF_CSV__POOL_CLASS_COUNT) {//still fits its chunk
+        return block;
     }
-    return NULL;
+
+    void* new_block = hf_csv__pool_alloc(user, new_size);
+    if(!new_block) {
+        return NULL;
+    }
+    memcpy(new_block, block, old_size < new_size ? old_size : new_size);
+    hf_csv__pool_free(user, block, old_size);
+    return new_block;
 }
 
-HF_CSV* hf_csv_create(size_t rows, size_t columns) {
-    if(rows == 0 || columns == 0) {
+HF_CSV_pool* hf_csv_pool_create(void) {
+    HF_CSV_pool* pool = (HF_CSV_pool*)malloc(sizeof(HF_CSV_pool));
+    if(!pool) {
         return NULL;
     }
+    memset(pool, 0, sizeof(HF_CSV_pool));
+    return pool;
+}
 
-    HF_CSV* new_csv = (HF_CSV*)malloc(sizeof(HF_CSV));
-    if(!new_csv) {//failed alloc
+HF_CSV_allocator hf_csv_pool_allocator(HF_CSV_pool* pool) {
+    HF_CSV_allocator allocator = { hf_csv__pool_alloc, hf_csv__pool_realloc, hf_csv__pool_free, pool };
+    return allocator;
+}
+
+void hf_csv_pool_destroy(HF_CSV_pool* pool) {
+    if(!pool) {
+        return;
+    }
+
+    HF_CSV__block* slab = pool->slabs;
+    while(slab) {
+        HF_CSV__block* next = slab->next;
+        free(slab);
+        slab = next;
+    }
+    HF_CSV__pool_large* large = pool->large;
+    while(large) {
+        HF_CSV__pool_large* next = large->next;
+        free(large);
+        large = next;
+    }
+    free(pool);
+}
+
+//allocates an empty csv using allocator, or the C library allocator if NULL
+static HF_CSV* hf_csv__alloc_csv(const HF_CSV_allocator* allocator) {
+    if(!allocator) {
+        allocator = &hf_csv__default_allocator;
+    }
+    HF_CSV* csv = (HF_CSV*)hf_csv__alloc(allocator, sizeof(HF_CSV));
+    if(!csv) {
+        return NULL;
+    }
+    memset(csv, 0, sizeof(HF_CSV));
+    csv->allocator = *allocator;
+    csv->dialect = hf_csv__dialect_csv;
+    return csv;
+}
+
+//allocates a block of given size and links it to a block list. Returns pointer to usable memory after the block header
+static void* hf_csv__alloc_block(HF_CSV* csv, HF_CSV__block** list, size_t size) {
+    HF_CSV__block* block = (HF_CSV__block*)hf_csv__alloc(&csv->allocator, sizeof(HF_CSV__block) + size);
+    if(!block) {
         return NULL;
     }
+    block->next = *list;
+    block->size = size;
+    *list = block;
+    return block + 1;
+}
 
-    new_csv->rows = rows;
-    new_csv->columns = columns;
+//moves every block of list to the front of another list
+static void hf_csv__splice_blocks(HF_CSV__block** to, HF_CSV__block* list) {
+    if(!list) {
+        return;
+    }
+    HF_CSV__block* last = list;
+    while(last->next) {
+        last = last->next;
+    }
+    last->next = *to;
+    *to = list;
+}
 
-    new_csv->values = (char***)malloc(sizeof(char**) * rows);
-    if(!new_csv->values) {
-        hf_csv_destroy(new_csv);
+static void hf_csv__free_blocks(HF_CSV* csv, HF_CSV__block* block) {
+    while(block) {
+        HF_CSV__block* next = block->next;
+        hf_csv__free(&csv->allocator, block, sizeof(HF_CSV__block) + block->size);
+        block = next;
+    }
+}
+
+//typed copy of a column, cached until a value of the column changes
+typedef struct HF_CSV__typed_s {
+    struct HF_CSV__typed_s* next;
+    size_t line;
+    size_t first_row;
+    HF_CSV_column column;
+} HF_CSV__typed;
+
+static size_t hf_csv__type_size(HF_CSV_type type) {
+    switch(type) {
+    case HF_CSV_TYPE_INT64:
+        return sizeof(int64_t);
+    case HF_CSV_TYPE_DOUBLE:
+        return sizeof(double);
+    case HF_CSV_TYPE_BOOL:
+        return sizeof(bool);
+    case HF_CSV_TYPE_DATE:
+        return sizeof(int32_t);
+    default:
+        return 0;
+    }
+}
+
+static void hf_csv__typed_free(HF_CSV* csv, HF_CSV__typed* typed) {
+    hf_csv__free(&csv->allocator, (void*)typed->column.values, hf_csv__type_size(typed->column.type) * typed->column.rows);
+    hf_csv__free(&csv->allocator, (void*)typed->column.validity, (typed->column.rows + 7) / 8);
+    hf_csv__free(&csv->allocator, typed, sizeof(HF_CSV__typed));
+}
+
+//drops typed columns cached for column, or every one of them if column is SIZE_MAX
+static void hf_csv__typed_invalidate(HF_CSV* csv, size_t column) {
+    HF_CSV__typed** link = &csv->typed;
+    while(*link) {
+        HF_CSV__typed* typed = *link;
+        if(column == SIZE_MAX || typed->line == column) {
+            *link = typed->next;
+            hf_csv__typed_free(csv, typed);
+        }
+        else {
+            link = &typed->next;
+        }
+    }
+}
+
+//reserves size bytes from the csv arena, allocating a new arena block if needed
+static char* hf_csv__arena_alloc(HF_CSV* csv, size_t size) {
+    if(size > csv->arena_left) {
+        size_t block_size = size > HF_CSV__ARENA_BLOCK_SIZE ? size : HF_CSV__ARENA_BLOCK_SIZE;
+        char* block = (char*)hf_csv__alloc_block(csv, &csv->blocks, block_size);
+        if(!block) {
+            return NULL;
+        }
+        csv->arena = block;
+        csv->arena_left = block_size;
+    }
+
+    char* memory = csv->arena;
+    csv->arena += size;
+    csv->arena_left -= size;
+    return memory;
+}
+
+static uint64_t hf_csv__hash(const char* data, size_t length) {
+    uint64_t hash = 0x9E3779B97F4A7C15ull ^ length;
+    while(length >= 8) {
+        uint64_t word;
+        memcpy(&word, data, 8);
+        hash = (hash ^ word) * 0xFF51AFD7ED558CCDull;
+        hash ^= hash >> 32;
+        data += 8;
+        length -= 8;
+    }
+    uint64_t tail = 0;
+    if(length > 0) {//empty values may have no data
+        memcpy(&tail, data, length);
+    }
+    hash = (hash ^ tail) * 0xC4CEB9FE1A85EC53ull;
+    hash ^= hash >> 29;
+    return hash;
+}
+
+//distinct values of a dictionary encoded column. Cells of the column point to these values instead of their own copies, and keep their code
+typedef struct HF_CSV__dictionary_entry_s {
+    const char* value;//null-terminated, in an arena of the csv
+    size_t length;
+    uint64_t hash;
+} HF_CSV__dictionary_entry;
+
+typedef struct HF_CSV__dictionary_s {
+    HF_CSV__dictionary_entry* entries;//entry of code c is entries[c - 1]
+    size_t count;
+    size_t capacity;
+    uint32_t* slots;//hash table of codes, 0 for empty slots. Values are never removed, so there are no tombstones
+    size_t slot_capacity;//power of two
+} HF_CSV__dictionary;
+
+static HF_CSV__dictionary* hf_csv__dictionary_create(HF_CSV* csv) {
+    HF_CSV__dictionary* dictionary = (HF_CSV__dictionary*)hf_csv__alloc(&csv->allocator, sizeof(HF_CSV__dictionary));
+    if(!dictionary) {
+        return NULL;
+    }
+    memset(dictionary, 0, sizeof(HF_CSV__dictionary));
+    dictionary->slot_capacity = 16;
+    dictionary->slots = (uint32_t*)hf_csv__alloc(&csv->allocator, sizeof(uint32_t) * dictionary->slot_capacity);
+    if(!dictionary->slots) {
+        hf_csv__free(&csv->allocator, dictionary, sizeof(HF_CSV__dictionary));
+        return NULL;
+    }
+    memset(dictionary->slots, 0, sizeof(uint32_t) * dictionary->slot_capacity);
+    return dictionary;
+}
+
+//frees the tables of dictionary, its values stay in the arenas of csv
+static void hf_csv__dictionary_free(HF_CSV* csv, HF_CSV__dictionary* dictionary) {
+    if(!dictionary) {
+        return;
+    }
+    hf_csv__free(&csv->allocator, dictionary->entries, sizeof(HF_CSV__dictionary_entry) * dictionary->capacity);
+    hf_csv__free(&csv->allocator, dictionary->slots, sizeof(uint32_t) * dictionary->slot_capacity);
+    hf_csv__free(&csv->allocator, dictionary, sizeof(HF_CSV__dictionary));
+}
+
+static inline HF_CSV__dictionary* hf_csv__dictionary_of(const HF_CSV* csv, size_t column) {
+    return column < csv->dictionary_count ? csv->dictionaries[column] : NULL;
+}
+
+//grows the dictionaries of csv to count columns, new ones not encoded
+static bool hf_csv__dictionaries_reserve(HF_CSV* csv, size_t count) {
+    if(count <= csv->dictionary_count) {
+        return true;
+    }
+    HF_CSV__dictionary** dictionaries = (HF_CSV__dictionary**)hf_csv__realloc(&csv->allocator, csv->dictionaries, sizeof(HF_CSV__dictionary*) * csv->dictionary_count, sizeof(HF_CSV__dictionary*) * count);
+    if(!dictionaries) {
+        return false;
+    }
+    memset(dictionaries + csv->dictionary_count, 0, sizeof(HF_CSV__dictionary*) * (count - csv->dictionary_count));
+    csv->dictionaries = dictionaries;
+    csv->dictionary_count = count;
+    return true;
+}
+
+//returns the code of length bytes of value, or 0 if not found. slot_ptr receives the slot where it would be inserted
+static uint32_t hf_csv__dictionary_find(const HF_CSV__dictionary* dictionary, const char* value, size_t length, uint64_t hash, size_t* slot_ptr) {
+    size_t mask = dictionary->slot_capacity - 1;
+    size_t slot = (size_t)hash & mask;
+    for(; dictionary->slots[slot] != 0; slot = (slot + 1) & mask) {
+        const HF_CSV__dictionary_entry* entry = &dictionary->entries[dictionary->slots[slot] - 1];
+        if(entry->hash == hash && entry->length == length && memcmp(entry->value, value, length) == 0) {
+            return dictionary->slots[slot];
+        }
+    }
+    *slot_ptr = slot;
+    return 0;
+}
+
+//returns the code of length bytes of value, adding it to dictionary if missing. New values are copied to the arena of csv,
+//unless in_place is set, in which case value must be null-terminated and live as long as csv. Returns 0 if allocation failed or codes ran out
+static uint32_t hf_csv__dictionary_intern(HF_CSV* csv, HF_CSV__dictionary* dictionary, const char* value, size_t length, bool in_place) {
+    uint64_t hash = hf_csv__hash(value, length);
+    size_t slot;
+    uint32_t code = hf_csv__dictionary_find(dictionary, value, length, hash, &slot);
+    if(code != 0) {
+        return code;
+    }
+    if(dictionary->count == UINT32_MAX) {
+        return 0;
+    }
+
+    if(dictionary->count == dictionary->capacity) {
+        size_t capacity = dictionary->capacity ? dictionary->capacity * 2 : 16;
+        HF_CSV__dictionary_entry* entries = (HF_CSV__dictionary_entry*)hf_csv__realloc(&csv->allocator, dictionary->entries, sizeof(HF_CSV__dictionary_entry) * dictionary->capacity, sizeof(HF_CSV__dictionary_entry) * capacity);
+        if(!entries) {
+            return 0;
+        }
+        dictionary->entries = entries;
+        dictionary->capacity = capacity;
+    }
+    if((dictionary->count + 1) * 2 > dictionary->slot_capacity) {
+        size_t slot_capacity = dictionary->slot_capacity * 2;
+        uint32_t* slots = (uint32_t*)hf_csv__alloc(&csv->allocator, sizeof(uint32_t) * slot_capacity);
+        if(!slots) {
+            return 0;
+        }
+        memset(slots, 0, sizeof(uint32_t) * slot_capacity);
+        size_t mask = slot_capacity - 1;
+        for(size_t i = 0; i < dictionary->count; i++) {
+            size_t other = (size_t)dictionary->entries[i].hash & mask;
+            while(slots[other] != 0) {
+                other = (other + 1) & mask;
+            }
+            slots[other] = (uint32_t)(i + 1);
+        }
+        hf_csv__free(&csv->allocator, dictionary->slots, sizeof(uint32_t) * dictionary->slot_capacity);
+        dictionary->slots = slots;
+        dictionary->slot_capacity = slot_capacity;
+        slot = (size_t)hash & mask;
+        while(slots[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+    }
+
+    if(!in_place) {
+        char* copy = hf_csv__arena_alloc(csv, length + 1);
+        if(!copy) {
+            return 0;
+        }
+        if(length > 0) {
+            memcpy(copy, value, length);
+        }
+        copy[length] = '\0';
+        value = copy;
+    }
+    HF_CSV__dictionary_entry* entry = &dictionary->entries[dictionary->count++];
+    entry->value = value;
+    entry->length = length;
+    entry->hash = hash;
+    dictionary->slots[slot] = (uint32_t)dictionary->count;
+    return (uint32_t)dictionary->count;
+}
+
+//points cell to the dictionary value of code, freeing the value it owned
+static void hf_csv__dictionary_assign(HF_CSV* csv, const HF_CSV__dictionary* dictionary, HF_CSV__cell* cell, uint32_t code) {
+    if(cell->owned) {
+        hf_csv__free(&csv->allocator, cell->value, cell->length + 1);
+        csv->owned_count--;
+    }
+    const HF_CSV__dictionary_entry* entry = &dictionary->entries[code - 1];
+    cell->value = (char*)entry->value;
+    cell->length = entry->length;
+    cell->owned = false;
+    cell->view = false;
+    cell->code = code;
+}
+
+//maps a whole file into memory for reading. Empty files are mapped to NULL.
+//Returns false if file does not exist or can't be mapped.
+static bool hf_csv__map_file(const char* filename, void** mapping_ptr, size_t* size_ptr) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if(file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER file_size;
+    if(!GetFileSizeEx(file, &file_size) || (unsigned long long)file_size.QuadPart > (size_t)-1) {
+        CloseHandle(file);
+        return false;
+    }
+    *size_ptr = (size_t)file_size.QuadPart;
+    *mapping_ptr = NULL;
+    if(*size_ptr == 0) {
+        CloseHandle(file);
+        return true;
+    }
+
+    //view stays valid after both handles are closed
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if(!mapping) {
+        return false;
+    }
+    *mapping_ptr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    return *mapping_ptr != NULL;
+#else
+    int file = open(filename, O_RDONLY);
+    if(file < 0) {
+        return false;
+    }
+
+    struct stat file_stat;
+    if(fstat(file, &file_stat) != 0 || !S_ISREG(file_stat.st_mode) || (unsigned long long)file_stat.st_size > (size_t)-1) {
+        close(file);
+        return false;
+    }
+    *size_ptr = (size_t)file_stat.st_size;
+    *mapping_ptr = NULL;
+    if(*size_ptr == 0) {
+        close(file);
+        return true;
+    }
+
+    void* mapping = mmap(NULL, *size_ptr, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if(mapping == MAP_FAILED) {
+        return false;
+    }
+    posix_madvise(mapping, *size_ptr, POSIX_MADV_SEQUENTIAL);
+    *mapping_ptr = mapping;
+    return true;
+#endif
+}
+
+static void hf_csv__unmap_file(void* mapping, size_t size) {
+    if(!mapping) {
+        return;
+    }
+#ifdef _WIN32
+    (void)size;
+    UnmapViewOfFile(mapping);
+#else
+    munmap(mapping, size);
+#endif
+}
+
+typedef struct HF_CSV__view_lock_s {
+    HF_CSV__mutex mutex;
+} HF_CSV__view_lock;
+
+//lets hf_csv_get_value copy view values of csv from several threads at once. Returns false if allocation failed
+static bool hf_csv__view_lock_create(HF_CSV* csv) {
+    HF_CSV__view_lock* lock = (HF_CSV__view_lock*)hf_csv__alloc(&csv->allocator, sizeof(HF_CSV__view_lock));
+    if(!lock) {
+        return false;
+    }
+    if(!hf_csv__mutex_init(&lock->mutex)) {
+        hf_csv__free(&csv->allocator, lock, sizeof(HF_CSV__view_lock));
+        return false;
+    }
+    csv->view_lock = lock;
+    return true;
+}
+
+//structural characters of a 64 byte block, one bit per byte
+typedef struct HF_CSV__block_masks_s {
+    uint64_t quotes;
+    uint64_t commas;//delimiters of the dialect
+    uint64_t newlines;
+    uint64_t carriages;
+} HF_CSV__block_masks;
+
+typedef void (*HF_CSV__classify_fn)(const char* block, char delimiter, char quote, HF_CSV__block_masks* masks);
+typedef uint64_t (*HF_CSV__prefix_xor_fn)(uint64_t bits);
+
+static inline unsigned hf_csv__ctz64(uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_ctzll(bits);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return (unsigned)index;
+#else
+    unsigned index = 0;
+    while(!(bits & 1)) {
+        bits >>= 1;
+        index++;
+    }
+    return index;
+#endif
+}
+
+static void hf_csv__classify_scalar(const char* block, char delimiter, char quote, HF_CSV__block_masks* masks) {
+    uint64_t quotes = 0, commas = 0, newlines = 0, carriages = 0;
+    for(unsigned i = 0; i < 64; i++) {
+        uint64_t bit = (uint64_t)1 << i;
+        char c = block[i];
+        quotes |= c == quote ? bit : 0;
+        commas |= c == delimiter ? bit : 0;
+        newlines |= c == '\n' ? bit : 0;
+        carriages |= c == '\r' ? bit : 0;
+    }
+    masks->quotes = quotes;
+    masks->commas = commas;
+    masks->newlines = newlines;
+    masks->carriages = carriages;
+}
+
+//bit i of result is the xor of bits 0 to i, i.e. set for positions between an opening and a closing quote
+static uint64_t hf_csv__prefix_xor_scalar(uint64_t bits) {
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+}
+
+#ifdef HF_CSV__X86
+static void hf_csv__classify_sse2(const char* block, char delimiter, char quote_char, HF_CSV__block_masks* masks) {
+    const __m128i quote = _mm_set1_epi8(quote_char);
+    const __m128i comma = _mm_set1_epi8(delimiter);
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i carriage = _mm_set1_epi8('\r');
+    uint64_t quotes = 0, commas = 0, newlines = 0, carriages = 0;
+    for(int i = 0; i < 4; i++) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(const void*)(block + i * 16));
+        quotes |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, quote)) << (i * 16);
+        commas |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, comma)) << (i * 16);
+        newlines |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline)) << (i * 16);
+        carriages |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, carriage)) << (i * 16);
+    }
+    masks->quotes = quotes;
+    masks->commas = commas;
+    masks->newlines = newlines;
+    masks->carriages = carriages;
+}
+
+HF_CSV__TARGET("avx2")
+static void hf_csv__classify_avx2(const char* block, char delimiter, char quote_char, HF_CSV__block_masks* masks) {
+    const __m256i quote = _mm256_set1_epi8(quote_char);
+    const __m256i comma = _mm256_set1_epi8(delimiter);
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i carriage = _mm256_set1_epi8('\r');
+    __m256i low = _mm256_loadu_si256((const __m256i*)(const void*)block);
+    __m256i high = _mm256_loadu_si256((const __m256i*)(const void*)(block + 32));
+    masks->quotes = (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, quote)) | (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, quote)) << 32;
+    masks->commas = (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, comma)) | (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, comma)) << 32;
+    masks->newlines = (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, newline)) | (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, newline)) << 32;
+    masks->carriages = (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, carriage)) | (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, carriage)) << 32;
+}
+
+//carry-less multiplication by all ones computes the prefix xor in a single instruction
+HF_CSV__TARGET("pclmul")
+static uint64_t hf_csv__prefix_xor_clmul(uint64_t bits) {
+    __m128i product = _mm_clmulepi64_si128(_mm_set_epi64x(0, (long long)bits), _mm_set1_epi8((char)0xFF), 0);
+    return (uint64_t)_mm_cvtsi128_si64(product);
+}
+
+//tells if the running cpu supports avx2, or pclmul if avx2 is false
+static bool hf_csv__cpu_supports(bool avx2) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_cpu_init();
+    return avx2 ? __builtin_cpu_supports("avx2") : __builtin_cpu_supports("pclmul");
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    if(!avx2) {
+        return (info[2] & (1 << 1)) != 0;
+    }
+    bool os_saves_ymm = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+    __cpuidex(info, 7, 0);
+    return os_saves_ymm && (info[1] & (1 << 5));
+#else
+    (void)avx2;
+    return false;
+#endif
+}
+#endif
+
+#ifdef HF_CSV__NEON
+static inline uint64_t hf_csv__neon_movemask(uint8x16_t b0, uint8x16_t b1, uint8x16_t b2, uint8x16_t b3) {
+    const uint8x16_t bit_mask = {0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80};
+    uint8x16_t sum0 = vpaddq_u8(vandq_u8(b0, bit_mask), vandq_u8(b1, bit_mask));
+    uint8x16_t sum1 = vpaddq_u8(vandq_u8(b2, bit_mask), vandq_u8(b3, bit_mask));
+    sum0 = vpaddq_u8(sum0, sum1);
+    sum0 = vpaddq_u8(sum0, sum0);
+    return vgetq_lane_u64(vreinterpretq_u64_u8(sum0), 0);
+}
+
+static void hf_csv__classify_neon(const char* block, char delimiter, char quote, HF_CSV__block_masks* masks) {
+    const uint8_t* bytes = (const uint8_t*)block;
+    uint8x16_t chunk0 = vld1q_u8(bytes);
+    uint8x16_t chunk1 = vld1q_u8(bytes + 16);
+    uint8x16_t chunk2 = vld1q_u8(bytes + 32);
+    uint8x16_t chunk3 = vld1q_u8(bytes + 48);
+#define HF_CSV__NEON_MASK(c) hf_csv__neon_movemask(vceqq_u8(chunk0, vdupq_n_u8(c)), vceqq_u8(chunk1, vdupq_n_u8(c)), vceqq_u8(chunk2, vdupq_n_u8(c)), vceqq_u8(chunk3, vdupq_n_u8(c)))
+    masks->quotes = HF_CSV__NEON_MASK((uint8_t)quote);
+    masks->commas = HF_CSV__NEON_MASK((uint8_t)delimiter);
+    masks->newlines = HF_CSV__NEON_MASK('\n');
+    masks->carriages = HF_CSV__NEON_MASK('\r');
+#undef HF_CSV__NEON_MASK
+}
+#endif
+
+static HF_CSV__classify_fn hf_csv__classify = NULL;
+static HF_CSV__prefix_xor_fn hf_csv__prefix_xor = NULL;
+
+//picks the best block classifier the running cpu supports. Every variant produces the same masks
+static void hf_csv__pick_classifier(void) {
+    HF_CSV__classify_fn classify = hf_csv__classify_scalar;
+    HF_CSV__prefix_xor_fn prefix_xor = hf_csv__prefix_xor_scalar;
+#if defined(HF_CSV__X86)
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+    classify = hf_csv__classify_sse2;
+#endif
+    if(hf_csv__cpu_supports(true)) {
+        classify = hf_csv__classify_avx2;
+    }
+    if(hf_csv__cpu_supports(false)) {
+        prefix_xor = hf_csv__prefix_xor_clmul;
+    }
+#elif defined(HF_CSV__NEON)
+    classify = hf_csv__classify_neon;
+#endif
+    hf_csv__prefix_xor = prefix_xor;
+    hf_csv__classify = classify;
+}
+
+#ifdef _WIN32
+static INIT_ONCE hf_csv__classifier_once = INIT_ONCE_STATIC_INIT;
+
+static BOOL CALLBACK hf_csv__pick_classifier_once(PINIT_ONCE once, PVOID parameter, PVOID* context) {
+    (void)once;
+    (void)parameter;
+    (void)context;
+    hf_csv__pick_classifier();
+    return TRUE;
+}
+#else
+static pthread_once_t hf_csv__classifier_once = PTHREAD_ONCE_INIT;
+#endif
+
+//picks the classifier exactly once, even when tables are parsed by several threads at once. Must be called before using hf_csv__classify or hf_csv__prefix_xor
+static void hf_csv__select_classifier(void) {
+#ifdef _WIN32
+    InitOnceExecuteOnce(&hf_csv__classifier_once, hf_csv__pick_classifier_once, NULL, NULL);
+#else
+    pthread_once(&hf_csv__classifier_once, hf_csv__pick_classifier);
+#endif
+}
+
+//walks the separators of a string block by block, skipping those inside quotes
+typedef struct HF_CSV__scanner_s {
+    const char* string;
+    size_t size;
+    size_t block_start;
+    uint64_t separators;//separators of current block not consumed yet
+    uint64_t dirty;//quotes and carriages of current block after the last consumed separator
+    uint64_t in_quotes;//all bits set if previous block ended inside quotes
+    bool value_dirty;//value started in a previous block has dirty positions
+    char delimiter;
+    char quote;//'\0' if values are never quoted
+} HF_CSV__scanner;
+
+static void hf_csv__scanner_load(HF_CSV__scanner* scanner) {
+    const char* block = scanner->string + scanner->block_start;
+    char padded[64];
+    if(scanner->size - scanner->block_start < 64) {
+        memset(padded, 0, sizeof(padded));
+        memcpy(padded, block, scanner->size - scanner->block_start);
+        block = padded;
+    }
+
+    HF_CSV__block_masks masks;
+    hf_csv__classify(block, scanner->delimiter, scanner->quote, &masks);
+    if(!scanner->quote) {
+        masks.quotes = 0;
+    }
+    uint64_t quoted = hf_csv__prefix_xor(masks.quotes) ^ scanner->in_quotes;
+    scanner->in_quotes = (quoted >> 63) ? ~(uint64_t)0 : 0;
+    scanner->separators = (masks.commas | masks.newlines) & ~quoted;
+    //a carriage right before a separator is simply dropped, any other carriage or quote needs the scalar parser
+    scanner->dirty = masks.quotes | (masks.carriages & ~(scanner->separators >> 1));
+}
+
+static void hf_csv__scanner_init(HF_CSV__scanner* scanner, const char* string, size_t size, const HF_CSV_dialect* dialect) {
+    hf_csv__select_classifier();
+    memset(scanner, 0, sizeof(HF_CSV__scanner));
+    scanner->string = string;
+    scanner->size = size;
+    scanner->delimiter = dialect->delimiter;
+    scanner->quote = dialect->quote;
+    if(size > 0) {
+        hf_csv__scanner_load(scanner);
+    }
+}
+
+//finds the terminator of the current value. Returns its offset, or size if value is terminated by the end of string.
+//dirty_ptr is set if the value contains quotes or carriages and can't be taken as is
+static size_t hf_csv__scanner_next(HF_CSV__scanner* scanner, bool* dirty_ptr) {
+    while(!scanner->separators) {
+        scanner->value_dirty |= scanner->dirty != 0;
+        scanner->block_start += 64;
+        if(scanner->block_start >= scanner->size) {
+            scanner->block_start = scanner->size;
+            scanner->dirty = 0;
+            *dirty_ptr = scanner->value_dirty;
+            return scanner->size;
+        }
+        hf_csv__scanner_load(scanner);
+    }
+
+    unsigned bit = hf_csv__ctz64(scanner->separators);
+    scanner->separators &= scanner->separators - 1;
+    uint64_t before = ((uint64_t)1 << bit) - 1;
+    *dirty_ptr = scanner->value_dirty || (scanner->dirty & before);
+    scanner->value_dirty = false;
+    scanner->dirty &= ~before & ~((uint64_t)1 << bit);
+    return scanner->block_start + bit;
+}
+
+//moves scanner to position, which must be a row start outside quotes. Used to resume after a malformed row, whose quotes can't be trusted
+static void hf_csv__scanner_seek(HF_CSV__scanner* scanner, size_t position) {
+    scanner->value_dirty = false;
+    if(position >= scanner->size) {
+        scanner->block_start = scanner->size;
+        scanner->separators = 0;
+        scanner->dirty = 0;
+        return;
+    }
+
+    //quote state at the block start is set so that position is outside quotes
+    scanner->block_start = position - position % 64;
+    bool in_quotes = false;
+    for(size_t i = scanner->block_start; i < position; i++) {
+        in_quotes ^= scanner->quote != '\0' && scanner->string[i] == scanner->quote;
+    }
+    scanner->in_quotes = in_quotes ? ~(uint64_t)0 : 0;
+    hf_csv__scanner_load(scanner);
+    uint64_t before = ((uint64_t)1 << (position % 64)) - 1;
+    scanner->separators &= ~before;
+    scanner->dirty &= ~before;
+}
+
+//given string pointer scans next value without copying it. On success, modifies string pointer so that it points to the token that terminated the value (or to end).
+//Returns HF_CSV__SCAN_VIEW if the value is a contiguous range of the string, saved to value_ptr and length_ptr, or HF_CSV__SCAN_ESCAPED if it has to be unescaped with hf_csv__parse_value.
+enum { HF_CSV__SCAN_ERROR, HF_CSV__SCAN_VIEW, HF_CSV__SCAN_ESCAPED };
+HF_CSV__INLINE int hf_csv__scan_value(const char** string_ptr, const char* end, const char** value_ptr, size_t* length_ptr, const HF_CSV_dialect* dialect) {
+    const char* char_itr = *string_ptr;
+    bool escaped = false;
+    if(dialect->trim) {
+        while(char_itr != end && hf_csv__is_blank(*char_itr)) {
+            char_itr++;
+        }
+    }
+    const char* value = char_itr;
+    const char* value_end = char_itr;
+
+    bool is_quoted = dialect->quote != '\0' && char_itr != end && *char_itr == dialect->quote;
+    if(is_quoted && dialect->escape == HF_CSV_ESCAPE_BACKSLASH) {
+        value = ++char_itr;
+        while(true) {
+            if(char_itr == end) {//error, quote never closed
+                return HF_CSV__SCAN_ERROR;
+            }
+            if(*char_itr == '\\') {//escaped character must be unescaped
+                if(char_itr + 1 == end) {
+                    return HF_CSV__SCAN_ERROR;
+                }
+                escaped = true;
+                char_itr += 2;
+                continue;
+            }
+            if(*char_itr == dialect->quote) {
+                value_end = char_itr++;
+                break;
+            }
+            char_itr++;
+        }
+    }
+    else if(is_quoted) {
+        value = ++char_itr;
+        while(true) {
+            const char* quote = (const char*)memchr(char_itr, dialect->quote, (size_t)(end - char_itr));
+            if(!quote) {//error, quote never closed
+                return HF_CSV__SCAN_ERROR;
+            }
+            if(quote + 1 != end && *(quote + 1) == dialect->quote) {//double quotes must be unescaped
+                escaped = true;
+                char_itr = quote + 2;
+                continue;
+            }
+            value_end = quote;
+            char_itr = quote + 1;
+            break;
+        }
+    }
+
+    bool skipped_carriage = false;
+    const char* kept_end = char_itr;//end of an unquoted value without trailing blanks
+    while(true) {
+        if(char_itr != end && *char_itr == '\r') {
+            char_itr++;
+            skipped_carriage = true;
+        }
+
+        if(char_itr == end || *char_itr == dialect->delimiter || *char_itr == '\n') {
+            if(!is_quoted) {//carriage before terminator is not part of the value
+                value_end = dialect->trim ? kept_end : (skipped_carriage ? char_itr - 1 : char_itr);
+            }
+            if(char_itr != end && char_itr + 1 == end) {
+                char_itr++;
+            }
+            break;
+        }
+
+        if(dialect->trim && hf_csv__is_blank(*char_itr)) {
+            char_itr++;
+            continue;
+        }
+        if(is_quoted || (dialect->quote != '\0' && *char_itr == dialect->quote)) {//error, values found after end of quote or quotes inside non quoted value
+            return HF_CSV__SCAN_ERROR;
+        }
+        if(skipped_carriage) {//carriage in the middle of value is dropped, so value is no longer contiguous
+            escaped = true;
+            skipped_carriage = false;
+        }
+        char_itr++;
+        kept_end = char_itr;
+    }
+
+    *string_ptr = char_itr;
+    *value_ptr = value;
+    *length_ptr = (size_t)(value_end - value);
+    return escaped ? HF_CSV__SCAN_ESCAPED : HF_CSV__SCAN_VIEW;
+}
+
+//given string pointer parses next value and writes its unescaped contents into buffer, which must hold at least as many bytes as the value takes in the string plus one.
+//On success, modifies string pointer so that it points to the token that terminated the value (or to end) and saves the value length to length_ptr
+HF_CSV__INLINE bool hf_csv__parse_value(const char** string_ptr, const char* end, char* buffer, size_t* length_ptr, const HF_CSV_dialect* dialect) {
+    size_t length = 0;
+    const char* char_itr = *string_ptr;
+    if(dialect->trim) {
+        while(char_itr != end && hf_csv__is_blank(*char_itr)) {
+            char_itr++;
+        }
+    }
+
+    bool is_quoted = dialect->quote != '\0' && char_itr != end && *char_itr == dialect->quote;
+    if(is_quoted) {//just read values, check for end of quotes
+        char_itr++;
+        while(true) {
+            if(char_itr == end) {//error, quote never closed
+                return false;
+            }
+            if(dialect->escape == HF_CSV_ESCAPE_BACKSLASH && *char_itr == '\\') {//push escaped character as is
+                if(char_itr + 1 == end) {
+                    return false;
+                }
+                buffer[length++] = *(char_itr + 1);
+                char_itr += 2;
+                continue;
+            }
+            if(*char_itr == dialect->quote) {
+                if(dialect->escape == HF_CSV_ESCAPE_DOUBLE && char_itr + 1 != end && *(char_itr + 1) == dialect->quote) {//double quotes, push '\"'
+                    buffer[length++] = dialect->quote;
+                    char_itr += 2;
+                    continue;
+                }
+                char_itr++;
+                break;
+            }
+            buffer[length++] = *char_itr++;
+        }
+    }
+
+    size_t kept = length;//length of an unquoted value without trailing blanks
+    while(true) {
+        if(char_itr != end && *char_itr == '\r') {//ignore carriage since not relevant(?) for parsing
+            char_itr++;
+        }
+
+        if(char_itr == end || *char_itr == dialect->delimiter || *char_itr == '\n') {//end of value, null-terminate and check for end of string
+            if(char_itr != end && char_itr + 1 == end) {
+                char_itr++;
+            }
+
+            if(dialect->trim && !is_quoted) {
+                length = kept;
+            }
+            buffer[length] = '\0';
+            *string_ptr = char_itr;
+            *length_ptr = length;
+            return true;
+        }
+
+        if(dialect->trim && hf_csv__is_blank(*char_itr)) {//kept only if followed by more of the value
+            if(!is_quoted) {
+                buffer[length++] = *char_itr;
+            }
+            char_itr++;
+            continue;
+        }
+        if(is_quoted) {//error, values found after end of quote
+            return false;
+        }
+        else if(dialect->quote != '\0' && *char_itr == dialect->quote) {//error, quotes inside non quoted value
+            return false;
+        }
+
+        //simply push current value
+        buffer[length++] = *char_itr++;
+        kept = length;
+    }
+}
+
+//fills cell with the value found at string_ptr, which is terminated at value_end. Clean values are taken as is, others go through the scalar parser.
+//On success, modifies string pointer so that it points to the token that terminated the value (or to end)
+HF_CSV__INLINE bool hf_csv__build_cell(HF_CSV* csv, HF_CSV__cell* cell, const char** string_ptr, const char* value_end, const char* end, bool dirty, char** arena_ptr, const HF_CSV_dialect* dialect) {
+    const char* value = *string_ptr;
+    cell->owned = false;
+    cell->view = false;
+    cell->code = 0;
+
+    if(!dirty) {
+        size_t length = (size_t)(value_end - value);
+        if(length > 0 && value[length - 1] == '\r') {
+            length--;
+        }
+        cell->length = length;
+        if(*arena_ptr) {
+            cell->value = *arena_ptr;
+            memcpy(cell->value, value, length);
+            cell->value[length] = '\0';
+            *arena_ptr += length + 1;
+        }
+        else {
+            cell->value = (char*)value;
+            cell->view = true;
+        }
+        *string_ptr = (value_end != end && value_end + 1 == end) ? end : value_end;
+        return true;
+    }
+
+    if(*arena_ptr) {
+        if(!hf_csv__parse_value(string_ptr, end, *arena_ptr, &cell->length, dialect)) {
+            return false;
+        }
+        cell->value = *arena_ptr;
+        *arena_ptr += cell->length + 1;
+        return true;
+    }
+
+    const char* value_start = *string_ptr;
+    int scan = hf_csv__scan_value(string_ptr, end, &value, &cell->length, dialect);
+    if(scan == HF_CSV__SCAN_VIEW) {
+        cell->value = (char*)value;
+        cell->view = true;
+        return true;
+    }
+    else if(scan == HF_CSV__SCAN_ESCAPED) {//only escaped values are materialized
+        cell->value = hf_csv__arena_alloc(csv, (size_t)(*string_ptr - value_start) + 1);
+        if(!cell->value) {
+            return false;
+        }
+        return hf_csv__parse_value(&value_start, end, cell->value, &cell->length, dialect);
+    }
+    return false;
+}
+
+//compares cell contents with length bytes of value, without requiring the cell to be null-terminated
+static inline bool hf_csv__cell_equals(const HF_CSV__cell* cell, const char* value, size_t length) {
+    if(!cell->value) {//uninitialized value equals empty string
+        return length == 0;
+    }
+    return cell->length == length && memcmp(cell->value, value, length) == 0;
+}
+
+//maps source columns to the columns kept by a load, see HF_CSV_load_options
+#define HF_CSV__PROJECTION_SKIP ((size_t)-1)
+#define HF_CSV__PROJECTION_HEADER ((size_t)-2)
+
+typedef struct HF_CSV__projection_s {
+    bool enabled;
+    const size_t* indices;
+    const char* const* names;
+    size_t columns;//columns kept, or every column if not enabled
+    size_t* slots;//kept position of each source column, filled while parsing the first row
+    size_t slot_count;
+    size_t slot_capacity;
+    bool* taken;//kept positions already matched to a source column
+    size_t taken_count;
+    HF_CSV_value* values;//row handed to the predicate
+    size_t value_capacity;
+    const HF_CSV_allocator* allocator;
+} HF_CSV__projection;
+
+static bool hf_csv__projection_init(HF_CSV__projection* projection, const HF_CSV_allocator* allocator, const HF_CSV_load_options* options) {
+    memset(projection, 0, sizeof(HF_CSV__projection));
+    projection->allocator = allocator;
+    if(!options || (!options->columns && !options->names)) {
+        return true;
+    }
+    if(options->column_count == 0) {
+        return false;
+    }
+
+    projection->enabled = true;
+    projection->names = options->names;
+    projection->indices = options->names ? NULL : options->columns;
+    projection->columns = options->column_count;
+    projection->taken = (bool*)hf_csv__alloc(allocator, sizeof(bool) * projection->columns);
+    if(!projection->taken) {
+        return false;
+    }
+    memset(projection->taken, 0, sizeof(bool) * projection->columns);
+    return true;
+}
+
+static void hf_csv__projection_free(HF_CSV__projection* projection) {
+    hf_csv__free(projection->allocator, projection->slots, sizeof(size_t) * projection->slot_capacity);
+    hf_csv__free(projection->allocator, projection->taken, sizeof(bool) * (projection->enabled ? projection->columns : 0));
+    hf_csv__free(projection->allocator, projection->values, sizeof(HF_CSV_value) * projection->value_capacity);
+}
+
+//returns the kept position of source column, HF_CSV__PROJECTION_SKIP if not kept, or HF_CSV__PROJECTION_HEADER if it depends on the header value
+static size_t hf_csv__projection_slot(HF_CSV__projection* projection, size_t column, bool first_row) {
+    if(!first_row) {//rows with too many columns fail once they end
+        return column < projection->slot_count ? projection->slots[column] : HF_CSV__PROJECTION_SKIP;
+    }
+
+    if(projection->slot_count == projection->slot_capacity) {
+        size_t capacity = projection->slot_capacity ? projection->slot_capacity * 2 : 16;
+        size_t* slots = (size_t*)hf_csv__realloc(projection->allocator, projection->slots, sizeof(size_t) * projection->slot_capacity, sizeof(size_t) * capacity);
+        if(!slots) {//column is skipped, so the projection can't be completed
+            return HF_CSV__PROJECTION_SKIP;
+        }
+        projection->slots = slots;
+        projection->slot_capacity = capacity;
+    }
+
+    size_t slot = HF_CSV__PROJECTION_SKIP;
+    if(projection->names) {
+        slot = HF_CSV__PROJECTION_HEADER;
+    }
+    else {
+        for(size_t i = 0; i < projection->columns; i++) {
+            if(projection->indices[i] == column && !projection->taken[i]) {
+                projection->taken[i] = true;
+                projection->taken_count++;
+                slot = i;
+                break;
+            }
+        }
+    }
+    projection->slots[projection->slot_count++] = slot;
+    return slot;
+}
+
+//finds the kept position named as the header cell of column. Earlier header columns win over later ones with the same name
+static size_t hf_csv__projection_match(HF_CSV__projection* projection, size_t column, const HF_CSV__cell* cell) {
+    size_t slot = HF_CSV__PROJECTION_SKIP;
+    for(size_t i = 0; i < projection->columns; i++) {
+        const char* name = projection->names[i];
+        if(!projection->taken[i] && name && hf_csv__cell_equals(cell, name, strlen(name))) {
+            projection->taken[i] = true;
+            projection->taken_count++;
+            slot = i;
+            break;
+        }
+    }
+    projection->slots[column] = slot;
+    return slot;
+}
+
+static inline bool hf_csv__projection_complete(const HF_CSV__projection* projection) {
+    return projection->taken_count == projection->columns;
+}
+
+//hands the kept values of a row to the predicate. Sets failed_ptr if allocation failed
+static bool hf_csv__projection_accept(HF_CSV__projection* projection, const HF_CSV_load_options* options, size_t row, const HF_CSV__cell* cells, bool* failed_ptr) {
+    if(projection->value_capacity < projection->columns) {
+        HF_CSV_value* values = (HF_CSV_value*)hf_csv__realloc(projection->allocator, projection->values, sizeof(HF_CSV_value) * projection->value_capacity, sizeof(HF_CSV_value) * projection->columns);
+        if(!values) {
+            *failed_ptr = true;
+            return false;
+        }
+        projection->values = values;
+        projection->value_capacity = projection->columns;
+    }
+
+    for(size_t i = 0; i < projection->columns; i++) {
+        projection->values[i].value = cells[i].value ? cells[i].value : "";
+        projection->values[i].length = cells[i].value ? cells[i].length : 0;
+    }
+    return options->predicate(options->user, row, projection->values, projection->columns);
+}
+
+//errors found by a parse, lines are counted incrementally up to the last error so the input is only read again once
+typedef struct HF_CSV__report_s {
+    HF_CSV_diagnostics* diagnostics;
+    const char* string;
+    size_t line;//line at offset counted
+    size_t counted;
+} HF_CSV__report;
+
+static void hf_csv__report_init(HF_CSV__report* report, const HF_CSV_load_options* options, const char* string) {
+    report->diagnostics = options ? options->diagnostics : NULL;
+    report->string = string;
+    report->line = 1;
+    report->counted = 0;
+    if(report->diagnostics) {
+        report->diagnostics->count = 0;
+    }
+}
+
+static void hf_csv__report_error(HF_CSV__report* report, HF_CSV_error_kind kind, size_t offset, size_t row, size_t column) {
+    HF_CSV_diagnostics* diagnostics = report->diagnostics;
+    if(!diagnostics) {
+        return;
+    }
+    if(diagnostics->errors && diagnostics->count < diagnostics->capacity) {
+        if(offset < report->counted) {
+            report->line = 1;
+            report->counted = 0;
+        }
+        const char* itr = report->string + report->counted;
+        const char* end = report->string + offset;
+        while(itr != end && (itr = (const char*)memchr(itr, '\n', (size_t)(end - itr))) != NULL) {
+            report->line++;
+            itr++;
+        }
+        report->counted = offset;
+
+        HF_CSV_error* error = &diagnostics->errors[diagnostics->count];
+        error->kind = kind;
+        error->offset = offset;
+        error->line = report->line;
+        error->row = row;
+        error->column = column;
+    }
+    diagnostics->count++;
+}
+
+//reports an error that isn't tied to a position of the input, if options ask for diagnostics
+static void hf_csv__report_failure(const HF_CSV_load_options* options, HF_CSV_error_kind kind, size_t column) {
+    HF_CSV__report report;
+    hf_csv__report_init(&report, options, "");
+    hf_csv__report_error(&report, kind, 0, 0, column);
+}
+
+//finds why the value starting at value could not be parsed and where, following the rules of hf_csv__parse_value
+static HF_CSV_error_kind hf_csv__diagnose_value(const char* value, const char* end, const HF_CSV_dialect* dialect, const char** error_ptr) {
+    const char* itr = value;
+    while(dialect->trim && itr != end && hf_csv__is_blank(*itr)) {
+        itr++;
+    }
+
+    if(dialect->quote == '\0' || itr == end || *itr != dialect->quote) {
+        for(; itr != end && *itr != dialect->delimiter && *itr != '\n'; itr++) {
+            if(dialect->quote != '\0' && *itr == dialect->quote) {
+                *error_ptr = itr;
+                return HF_CSV_ERROR_UNEXPECTED_QUOTE;
+            }
+        }
+    }
+    else {
+        const char* opening = itr++;
+        while(true) {
+            if(itr == end || (dialect->escape == HF_CSV_ESCAPE_BACKSLASH && *itr == '\\' && itr + 1 == end)) {
+                *error_ptr = opening;
+                return HF_CSV_ERROR_UNCLOSED_QUOTE;
+            }
+            if(dialect->escape == HF_CSV_ESCAPE_BACKSLASH && *itr == '\\') {
+                itr += 2;
+                continue;
+            }
+            if(*itr == dialect->quote) {
+                if(dialect->escape == HF_CSV_ESCAPE_DOUBLE && itr + 1 != end && *(itr + 1) == dialect->quote) {
+                    itr += 2;
+                    continue;
+                }
+                itr++;
+                break;
+            }
+            itr++;
+        }
+
+        for(; itr != end && *itr != dialect->delimiter && *itr != '\n'; itr++) {
+            bool terminated = itr + 1 == end || *(itr + 1) == dialect->delimiter || *(itr + 1) == '\n';
+            if(!(dialect->trim && hf_csv__is_blank(*itr)) && !(*itr == '\r' && terminated)) {
+                *error_ptr = itr;
+                return HF_CSV_ERROR_TEXT_AFTER_QUOTE;
+            }
+        }
+    }
+
+    //value is fine alone, but a quote left open by a previous value made the structural index disagree with it
+    *error_ptr = value;
+    return HF_CSV_ERROR_UNEXPECTED_QUOTE;
+}
+
+//reports a value that could not be parsed. If recovering, moves string_ptr to the start of the line after the error and returns true
+static bool hf_csv__value_error(HF_CSV__report* report, const char* value, const char* end, const HF_CSV_dialect* dialect, size_t row, size_t column, bool recover, const char** string_ptr) {
+    const char* error;
+    HF_CSV_error_kind kind = hf_csv__diagnose_value(value, end, dialect, &error);
+    hf_csv__report_error(report, kind, (size_t)(error - report->string), row, column);
+    if(!recover) {
+        return false;
+    }
+
+    const char* newline = (const char*)memchr(error, '\n', (size_t)(end - error));
+    *string_ptr = newline ? newline + 1 : end;
+    return true;
+}
+
+//fills the values a short row lacks with empty ones
+static void hf_csv__pad_row(const HF_CSV__projection* projection, HF_CSV__cell* cells, size_t columns, size_t column_count) {
+    for(size_t column = columns; column < column_count; column++) {
+        size_t slot = projection->enabled ? projection->slots[column] : column;
+        if(slot != HF_CSV__PROJECTION_SKIP) {
+            memset(&cells[slot], 0, sizeof(HF_CSV__cell));
+        }
+    }
+}
+
+//creates the dictionaries of the columns options encode. Returns false if allocation failed
+static bool hf_csv__dictionaries_init(HF_CSV* csv, const HF_CSV_load_options* options) {
+    if(!options || !options->dictionary_columns) {
+        return true;
+    }
+    size_t count = 0;
+    for(size_t i = 0; i < options->dictionary_column_count; i++) {
+        if(options->dictionary_columns[i] >= count) {
+            count = options->dictionary_columns[i] + 1;
+        }
+    }
+    if(!hf_csv__dictionaries_reserve(csv, count)) {
+        return false;
+    }
+    for(size_t i = 0; i < options->dictionary_column_count; i++) {
+        size_t column = options->dictionary_columns[i];
+        if(!csv->dictionaries[column] && !(csv->dictionaries[column] = hf_csv__dictionary_create(csv))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//encodes a cell just built by the parser. A repeated value was the last one written to the parse arena, so its space is given back
+static inline bool hf_csv__encode_parsed(HF_CSV* csv, HF_CSV__dictionary* dictionary, HF_CSV__cell* cell, char** arena_ptr) {
+    char* value = cell->value;
+    uint32_t code = hf_csv__dictionary_intern(csv, dictionary, value, cell->length, !cell->view);
+    if(code == 0) {
+        return false;
+    }
+    if(*arena_ptr && dictionary->entries[code - 1].value != value && value + cell->length + 1 == *arena_ptr) {
+        *arena_ptr = value;
+    }
+    hf_csv__dictionary_assign(csv, dictionary, cell, code);
+    return true;
+}
+
+//returns a newly allocated HF_CSV struct on success, or NULL if failed to parse.
+//parses size bytes of string in a single pass. Unescaped values are written to one arena block, and the cells are indexed into one contiguous block.
+//If zero_copy is set, values that need no unescaping are referenced in place instead, so string must outlive the csv.
+//If options are given, only projected values are built, skipped ones are never unescaped nor allocated, and rows rejected by the predicate are dropped.
+HF_CSV__INLINE HF_CSV* hf_csv__parse_buffer(const HF_CSV_allocator* allocator, const char* string, size_t size, bool zero_copy, const HF_CSV_load_options* options, const HF_CSV_dialect* dialect) {
+    HF_CSV__report report;
+    hf_csv__report_init(&report, options, string);
+    HF_CSV_recovery recovery = options ? options->recovery : HF_CSV_RECOVERY_NONE;
+
+    HF_CSV* new_csv = hf_csv__alloc_csv(allocator);
+    if(!new_csv) {
+        hf_csv__report_error(&report, HF_CSV_ERROR_OUT_OF_MEMORY, 0, 0, 0);
+        return NULL;
+    }
+    allocator = &new_csv->allocator;
+
+    //values never take more space than they did in the source string, plus one terminator at the very end
+    char* arena = NULL;
+    if(!zero_copy) {
+        arena = (char*)hf_csv__alloc_block(new_csv, &new_csv->blocks, size + 1);
+        if(!arena) {
+            hf_csv__report_error(&report, HF_CSV_ERROR_OUT_OF_MEMORY, 0, 0, 0);
+            hf_csv_destroy(new_csv);
+            return NULL;
+        }
+    }
+
+    if(!hf_csv__dictionaries_init(new_csv, options)) {
+        hf_csv__report_error(&report, HF_CSV_ERROR_OUT_OF_MEMORY, 0, 0, 0);
+        hf_csv_destroy(new_csv);
+        return NULL;
+    }
+    HF_CSV__dictionary** dictionaries = new_csv->dictionaries;
+    size_t dictionary_count = new_csv->dictionary_count;
+
+    HF_CSV__projection projection;
+    if(!hf_csv__projection_init(&projection, allocator, options)) {
+        hf_csv__report_error(&report, options->column_count == 0 ? HF_CSV_ERROR_INVALID_OPTIONS : HF_CSV_ERROR_OUT_OF_MEMORY, 0, 0, 0);
+        hf_csv_destroy(new_csv);
+        return NULL;
+    }
+
+    //cells are stored contiguously, row after row. Block header is reserved in front so the storage can later be linked as a block
+    size_t cell_capacity = size / 8 + 16;
+    HF_CSV__block* cell_block = (HF_CSV__block*)hf_csv__alloc(allocator, sizeof(HF_CSV__block) + sizeof(HF_CSV__cell) * cell_capacity);
+    if(!cell_block) {
+        hf_csv__report_error(&report, HF_CSV_ERROR_OUT_OF_MEMORY, 0, 0, 0);
+        hf_csv__projection_free(&projection);
+        hf_csv_destroy(new_csv);
+        return NULL;
+    }
+    size_t cell_count = 0;
+
+    //dialects with comments, trimming or backslashes are parsed by the scalar parser alone
+    bool scalar = hf_csv__dialect_scalar(dialect);
+    HF_CSV__scanner scanner;
+    if(!scalar) {
+        hf_csv__scanner_init(&scanner, string, size, dialect);
+    }
+
+    const char* string_itr = string;
+    const char* end = string + size;
+    const char* row_itr = string;//start of current row
+    size_t column_count = 0;
+    size_t curr_column = 0;
+    size_t source_rows = 0;
+    size_t row_start = 0;
+    //cells of a projected row are written at their kept position, so the whole row must fit
+    size_t reserve = projection.enabled ? projection.columns : 1;
+    bool failed = false;
+    do {
+        if(cell_count + reserve > cell_capacity) {
+            size_t new_capacity = cell_capacity * 2 > cell_count + reserve ? cell_capacity * 2 : cell_count + reserve;
+            HF_CSV__block* new_block = (HF_CSV__block*)hf_csv__realloc(allocator, cell_block, sizeof(HF_CSV__block) + sizeof(HF_CSV__cell) * cell_capacity, sizeof(HF_CSV__block) + sizeof(HF_CSV__cell) * new_capacity);
+            if(!new_block) {
+                hf_csv__report_error(&report, HF_CSV_ERROR_OUT_OF_MEMORY, (size_t)(string_itr - string), source_rows, curr_column);
+                failed = true;
+                break;
+            }
+            cell_block = new_block;
+            cell_capacity = new_capacity;
+        }
+
+        if(scalar && curr_column == 0 && dialect->comment != '\0' && string_itr != end && *string_itr == dialect->comment) {//comment lines are skipped whole
+            const char* newline = (const char*)memchr(string_itr, '\n', (size_t)(end - string_itr));
+            if(!newline || newline + 1 == end) {
+                break;
+            }
+            string_itr = newline + 1;
+            row_itr = string_itr;
+            continue;
+        }
+
+        bool dirty = true;
+        const char* value_end = NULL;
+        if(!scalar) {
+            value_end = string + hf_csv__scanner_next(&scanner, &dirty);
+        }
+        HF_CSV__cell* cells = (HF_CSV__cell*)(cell_block + 1);
+        const char* value_itr = string_itr;
+        bool parsed;
+        HF_CSV__dictionary* dictionary = NULL;//set if the cell built belongs to an encoded column
+        HF_CSV__cell* encoded = NULL;
+        if(!projection.enabled) {
+            //the scalar parser must agree with the structural index, otherwise the string is malformed
+            parsed = hf_csv__build_cell(new_csv, cells + cell_count++, &string_itr, value_end, end, dirty, &arena, dialect) && (!value_end || string_itr == value_end || string_itr == end);
+            if(parsed && curr_column < dictionary_count && dictionaries[curr_column]) {
+                dictionary = dictionaries[curr_column];
+                encoded = cells + cell_count - 1;
+            }
+        }
+        else {
+            size_t slot = hf_csv__projection_slot(&projection, curr_column, source_rows == 0);
+            if(slot == HF_CSV__PROJECTION_SKIP && !scalar) {//only the structural index is trusted, value is neither parsed nor validated
+                string_itr = (value_end != end && value_end + 1 == end) ? end : value_end;
+                parsed = true;
+            }
+            else if(slot == HF_CSV__PROJECTION_SKIP) {//value is only scanned for its end
+                const char* value;
+                size_t length;
+                parsed = hf_csv__scan_value(&string_itr, end, &value, &length, dialect) != HF_CSV__SCAN_ERROR;
+            }
+            else {
+                HF_CSV__cell cell;
+                parsed = hf_csv__build_cell(new_csv, &cell, &string_itr, value_end, end, dirty, &arena, dialect) && (!value_end || string_itr == value_end || string_itr == end);
+                //names are matched against the header as it is parsed
+                if(parsed && slot == HF_CSV__PROJECTION_HEADER) {
+                    slot = hf_csv__projection_match(&projection, curr_column, &cell);
+                }
+                if(parsed && slot != HF_CSV__PROJECTION_SKIP) {
+                    cells[row_start + slot] = cell;
+                    if(slot < dictionary_count && dictionaries[slot]) {
+                        dictionary = dictionaries[slot];
+                        encoded = cells + row_start + slot;
+                    }
+                }
+            }
+        }
+        if(dictionary && !hf_csv__encode_parsed(new_csv, dictionary, encoded, &arena)) {
+            hf_csv__report_error(&report, HF_CSV_ERROR_OUT_OF_MEMORY, (size_t)(value_itr - string), source_rows, curr_column);
+            failed = true;
+            break;
+        }
+        if(!parsed) {//the row is dropped, and parsing resumes on the next line if recovering
+            if(!hf_csv__value_error(&report, value_itr, end, dialect, source_rows, curr_column, recovery != HF_CSV_RECOVERY_NONE && source_rows > 0, &string_itr)) {
+                failed = true;
+                break;
+            }
+            source_rows++;
+            cell_count = row_start;
+            curr_column = 0;
+            row_itr = string_itr;
+            if(!scalar) {
+                hf_csv__scanner_seek(&scanner, (size_t)(string_itr - string));
+            }
+            if(string_itr == end || (options && options->max_rows != 0 && source_rows == options->max_rows)) {
+                break;
+            }
+            continue;
+        }
+
+        curr_column++;
+        if(string_itr == end || *string_itr == '\n') {
+            bool keep = true;
+            if(source_rows == 0) {//only count columns in first row
+                column_count = curr_column;
+                if(projection.enabled && !hf_csv__projection_complete(&projection)) {//projected column not found
+                    size_t missing = 0;
+                    while(projection.taken[missing]) {
+                        missing++;
+                    }
+                    hf_csv__report_error(&report, HF_CSV_ERROR_MISSING_COLUMN, 0, 0, missing);
+                    failed = true;
+                    break;
+                }
+                if(!projection.enabled) {
+                    projection.columns = column_count;
+                }
+                if(dictionary_count > projection.columns) {//encoded column not kept
+                    hf_csv__report_error(&report, HF_CSV_ERROR_INVALID_OPTIONS, 0, 0, 0);
+                    failed = true;
+                    break;
+                }
+                if(recovery == HF_CSV_RECOVERY_PAD && !projection.enabled) {//short rows are padded in place
+                    reserve = column_count;
+                }
+            }
+            else if(curr_column != column_count) {//invalid amout of columns
+                hf_csv__report_error(&report, HF_CSV_ERROR_COLUMN_COUNT, (size_t)(row_itr - string), source_rows, curr_column);
+                if(recovery == HF_CSV_RECOVERY_NONE) {
+                    failed = true;
+                    break;
+                }
+                keep = recovery == HF_CSV_RECOVERY_PAD;
+                if(keep && curr_column < column_count) {
+                    hf_csv__pad_row(&projection, cells + row_start, curr_column, column_count);
+                }
+            }
+
+            source_rows++;
+            if(keep) {
+                new_csv->rows++;
+            }
+            if(keep && options && options->predicate && !((projection.names || dialect->header) && source_rows == 1)) {
+                if(!hf_csv__projection_accept(&projection, options, source_rows - 1, cells + row_start, &failed)) {
+                    new_csv->rows--;
+                }
+                if(failed) {
+                    hf_csv__report_error(&report, HF_CSV_ERROR_OUT_OF_MEMORY, (size_t)(row_itr - string), source_rows - 1, 0);
+                    break;
+                }
+            }
+            cell_count = new_csv->rows * projection.columns;
+            row_start = cell_count;
+            curr_column = 0;
+            if(string_itr == end || (options && options->max_rows != 0 && source_rows == options->max_rows)) {
+                break;
+            }
+            row_itr = string_itr + 1;
+        }
+
+        string_itr++;
+    } while(true);
+
+    hf_csv__projection_free(&projection);
+    if(failed) {
+        hf_csv__free(allocator, cell_block, sizeof(HF_CSV__block) + sizeof(HF_CSV__cell) * cell_capacity);
+        hf_csv_destroy(new_csv);
+        return NULL;
+    }
+
+    cell_block->next = new_csv->row_blocks;
+    cell_block->size = sizeof(HF_CSV__cell) * cell_capacity;
+    new_csv->row_blocks = cell_block;
+    new_csv->columns = projection.columns;
+    new_csv->column_capacity = projection.columns;
+    new_csv->row_capacity = new_csv->rows;
+
+    //a csv always has at least one row, even if the predicate rejected all of them
+    if(new_csv->rows == 0) {
+        hf_csv__report_error(&report, HF_CSV_ERROR_NO_ROWS, size, source_rows, 0);
+        hf_csv_destroy(new_csv);
+        return NULL;
+    }
+
+    new_csv->values = (HF_CSV__cell**)hf_csv__alloc(allocator, sizeof(HF_CSV__cell*) * new_csv->rows);
+    if(!new_csv->values) {
+        hf_csv__report_error(&report, HF_CSV_ERROR_OUT_OF_MEMORY, size, source_rows, 0);
+        new_csv->rows = 0;
+        new_csv->row_capacity = 0;
+        hf_csv_destroy(new_csv);
+        return NULL;
+    }
+    HF_CSV__cell* cells = (HF_CSV__cell*)(cell_block + 1);
+    for(size_t row = 0; row < new_csv->rows; row++) {
+        new_csv->values[row] = cells + row * new_csv->columns;
+    }
+
+    return new_csv;
+}
+
+//parses string with the dialect of options, plain csv if none. Common dialects get their own copy of the parser, with the syntax known at compile time
+static HF_CSV* hf_csv__create_from_buffer(const HF_CSV_allocator* allocator, const char* string, size_t size, bool zero_copy, const HF_CSV_load_options* options) {
+    const HF_CSV_dialect* dialect = options && options->dialect ? options->dialect : &hf_csv__dialect_csv;
+    if(!hf_csv__dialect_valid(dialect)) {
+        hf_csv__report_failure(options, HF_CSV_ERROR_INVALID_OPTIONS, 0);
+        return NULL;
+    }
+
+    HF_CSV* new_csv;
+    if(hf_csv__dialect_same_syntax(dialect, &hf_csv__dialect_csv)) {
+        new_csv = hf_csv__parse_buffer(allocator, string, size, zero_copy, options, &hf_csv__dialect_csv);
+    }
+    else if(hf_csv__dialect_same_syntax(dialect, &hf_csv__dialect_tsv)) {
+        new_csv = hf_csv__parse_buffer(allocator, string, size, zero_copy, options, &hf_csv__dialect_tsv);
+    }
+    else if(hf_csv__dialect_same_syntax(dialect, &hf_csv__dialect_semicolon)) {
+        new_csv = hf_csv__parse_buffer(allocator, string, size, zero_copy, options, &hf_csv__dialect_semicolon);
+    }
+    else {
+        new_csv = hf_csv__parse_buffer(allocator, string, size, zero_copy, options, dialect);
+    }
+
+    if(new_csv) {
+        new_csv->dialect = *dialect;
+    }
+    return new_csv;
+}
+
+//a range of the string parsed by its own thread into a temporary csv
+typedef struct HF_CSV__chunk_s {
+    size_t start;
+    size_t end;
+    size_t quotes;
+    HF_CSV* csv;
+} HF_CSV__chunk;
+
+typedef struct HF_CSV__parallel_parse_s {
+    const HF_CSV_allocator* allocator;
+    const char* string;
+    bool zero_copy;
+    HF_CSV__chunk* chunks;
+} HF_CSV__parallel_parse;
+
+static void hf_csv__count_quotes_task(void* context, size_t index) {
+    HF_CSV__parallel_parse* parse = (HF_CSV__parallel_parse*)context;
+    HF_CSV__chunk* chunk = &parse->chunks[index];
+    const char* itr = parse->string + chunk->start;
+    const char* end = parse->string + chunk->end;
+    size_t quotes = 0;
+    while((itr = (const char*)memchr(itr, '\"', (size_t)(end - itr))) != NULL) {
+        quotes++;
+        itr++;
+    }
+    chunk->quotes = quotes;
+}
+
+static void hf_csv__parse_chunk_task(void* context, size_t index) {
+    HF_CSV__parallel_parse* parse = (HF_CSV__parallel_parse*)context;
+    HF_CSV__chunk* chunk = &parse->chunks[index];
+    if(index > 0 && chunk->start == chunk->end) {//chunk was swallowed by a previous one
+        return;
+    }
+    chunk->csv = hf_csv__create_from_buffer(parse->allocator, parse->string + chunk->start, chunk->end - chunk->start, parse->zero_copy, NULL);
+}
+
+//parses string split in up to threads chunks, each one starting at a row boundary. Result is the same as hf_csv__create_from_buffer's
+static HF_CSV* hf_csv__create_from_buffer_parallel(const HF_CSV_allocator* allocator, const char* string, size_t size, bool zero_copy, size_t threads, const HF_CSV_load_options* options) {
+    size_t chunk_count = size / HF_CSV__MIN_CHUNK_SIZE;
+    if(chunk_count > threads) {
+        chunk_count = threads;
+    }
+    if(chunk_count <= 1 || options) {//projections depend on the header, so they are only parsed serially
+        return hf_csv__create_from_buffer(allocator, string, size, zero_copy, options);
+    }
+
+    const HF_CSV_allocator* scratch = allocator ? allocator : &hf_csv__default_allocator;
+    HF_CSV__chunk* chunks = (HF_CSV__chunk*)hf_csv__alloc(scratch, sizeof(HF_CSV__chunk) * chunk_count);
+    if(!chunks) {
+        return NULL;
+    }
+    memset(chunks, 0, sizeof(HF_CSV__chunk) * chunk_count);
+    HF_CSV__parallel_parse parse = { allocator, string, zero_copy, chunks };
+
+    //first pass counts quotes of evenly sized chunks, so the quote state at each chunk start is known exactly
+    for(size_t i = 0; i < chunk_count; i++) {
+        chunks[i].start = size / chunk_count * i;
+        chunks[i].end = i + 1 == chunk_count ? size : size / chunk_count * (i + 1);
+    }
+    hf_csv__parallel_for(scratch, chunk_count, threads, hf_csv__count_quotes_task, &parse);
+
+    //move every chunk start forward to the first row start, i.e. after a newline outside quotes
+    size_t quotes_before = 0;
+    size_t previous_start = 0;
+    for(size_t i = 1; i < chunk_count; i++) {
+        quotes_before += chunks[i - 1].quotes;
+        bool in_quotes = (quotes_before & 1) != 0;
+        size_t start = chunks[i].start;
+        if(start < previous_start) {//row started by previous chunk goes past this one, leaving previous chunk empty
+            start = previous_start;
+        }
+        else {
+            while(start < size && (in_quotes || string[start] != '\n')) {
+                if(string[start] == '\"') {
+                    in_quotes = !in_quotes;
+                }
+                start++;
+            }
+            start = start < size ? start + 1 : size;
+        }
+        chunks[i].start = start;
+        chunks[i - 1].end = start;
+        previous_start = start;
+    }
+    chunks[chunk_count - 1].end = size;
+
+    hf_csv__parallel_for(scratch, chunk_count, threads, hf_csv__parse_chunk_task, &parse);
+
+    //stitch rows together, validating column count against the first row like the serial parser does
+    bool valid = true;
+    size_t rows = 0;
+    size_t columns = chunks[0].csv ? chunks[0].csv->columns : 0;
+    for(size_t i = 0; i < chunk_count; i++) {
+        if(chunks[i].start == chunks[i].end && i > 0) {
+            continue;
+        }
+        if(!chunks[i].csv || chunks[i].csv->columns != columns) {
+            valid = false;
+            break;
+        }
+        rows += chunks[i].csv->rows;
+    }
+
+    HF_CSV* new_csv = NULL;
+    if(valid) {
+        new_csv = hf_csv__alloc_csv(allocator);
+        if(new_csv) {
+            new_csv->values = (HF_CSV__cell**)hf_csv__alloc(&new_csv->allocator, sizeof(HF_CSV__cell*) * rows);
+            if(!new_csv->values) {
+                hf_csv_destroy(new_csv);
+                new_csv = NULL;
+            }
+        }
+    }
+
+    if(new_csv) {
+        new_csv->columns = columns;
+        new_csv->column_capacity = columns;
+        new_csv->row_capacity = rows;
+        for(size_t i = 0; i < chunk_count; i++) {
+            HF_CSV* chunk_csv = chunks[i].csv;
+            if(!chunk_csv) {
+                continue;
+            }
+            memcpy(new_csv->values + new_csv->rows, chunk_csv->values, sizeof(HF_CSV__cell*) * chunk_csv->rows);
+            new_csv->rows += chunk_csv->rows;
+
+            //blocks now belong to the stitched csv
+            hf_csv__splice_blocks(&new_csv->blocks, chunk_csv->blocks);
+            hf_csv__splice_blocks(&new_csv->row_blocks, chunk_csv->row_blocks);
+            hf_csv__free(&chunk_csv->allocator, chunk_csv->values, sizeof(HF_CSV__cell*) * chunk_csv->row_capacity);
+            hf_csv__free(&chunk_csv->allocator, chunk_csv, sizeof(HF_CSV));
+        }
+    }
+    else {
+        for(size_t i = 0; i < chunk_count; i++) {
+            hf_csv_destroy(chunks[i].csv);
+        }
+    }
+
+    hf_csv__free(scratch, chunks, sizeof(HF_CSV__chunk) * chunk_count);
+    return new_csv;
+}
+
+//loads file through stdio when it can't be mapped
+static HF_CSV* hf_csv__create_from_stream(const HF_CSV_allocator* allocator, const char* filename, size_t threads, const HF_CSV_load_options* options) {
+    FILE* file = hf_csv__fopen(filename, "rb");
+    if(!file) {
+        hf_csv__report_failure(options, HF_CSV_ERROR_IO, 0);
+        return NULL;
+    }
+
+    if(!allocator) {
+        allocator = &hf_csv__default_allocator;
+    }
+    size_t capacity = HF_CSV__READER_BUFFER_SIZE;
+    size_t size = 0;
+    char* string = (char*)hf_csv__alloc(allocator, capacity);
+    while(string) {
+        size += fread(string + size, 1, capacity - size, file);
+        if(size < capacity) {
+            break;
+        }
+        char* new_string = (char*)hf_csv__realloc(allocator, string, capacity, capacity * 2);
+        if(!new_string) {
+            hf_csv__free(allocator, string, capacity);
+        }
+        string = new_string;
+        capacity *= 2;
+    }
+    bool failed = !string || ferror(file);
+    fclose(file);
+    if(failed) {
+        hf_csv__report_failure(options, string ? HF_CSV_ERROR_IO : HF_CSV_ERROR_OUT_OF_MEMORY, 0);
+        hf_csv__free(allocator, string, capacity);
+        return NULL;
+    }
+
+    HF_CSV* new_csv = hf_csv__create_from_buffer_parallel(allocator, string, size, false, threads, options);
+    hf_csv__free(allocator, string, capacity);
+    return new_csv;
+}
+
+//maps file and parses it using up to threads threads
+static HF_CSV* hf_csv__create_from_mapped_file(const HF_CSV_allocator* allocator, const char* filename, size_t threads, const HF_CSV_load_options* options) {
+    void* mapping;
+    size_t size;
+    if(!hf_csv__map_file(filename, &mapping, &size)) {
+        return hf_csv__create_from_stream(allocator, filename, threads, options);
+    }
+
+    const char* string = (const char*)mapping;
+    HF_CSV* new_csv = hf_csv__create_from_buffer_parallel(allocator, string, size, true, threads, options);
+    if(!new_csv || !hf_csv__view_lock_create(new_csv)) {
+        hf_csv_destroy(new_csv);
+        hf_csv__unmap_file(mapping, size);
+        return NULL;
+    }
+    new_csv->mapping = mapping;
+    new_csv->mapping_size = size;
+    return new_csv;
+}
+
+HF_CSV* hf_csv_create_from_file(const char* filename) {
+    return hf_csv__create_from_mapped_file(NULL, filename, 1, NULL);
+}
+
+HF_CSV* hf_csv_create_from_file_with_allocator(const char* filename, const HF_CSV_allocator* allocator) {
+    return hf_csv__create_from_mapped_file(allocator, filename, 1, NULL);
+}
+
+HF_CSV* hf_csv_create_from_file_parallel(const char* filename, size_t threads) {
+    return hf_csv__create_from_mapped_file(NULL, filename, threads, NULL);
+}
+
+HF_CSV* hf_csv_create_from_file_parallel_with_allocator(const char* filename, size_t threads, const HF_CSV_allocator* allocator) {
+    return hf_csv__create_from_mapped_file(allocator, filename, threads, NULL);
+}
+
+HF_CSV* hf_csv_create_from_file_with_options(const char* filename, const HF_CSV_load_options* options) {
+    return hf_csv__create_from_mapped_file(options ? options->allocator : NULL, filename, 1, options);
+}
+
+HF_CSV_dialect hf_csv_dialect(char delimiter) {
+    HF_CSV_dialect dialect = hf_csv__dialect_csv;
+    dialect.delimiter = delimiter;
+    return dialect;
+}
+
+bool hf_csv_set_dialect(HF_CSV* csv, const HF_CSV_dialect* dialect) {
+    if(!csv || !dialect || !hf_csv__dialect_valid(dialect)) {
+        return false;
+    }
+    csv->dialect = *dialect;
+    return true;
+}
+
+HF_CSV* hf_csv_create(size_t rows, size_t columns) {
+    return hf_csv_create_with_allocator(rows, columns, NULL);
+}
+
+HF_CSV* hf_csv_create_with_allocator(size_t rows, size_t columns, const HF_CSV_allocator* allocator) {
+    if(rows == 0 || columns == 0) {
+        return NULL;
+    }
+
+    HF_CSV* new_csv = hf_csv__alloc_csv(allocator);
+    if(!new_csv) {//failed alloc
+        return NULL;
+    }
+
+    new_csv->values = (HF_CSV__cell**)hf_csv__alloc(&new_csv->allocator, sizeof(HF_CSV__cell*) * rows);
+    if(!new_csv->values) {
+        hf_csv_destroy(new_csv);
+        return NULL;
+    }
+    new_csv->row_capacity = rows;
+
+    //all cells share a single block
+    HF_CSV__cell* cells = (HF_CSV__cell*)hf_csv__alloc_block(new_csv, &new_csv->row_blocks, sizeof(HF_CSV__cell) * rows * columns);
+    if(!cells) {
+        hf_csv_destroy(new_csv);
+        return NULL;
+    }
+    memset(cells, 0, sizeof(HF_CSV__cell) * rows * columns);
+
+    new_csv->rows = rows;
+    new_csv->columns = columns;
+    new_csv->column_capacity = columns;
+    for(size_t row = 0; row < rows; row++) {
+        new_csv->values[row] = cells + row * columns;
+    }
+
+    return new_csv;
+}
+
+HF_CSV* hf_csv_create_from_string(const char* string) {
+    if(!string) {
+        return NULL;
+    }
+
+    return hf_csv__create_from_buffer(NULL, string, strlen(string), false, NULL);
+}
+
+HF_CSV* hf_csv_create_from_string_with_allocator(const char* string, const HF_CSV_allocator* allocator) {
+    if(!string) {
+        return NULL;
+    }
+
+    return hf_csv__create_from_buffer(allocator, string, strlen(string), false, NULL);
+}
+
+HF_CSV* hf_csv_create_from_string_with_options(const char* string, const HF_CSV_load_options* options) {
+    if(!string) {
+        return NULL;
+    }
+
+    return hf_csv__create_from_buffer(options ? options->allocator : NULL, string, strlen(string), false, options);
+}
+
+HF_CSV* hf_csv_create_from_string_n(const char* string, size_t length) {
+    return hf_csv_create_from_string_n_with_allocator(string, length, NULL);
+}
+
+HF_CSV* hf_csv_create_from_string_n_with_allocator(const char* string, size_t length, const HF_CSV_allocator* allocator) {
+    if(!string) {
+        return NULL;
+    }
+
+    return hf_csv__create_from_buffer(allocator, string, length, false, NULL);
+}
+
+HF_CSV* hf_csv_create_from_string_parallel(const char* string, size_t threads) {
+    return hf_csv_create_from_string_parallel_with_allocator(string, threads, NULL);
+}
+
+HF_CSV* hf_csv_create_from_string_parallel_with_allocator(const char* string, size_t threads, const HF_CSV_allocator* allocator) {
+    if(!string) {
+        return NULL;
+    }
+
+    return hf_csv__create_from_buffer_parallel(allocator, string, strlen(string), false, threads, NULL);
+}
+
+//a row decoded by a lazy csv. Values are unescaped into buffer and null-terminated
+typedef struct HF_CSV__lazy_slot_s {
+    size_t row;
+    size_t prev;//more recently used slot, SIZE_MAX if first
+    size_t next;//less recently used slot, SIZE_MAX if last
+    HF_CSV__cell* cells;
+    char* buffer;
+    size_t buffer_size;
+} HF_CSV__lazy_slot;
+
+//row offsets of a mapped file, with the most recently used rows decoded
+struct HF_CSV__lazy_s {
+    size_t* row_starts;//rows + 1 offsets, last one is the file size
+    size_t row_start_capacity;
+    uint32_t* row_slots;//slot + 1 holding each row, 0 if not decoded
+    HF_CSV__lazy_slot* slots;
+    size_t slot_count;
+    size_t slot_capacity;
+    size_t first;//most recently used slot
+    size_t last;//least recently used slot, evicted first
+};
+
+//finds every row start with the block classifier, i.e. positions after a newline outside quotes. A newline ending the string starts no row, like in the parser
+static bool hf_csv__lazy_scan_rows(HF_CSV* csv, HF_CSV__lazy* lazy, const char* string, size_t size) {
+    hf_csv__select_classifier();
+
+    lazy->row_start_capacity = size / 64 + 16;
+    lazy->row_starts = (size_t*)hf_csv__alloc(&csv->allocator, sizeof(size_t) * lazy->row_start_capacity);
+    if(!lazy->row_starts) {
+        return false;
+    }
+    size_t rows = 0;
+    lazy->row_starts[rows++] = 0;
+
+    uint64_t in_quotes = 0;
+    for(size_t block_start = 0; block_start < size; block_start += 64) {
+        const char* block = string + block_start;
+        char padded[64];
+        if(size - block_start < 64) {
+            memset(padded, 0, sizeof(padded));
+            memcpy(padded, block, size - block_start);
+            block = padded;
+        }
+
+        HF_CSV__block_masks masks;
+        hf_csv__classify(block, ',', '\"', &masks);
+        uint64_t quoted = hf_csv__prefix_xor(masks.quotes) ^ in_quotes;
+        in_quotes = (quoted >> 63) ? ~(uint64_t)0 : 0;
+        uint64_t newlines = masks.newlines & ~quoted;
+        while(newlines) {
+            size_t start = block_start + hf_csv__ctz64(newlines) + 1;
+            newlines &= newlines - 1;
+            if(start >= size) {
+                break;
+            }
+            if(rows + 1 >= lazy->row_start_capacity) {
+                size_t* row_starts = (size_t*)hf_csv__realloc(&csv->allocator, lazy->row_starts, sizeof(size_t) * lazy->row_start_capacity, sizeof(size_t) * lazy->row_start_capacity * 2);
+                if(!row_starts) {
+                    return false;
+                }
+                lazy->row_starts = row_starts;
+                lazy->row_start_capacity *= 2;
+            }
+            lazy->row_starts[rows++] = start;
+        }
+    }
+    lazy->row_starts[rows] = size;
+    csv->rows = rows;
+    return true;
+}
+
+static void hf_csv__lazy_free(HF_CSV* csv) {
+    HF_CSV__lazy* lazy = csv->lazy;
+    if(!lazy) {
+        return;
+    }
+    for(size_t i = 0; i < lazy->slot_count; i++) {
+        hf_csv__free(&csv->allocator, lazy->slots[i].cells, sizeof(HF_CSV__cell) * csv->columns);
+        hf_csv__free(&csv->allocator, lazy->slots[i].buffer, lazy->slots[i].buffer_size);
+    }
+    hf_csv__free(&csv->allocator, lazy->slots, sizeof(HF_CSV__lazy_slot) * lazy->slot_capacity);
+    hf_csv__free(&csv->allocator, lazy->row_slots, sizeof(uint32_t) * csv->rows);
+    hf_csv__free(&csv->allocator, lazy->row_starts, sizeof(size_t) * lazy->row_start_capacity);
+    hf_csv__free(&csv->allocator, lazy, sizeof(HF_CSV__lazy));
+    csv->lazy = NULL;
+}
+
+//decodes every value of row into slot. Returns the amount of values found, or 0 if row is malformed. Values past columns are counted but not stored
+static size_t hf_csv__lazy_decode(HF_CSV* csv, HF_CSV__lazy_slot* slot, size_t row, size_t columns) {
+    const char* string = (const char*)csv->mapping;
+    const char* itr = string + csv->lazy->row_starts[row];
+    const char* end = string + csv->lazy->row_starts[row + 1];
+    //values never take more space than in the file, plus their terminators
+    size_t needed = (size_t)(end - itr) + columns + 1;
+    if(slot->buffer_size < needed) {
+        char* buffer = (char*)hf_csv__realloc(&csv->allocator, slot->buffer, slot->buffer_size, needed);
+        if(!buffer) {
+            return 0;
+        }
+        slot->buffer = buffer;
+        slot->buffer_size = needed;
+    }
+
+    char* buffer = slot->buffer;
+    size_t count = 0;
+    while(true) {
+        //values past columns are parsed at the start of the buffer, only to be counted
+        char* value = count < columns ? buffer : slot->buffer;
+        size_t length;
+        if(!hf_csv__parse_value(&itr, end, value, &length, &hf_csv__dialect_csv)) {
+            return 0;
+        }
+        if(count < columns) {
+            slot->cells[count].value = value;
+            slot->cells[count].length = length;
+            buffer += length + 1;
+        }
+        count++;
+        if(itr == end) {
+            return count;
+        }
+        if(*itr == '\n') {//only the last newline of a row can be outside quotes
+            return 0;
+        }
+        itr++;
+    }
+}
+
+static void hf_csv__lazy_unlink(HF_CSV__lazy* lazy, size_t index) {
+    HF_CSV__lazy_slot* slot = &lazy->slots[index];
+    if(slot->prev != SIZE_MAX) {
+        lazy->slots[slot->prev].next = slot->next;
+    }
+    else {
+        lazy->first = slot->next;
+    }
+    if(slot->next != SIZE_MAX) {
+        lazy->slots[slot->next].prev = slot->prev;
+    }
+    else {
+        lazy->last = slot->prev;
+    }
+}
+
+static void hf_csv__lazy_push_first(HF_CSV__lazy* lazy, size_t index) {
+    HF_CSV__lazy_slot* slot = &lazy->slots[index];
+    slot->prev = SIZE_MAX;
+    slot->next = lazy->first;
+    if(lazy->first != SIZE_MAX) {
+        lazy->slots[lazy->first].prev = index;
+    }
+    lazy->first = index;
+    if(lazy->last == SIZE_MAX) {
+        lazy->last = index;
+    }
+}
+
+//returns the decoded cells of row, decoding it into a free or the least recently used slot if needed. NULL if row is malformed or allocation failed
+static HF_CSV__cell* hf_csv__lazy_row(HF_CSV* csv, size_t row) {
+    HF_CSV__lazy* lazy = csv->lazy;
+    size_t index = lazy->row_slots[row];
+    if(index != 0) {
+        index--;
+        if(lazy->first != index) {
+            hf_csv__lazy_unlink(lazy, index);
+            hf_csv__lazy_push_first(lazy, index);
+        }
+        return lazy->slots[index].cells;
+    }
+
+    if(lazy->slot_count < lazy->slot_capacity) {
+        HF_CSV__cell* cells = (HF_CSV__cell*)hf_csv__alloc(&csv->allocator, sizeof(HF_CSV__cell) * csv->columns);
+        if(!cells) {
+            return NULL;
+        }
+        memset(cells, 0, sizeof(HF_CSV__cell) * csv->columns);
+        index = lazy->slot_count++;
+        memset(&lazy->slots[index], 0, sizeof(HF_CSV__lazy_slot));
+        lazy->slots[index].cells = cells;
+    }
+    else {
+        index = lazy->last;
+        hf_csv__lazy_unlink(lazy, index);
+        lazy->row_slots[lazy->slots[index].row] = 0;
+    }
+
+    HF_CSV__lazy_slot* slot = &lazy->slots[index];
+    slot->row = row;
+    hf_csv__lazy_push_first(lazy, index);
+    if(hf_csv__lazy_decode(csv, slot, row, csv->columns) != csv->columns) {//slot stays unused, at the end of the list
+        hf_csv__lazy_unlink(lazy, index);
+        slot->prev = lazy->last;
+        slot->next = SIZE_MAX;
+        if(lazy->last != SIZE_MAX) {
+            lazy->slots[lazy->last].next = index;
+        }
+        else {
+            lazy->first = index;
+        }
+        lazy->last = index;
+        return NULL;
+    }
+    lazy->row_slots[row] = (uint32_t)(index + 1);
+    return slot->cells;
+}
+
+//gives a loaded snapshot regular cells, pointing to the values of the mapped blob, and its own copy of mapped index entries. Returns false if allocation failed
+static bool hf_csv__snapshot_materialize(HF_CSV* csv) {
+    for(HF_CSV__index* index = csv->indexes; index; index = index->next) {
+        if(!index->mapped) {
+            continue;
+        }
+        HF_CSV__index_entry* entries = (HF_CSV__index_entry*)hf_csv__alloc(&csv->allocator, sizeof(HF_CSV__index_entry) * index->capacity);
+        if(!entries) {
+            return false;
+        }
+        memcpy(entries, index->entries, sizeof(HF_CSV__index_entry) * index->capacity);
+        index->entries = entries;
+        index->mapped = false;
+    }
+
+    HF_CSV__cell** values = (HF_CSV__cell**)hf_csv__alloc(&csv->allocator, sizeof(HF_CSV__cell*) * csv->rows);
+    if(!values) {
+        return false;
+    }
+    HF_CSV__cell* cells = (HF_CSV__cell*)hf_csv__alloc_block(csv, &csv->row_blocks, sizeof(HF_CSV__cell) * csv->rows * csv->columns);
+    if(!cells) {
+        hf_csv__free(&csv->allocator, values, sizeof(HF_CSV__cell*) * csv->rows);
+        return false;
+    }
+
+    //blob values are null-terminated, so cells are regular arena-like values rather than views
+    const uint64_t* offsets = csv->snapshot_offsets;
+    for(size_t row = 0; row < csv->rows; row++) {
+        values[row] = cells;
+        for(size_t column = 0; column < csv->columns; column++) {
+            cells->value = (char*)(csv->snapshot_blob + offsets[0]);
+            cells->length = (size_t)(offsets[1] - offsets[0] - 1);
+            cells->owned = false;
+            cells->view = false;
+            cells->code = 0;
+            cells++;
+            offsets++;
+        }
+    }
+    csv->values = values;
+    csv->row_capacity = csv->rows;
+    csv->column_capacity = csv->columns;
+    csv->snapshot_offsets = NULL;
+    csv->snapshot_blob = NULL;
+    return true;
+}
+
+//replaces the lazy or snapshot state of csv with every row fully parsed. Needed by every operation other than reading single values.
+//Returns false if file is malformed or allocation failed, leaving csv untouched
+static bool hf_csv__materialize(HF_CSV* csv) {
+    if(csv->snapshot_offsets) {
+        return hf_csv__snapshot_materialize(csv);
+    }
+    if(!csv->lazy) {
+        return true;
+    }
+
+    HF_CSV* parsed = hf_csv__create_from_buffer(&csv->allocator, (const char*)csv->mapping, csv->mapping_size, true, NULL);
+    if(!parsed) {
+        return false;
+    }
+    hf_csv__lazy_free(csv);
+    csv->values = parsed->values;
+    csv->rows = parsed->rows;
+    csv->columns = parsed->columns;
+    csv->row_capacity = parsed->row_capacity;
+    csv->column_capacity = parsed->column_capacity;
+    csv->blocks = parsed->blocks;
+    csv->row_blocks = parsed->row_blocks;
+    hf_csv__free(&csv->allocator, parsed, sizeof(HF_CSV));
+    return true;
+}
+
+HF_CSV* hf_csv_create_from_file_lazy(const char* filename, size_t cache_rows) {
+    return hf_csv_create_from_file_lazy_with_allocator(filename, cache_rows, NULL);
+}
+
+HF_CSV* hf_csv_create_from_file_lazy_with_allocator(const char* filename, size_t cache_rows, const HF_CSV_allocator* allocator) {
+    if(cache_rows == 0 || cache_rows >= UINT32_MAX) {
+        return NULL;
+    }
+
+    void* mapping;
+    size_t size;
+    if(!hf_csv__map_file(filename, &mapping, &size)) {
+        return hf_csv__create_from_stream(allocator, filename, 1, NULL);
+    }
+    if(size == 0) {//nothing to defer
+        return hf_csv__create_from_mapped_file(allocator, filename, 1, NULL);
+    }
+
+    HF_CSV* new_csv = hf_csv__alloc_csv(allocator);
+    if(!new_csv) {
+        hf_csv__unmap_file(mapping, size);
+        return NULL;
+    }
+    new_csv->mapping = mapping;
+    new_csv->mapping_size = size;
+    if(!hf_csv__view_lock_create(new_csv)) {
+        hf_csv_destroy(new_csv);
+        return NULL;
+    }
+
+    HF_CSV__lazy* lazy = (HF_CSV__lazy*)hf_csv__alloc(&new_csv->allocator, sizeof(HF_CSV__lazy));
+    if(!lazy) {
+        hf_csv_destroy(new_csv);
+        return NULL;
+    }
+    memset(lazy, 0, sizeof(HF_CSV__lazy));
+    lazy->first = SIZE_MAX;
+    lazy->last = SIZE_MAX;
+    new_csv->lazy = lazy;
+    if(!hf_csv__lazy_scan_rows(new_csv, lazy, (const char*)mapping, size)) {
+        new_csv->rows = 0;
+        hf_csv_destroy(new_csv);
+        return NULL;
+    }
+
+    lazy->slot_capacity = cache_rows < new_csv->rows ? cache_rows : new_csv->rows;
+    lazy->row_slots = (uint32_t*)hf_csv__alloc(&new_csv->allocator, sizeof(uint32_t) * new_csv->rows);
+    lazy->slots = (HF_CSV__lazy_slot*)hf_csv__alloc(&new_csv->allocator, sizeof(HF_CSV__lazy_slot) * lazy->slot_capacity);
+    if(!lazy->row_slots || !lazy->slots) {
+        hf_csv_destroy(new_csv);
+        return NULL;
+    }
+    memset(lazy->row_slots, 0, sizeof(uint32_t) * new_csv->rows);
+
+    //the first row sets the column count, like in the parser
+    HF_CSV__lazy_slot probe;
+    memset(&probe, 0, sizeof(probe));
+    new_csv->columns = hf_csv__lazy_decode(new_csv, &probe, 0, 0);
+    hf_csv__free(&new_csv->allocator, probe.buffer, probe.buffer_size);
+    if(new_csv->columns == 0) {
+        hf_csv_destroy(new_csv);
+        return NULL;
+    }
+    return new_csv;
+}
+
+//returns the bytes taken by count values copied with their terminators
+static size_t hf_csv__cells_size(const HF_CSV__cell* cells, size_t count) {
+    size_t size = 0;
+    for(size_t i = 0; i < count; i++) {
+        size += cells[i].value ? cells[i].length + 1 : 0;
+    }
+    return size;
+}
+
+//copies count values to arena, null-terminated, and points copies to them. Returns arena past the copies
+static char* hf_csv__copy_cells(const HF_CSV__cell* cells, size_t count, HF_CSV__cell* copies, char* arena) {
+    for(size_t i = 0; i < count; i++) {
+        memset(&copies[i], 0, sizeof(HF_CSV__cell));
+        if(cells[i].value) {
+            memcpy(arena, cells[i].value, cells[i].length);
+            arena[cells[i].length] = '\0';
+            copies[i].value = arena;
+            copies[i].length = cells[i].length;
+            arena += cells[i].length + 1;
+        }
+    }
+    return arena;
+}
+
+//gives a view rows and values of its own, copied from the cells of its source. Values don't change, so indexes and typed columns stay valid
+static bool hf_csv__detach(HF_CSV* csv) {
+    if(!csv->source) {
+        return true;
+    }
+
+    size_t bytes = 0;
+    for(size_t row = 0; row < csv->rows; row++) {
+        bytes += hf_csv__cells_size(csv->values[row], csv->columns);
+    }
+    char* arena = bytes > 0 ? (char*)hf_csv__alloc_block(csv, &csv->blocks, bytes) : NULL;
+    HF_CSV__cell* cells = (bytes == 0 || arena) ? (HF_CSV__cell*)hf_csv__alloc_block(csv, &csv->row_blocks, sizeof(HF_CSV__cell) * csv->rows * csv->columns) : NULL;
+    if(!cells) {
+        return false;
+    }
+    for(size_t row = 0; row < csv->rows; row++) {
+        arena = hf_csv__copy_cells(csv->values[row], csv->columns, cells + row * csv->columns, arena);
+        csv->values[row] = cells + row * csv->columns;
+    }
+    csv->column_capacity = csv->columns;
+    csv->source = NULL;
+    return true;
+}
+
+void hf_csv_destroy(HF_CSV* csv) {
+    if(!csv) {
+        return;
+    }
+
+    if(csv->values) {
+        //only values set after creation own memory, arena values are released along with their blocks
+        for(size_t row = 0; row < csv->rows && csv->owned_count > 0; row++) {
+            for(size_t column = 0; column < csv->columns; column++) {
+                HF_CSV__cell* cell = &csv->values[row][column];
+                if(cell->owned) {
+                    hf_csv__free(&csv->allocator, cell->value, cell->length + 1);
+                    csv->owned_count--;
+                }
+            }
+        }
+        hf_csv__free(&csv->allocator, csv->values, sizeof(HF_CSV__cell*) * csv->row_capacity);
+    }
+
+    hf_csv__free(&csv->allocator, csv->free_rows, sizeof(HF_CSV__cell*) * csv->free_row_capacity);
+    hf_csv__free_blocks(csv, csv->row_blocks);
+    hf_csv__free_blocks(csv, csv->blocks);
+    hf_csv__unmap_file(csv->mapping, csv->mapping_size);
+    if(csv->view_lock) {
+        hf_csv__mutex_destroy(&csv->view_lock->mutex);
+        hf_csv__free(&csv->allocator, csv->view_lock, sizeof(HF_CSV__view_lock));
+    }
+    HF_CSV__index* index = csv->indexes;
+    while(index) {
+        HF_CSV__index* next = index->next;
+        if(!index->mapped) {
+            hf_csv__free(&csv->allocator, index->entries, sizeof(HF_CSV__index_entry) * index->capacity);
+        }
+        hf_csv__free(&csv->allocator, index, sizeof(HF_CSV__index));
+        index = next;
+    }
+    for(size_t column = 0; column < csv->dictionary_count; column++) {
+        hf_csv__dictionary_free(csv, csv->dictionaries[column]);
+    }
+    hf_csv__free(&csv->allocator, csv->dictionaries, sizeof(HF_CSV__dictionary*) * csv->dictionary_count);
+    hf_csv__typed_invalidate(csv, SIZE_MAX);
+    hf_csv__lazy_free(csv);
+    if(csv->tail_filename) {
+        hf_csv__free(&csv->allocator, csv->tail_filename, strlen(csv->tail_filename) + 1);
+    }
+    HF_CSV_allocator allocator = csv->allocator;
+    hf_csv__free(&allocator, csv, sizeof(HF_CSV));
+
+    return;
+}
+
+static inline unsigned hf_csv__popcount64(uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_popcountll(bits);
+#else
+    bits = bits - ((bits >> 1) & 0x5555555555555555ull);
+    bits = (bits & 0x3333333333333333ull) + ((bits >> 2) & 0x3333333333333333ull);
+    bits = (bits + (bits >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+    return (unsigned)((bits * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+//sets the high bit of every byte of word equal to the byte repeated in pattern
+static inline uint64_t hf_csv__swar_equal(uint64_t word, uint64_t pattern) {
+    uint64_t bytes = word ^ pattern;
+    return ~(((bytes & 0x7F7F7F7F7F7F7F7Full) + 0x7F7F7F7F7F7F7F7Full) | bytes | 0x7F7F7F7F7F7F7F7Full);
+}
+
+//tells if value has to be quoted, i.e. holds a newline, quote or delimiter, and counts the characters to escape in it. Long values are scanned 64 bytes at a time with the block classifier, then 8 at a time
+HF_CSV__INLINE bool hf_csv__value_needs_quotes(const char* value, size_t length, const HF_CSV_dialect* dialect, size_t* escapes_ptr) {
+    char delimiter = dialect->delimiter;
+    char quote = dialect->quote;
+    uint64_t quote_pattern = 0x0101010101010101ull * (unsigned char)quote;
+    uint64_t delimiter_pattern = 0x0101010101010101ull * (unsigned char)delimiter;
+    size_t quotes = 0;
+    uint64_t special = 0;
+    size_t i = 0;
+    for(; i + 64 <= length; i += 64) {
+        HF_CSV__block_masks masks;
+        hf_csv__classify(value + i, delimiter, quote, &masks);
+        if(quote == '\0') {
+            masks.quotes = 0;
+        }
+        quotes += hf_csv__popcount64(masks.quotes);
+        special |= masks.quotes | masks.commas | masks.newlines;
+    }
+    for(; i + 8 <= length; i += 8) {
+        uint64_t word;
+        memcpy(&word, value + i, 8);
+        uint64_t quote_bytes = quote != '\0' ? hf_csv__swar_equal(word, quote_pattern) : 0;
+        quotes += hf_csv__popcount64(quote_bytes);
+        special |= quote_bytes | hf_csv__swar_equal(word, delimiter_pattern) | hf_csv__swar_equal(word, 0x0A0A0A0A0A0A0A0Aull);
+    }
+    for(; i < length; i++) {
+        char c = value[i];
+        quotes += quote != '\0' && c == quote;
+        special |= (quote != '\0' && c == quote) || c == delimiter || c == '\n';
+    }
+
+    if(special != 0 && dialect->escape == HF_CSV_ESCAPE_BACKSLASH) {//backslashes are escaped too
+        const char* itr = value;
+        const char* end = value + length;
+        while((itr = (const char*)memchr(itr, '\\', (size_t)(end - itr))) != NULL) {
+            quotes++;
+            itr++;
+        }
+    }
+    *escapes_ptr = quotes;
+    return special != 0;
+}
+
+#define HF_CSV__OUTPUT_PLAIN 0
+#define HF_CSV__OUTPUT_QUOTED 1//quoted, without characters to escape
+#define HF_CSV__OUTPUT_ESCAPED 2//quoted, with characters to escape
+#define HF_CSV__OUTPUT_INVALID 3//has to be quoted, but dialect has no quote
+
+//returns how value is saved in column with dialect, and the number of characters to escape in it
+HF_CSV__INLINE unsigned char hf_csv__value_kind(const char* value, size_t length, size_t column, const HF_CSV_dialect* dialect, size_t* escapes_ptr) {
+    bool needs_quotes = hf_csv__value_needs_quotes(value, length, dialect, escapes_ptr);
+    if(!needs_quotes && hf_csv__dialect_scalar(dialect) && length > 0) {//values must not be taken for comments nor lose their blanks
+        needs_quotes = (column == 0 && dialect->comment != '\0' && value[0] == dialect->comment) ||
+            (dialect->trim && (hf_csv__is_blank(value[0]) || hf_csv__is_blank(value[length - 1])));
+        if(needs_quotes && dialect->escape == HF_CSV_ESCAPE_BACKSLASH) {
+            *escapes_ptr = 0;
+            for(size_t i = 0; i < length; i++) {
+                *escapes_ptr += value[i] == '\\';
+            }
+        }
+    }
+    if(!needs_quotes) {
+        return HF_CSV__OUTPUT_PLAIN;
+    }
+    if(dialect->quote == '\0') {
+        return HF_CSV__OUTPUT_INVALID;
+    }
+    return *escapes_ptr > 0 ? HF_CSV__OUTPUT_ESCAPED : HF_CSV__OUTPUT_QUOTED;
+}
+
+//copies value to output, escaping its quotes (and backslashes) as dialect does. Returns the end of the output
+static char* hf_csv__write_escaped(char* output, const char* value, size_t length, const HF_CSV_dialect* dialect) {
+    const char* itr = value;
+    const char* end = value + length;
+    if(dialect->escape == HF_CSV_ESCAPE_BACKSLASH) {
+        for(; itr != end; itr++) {
+            if(*itr == dialect->quote || *itr == '\\') {
+                *output++ = '\\';
+            }
+            *output++ = *itr;
+        }
+        return output;
+    }
+
+    const char* quote;
+    while((quote = (const char*)memchr(itr, dialect->quote, (size_t)(end - itr))) != NULL) {//copy up to and including quote, then repeat it
+        memcpy(output, itr, (size_t)(quote - itr) + 1);
+        output += quote - itr + 1;
+        *output++ = dialect->quote;
+        itr = quote + 1;
+    }
+    memcpy(output, itr, (size_t)(end - itr));
+    return output + (end - itr);
+}
+
+//state of a serialization. Rows are split in chunks sized first, then written to disjoint parts of the output
+typedef struct HF_CSV__serialize_s {
+    HF_CSV* csv;
+    unsigned char* kinds;//output kind of every cell, row after row, found while sizing so values are scanned once
+    size_t chunk_rows;
+    size_t* chunk_offsets;//bytes taken by every chunk, then where it starts in output. SIZE_MAX if a value can't be saved
+    char* output;
+} HF_CSV__serialize;
+
+//returns the bytes taken by rows first_row to end_row saved with dialect, or SIZE_MAX if a value can't be saved
+HF_CSV__INLINE size_t hf_csv__size_rows(HF_CSV* csv, size_t first_row, size_t end_row, unsigned char* kinds, const HF_CSV_dialect* dialect) {
+    size_t size = 0;
+    for(size_t row = first_row; row < end_row; row++) {
+        size += (row != 0 ? 2 : 0) + csv->columns - 1;//\r\n and delimiters
+        const HF_CSV__cell* cell = csv->values[row];
+        for(size_t column = 0; column < csv->columns; column++, cell++) {
+            size_t escapes;
+            unsigned char kind = cell->value ? hf_csv__value_kind(cell->value, cell->length, column, dialect, &escapes) : HF_CSV__OUTPUT_PLAIN;
+            *kinds++ = kind;
+            if(kind == HF_CSV__OUTPUT_PLAIN) {
+                size += cell->value ? cell->length : 0;
+                continue;
+            }
+            if(kind == HF_CSV__OUTPUT_INVALID) {
+                return SIZE_MAX;
+            }
+            size += cell->length + 2 + escapes;
+        }
+    }
+    return size;
+}
+
+static void hf_csv__size_chunk_task(void* context, size_t index) {
+    HF_CSV__serialize* serialize = (HF_CSV__serialize*)context;
+    HF_CSV* csv = serialize->csv;
+    size_t first_row = index * serialize->chunk_rows;
+    size_t end_row = first_row + serialize->chunk_rows < csv->rows ? first_row + serialize->chunk_rows : csv->rows;
+    unsigned char* kinds = serialize->kinds + first_row * csv->columns;
+
+    //plain csv gets its own copy of the loop, with the dialect known at compile time
+    if(hf_csv__dialect_same_syntax(&csv->dialect, &hf_csv__dialect_csv)) {
+        serialize->chunk_offsets[index] = hf_csv__size_rows(csv, first_row, end_row, kinds, &hf_csv__dialect_csv);
+    }
+    else {
+        serialize->chunk_offsets[index] = hf_csv__size_rows(csv, first_row, end_row, kinds, &csv->dialect);
+    }
+}
+
+HF_CSV__INLINE void hf_csv__write_rows(HF_CSV* csv, size_t first_row, size_t end_row, const unsigned char* kinds, char* output, const HF_CSV_dialect* dialect) {
+    for(size_t row = first_row; row < end_row; row++) {
+        if(row != 0) {
+            *output++ = '\r';
+            *output++ = '\n';
+        }
+        const HF_CSV__cell* cell = csv->values[row];
+        for(size_t column = 0; column < csv->columns; column++, cell++) {
+            if(column != 0) {
+                *output++ = dialect->delimiter;
+            }
+            unsigned char kind = *kinds++;
+            if(!cell->value) {//uninitialized value
+                continue;
+            }
+            if(kind == HF_CSV__OUTPUT_PLAIN) {
+                memcpy(output, cell->value, cell->length);
+                output += cell->length;
+                continue;
+            }
+
+            *output++ = dialect->quote;
+            if(kind == HF_CSV__OUTPUT_ESCAPED) {
+                output = hf_csv__write_escaped(output, cell->value, cell->length, dialect);
+            }
+            else {
+                memcpy(output, cell->value, cell->length);
+                output += cell->length;
+            }
+            *output++ = dialect->quote;
+        }
+    }
+}
+
+static void hf_csv__write_chunk_task(void* context, size_t index) {
+    HF_CSV__serialize* serialize = (HF_CSV__serialize*)context;
+    HF_CSV* csv = serialize->csv;
+    size_t first_row = index * serialize->chunk_rows;
+    size_t end_row = first_row + serialize->chunk_rows < csv->rows ? first_row + serialize->chunk_rows : csv->rows;
+    const unsigned char* kinds = serialize->kinds + first_row * csv->columns;
+    char* output = serialize->output + serialize->chunk_offsets[index];
+
+    if(hf_csv__dialect_same_syntax(&csv->dialect, &hf_csv__dialect_csv)) {
+        hf_csv__write_rows(csv, first_row, end_row, kinds, output, &hf_csv__dialect_csv);
+    }
+    else {
+        hf_csv__write_rows(csv, first_row, end_row, kinds, output, &csv->dialect);
+    }
+}
+
+char* hf_csv_to_string(HF_CSV* csv) {
+    return hf_csv_to_string_parallel(csv, 1);
+}
+
+char* hf_csv_to_string_parallel(HF_CSV* csv, size_t threads) {
+    if(!csv) {
+        return NULL;
+    }
+    if(!hf_csv__materialize(csv)) {
+        return NULL;
+    }
+    hf_csv__select_classifier();
+
+    HF_CSV__serialize serialize;
+    serialize.csv = csv;
+    size_t chunk_count = csv->rows / HF_CSV__MIN_CHUNK_ROWS;
+    if(chunk_count > threads) {
+        chunk_count = threads;
+    }
+    if(chunk_count == 0) {
+        chunk_count = 1;
+    }
+    serialize.chunk_rows = (csv->rows + chunk_count - 1) / chunk_count;
+    chunk_count = (csv->rows + serialize.chunk_rows - 1) / serialize.chunk_rows;
+    serialize.kinds = (unsigned char*)hf_csv__alloc(&csv->allocator, csv->rows * csv->columns);
+    serialize.chunk_offsets = (size_t*)hf_csv__alloc(&csv->allocator, sizeof(size_t) * chunk_count);
+    HF_CSV__string_header* header = NULL;
+    if(serialize.kinds && serialize.chunk_offsets) {
+        hf_csv__parallel_for(&csv->allocator, chunk_count, threads, hf_csv__size_chunk_task, &serialize);
+
+        size_t len = 1;
+        bool valid = true;
+        for(size_t i = 0; i < chunk_count; i++) {
+            size_t size = serialize.chunk_offsets[i];
+            valid = valid && size != SIZE_MAX;
+            serialize.chunk_offsets[i] = len - 1;
+            len += size;
+        }
+
+        //allocator is kept in front of the string, so it can be freed after csv is destroyed
+        header = valid ? (HF_CSV__string_header*)hf_csv__alloc(&csv->allocator, sizeof(HF_CSV__string_header) + len) : NULL;
+        if(header) {
+            header->allocator = csv->allocator;
+            header->size = sizeof(HF_CSV__string_header) + len;
+            serialize.output = (char*)(header + 1);
+            hf_csv__parallel_for(&csv->allocator, chunk_count, threads, hf_csv__write_chunk_task, &serialize);
+            serialize.output[len - 1] = '\0';
+        }
+    }
+
+    hf_csv__free(&csv->allocator, serialize.kinds, csv->rows * csv->columns);
+    hf_csv__free(&csv->allocator, serialize.chunk_offsets, sizeof(size_t) * chunk_count);
+    return header ? (char*)(header + 1) : NULL;
+}
+
+void hf_csv_free_string(char* string) {
+    if(!string) {
+        return;
+    }
+    HF_CSV__string_header* header = (HF_CSV__string_header*)string - 1;
+    HF_CSV_allocator allocator = header->allocator;
+    hf_csv__free(&allocator, header, header->size);
+}
+
+static HF_CSV_writer* hf_csv__writer_create(FILE* file, bool owns_file) {
+    hf_csv__select_classifier();
+    HF_CSV_writer* writer = (HF_CSV_writer*)malloc(sizeof(HF_CSV_writer));
+    if(!writer) {
+        return NULL;
+    }
+    writer->file = file;
+    writer->owns_file = owns_file;
+    writer->error = false;
+    writer->dialect = hf_csv__dialect_csv;
+    writer->rows_written = 0;
+    writer->filled = 0;
+    return writer;
+}
+
+static void hf_csv__writer_flush(HF_CSV_writer* writer) {
+    if(writer->filled > 0 && fwrite(writer->buffer, 1, writer->filled, writer->file) != writer->filled) {
+        writer->error = true;
+    }
+    writer->filled = 0;
+}
+
+//appends size bytes to the output buffer, flushing it when full. Data larger than the buffer is written directly
+static void hf_csv__writer_put(HF_CSV_writer* writer, const char* data, size_t size) {
+    if(size > HF_CSV__WRITER_BUFFER_SIZE - writer->filled) {
+        hf_csv__writer_flush(writer);
+        if(size > HF_CSV__WRITER_BUFFER_SIZE) {
+            if(fwrite(data, 1, size, writer->file) != size) {
+                writer->error = true;
+            }
+            return;
+        }
+    }
+    memcpy(writer->buffer + writer->filled, data, size);
+    writer->filled += size;
+}
+
+//writes value quoted if it contains a newline, quote or delimiter, escaping its quotes. Output is the same as hf_csv_to_string's
+static void hf_csv__writer_put_value(HF_CSV_writer* writer, const char* value, size_t length, size_t column) {
+    const HF_CSV_dialect* dialect = &writer->dialect;
+    size_t escapes;
+    unsigned char kind = hf_csv__value_kind(value, length, column, dialect, &escapes);
+    if(kind == HF_CSV__OUTPUT_PLAIN) {
+        hf_csv__writer_put(writer, value, length);
+        return;
+    }
+    if(kind == HF_CSV__OUTPUT_INVALID) {
+        writer->error = true;
+        return;
+    }
+
+    hf_csv__writer_put(writer, &dialect->quote, 1);
+    const char* itr = value;
+    const char* end = value + length;
+    while(kind == HF_CSV__OUTPUT_ESCAPED && itr != end) {//escaped in pieces, which at most double in size
+        char escaped[512];
+        size_t piece = (size_t)(end - itr) < sizeof(escaped) / 2 ? (size_t)(end - itr) : sizeof(escaped) / 2;
+        char* escaped_end = hf_csv__write_escaped(escaped, itr, piece, dialect);
+        hf_csv__writer_put(writer, escaped, (size_t)(escaped_end - escaped));
+        itr += piece;
+    }
+    hf_csv__writer_put(writer, itr, (size_t)(end - itr));
+    hf_csv__writer_put(writer, &dialect->quote, 1);
+}
+
+static void hf_csv__writer_begin_row(HF_CSV_writer* writer) {
+    if(writer->rows_written++ > 0) {
+        hf_csv__writer_put(writer, "\r\n", 2);
+    }
+}
+
+HF_CSV_writer* hf_csv_writer_open(const char* filename) {
+    FILE* file = hf_csv__fopen(filename, "wb");
+    if(!file) {
+        return NULL;
+    }
+
+    HF_CSV_writer* writer = hf_csv__writer_create(file, true);
+    if(!writer) {
+        fclose(file);
+    }
+    return writer;
+}
+
+HF_CSV_writer* hf_csv_writer_open_stream(FILE* file) {
+    if(!file) {
+        return NULL;
+    }
+    return hf_csv__writer_create(file, false);
+}
+
+bool hf_csv_writer_write_row(HF_CSV_writer* writer, const HF_CSV_value* values, size_t count) {
+    if(!writer || (!values && count > 0)) {
+        return false;
+    }
+
+    hf_csv__writer_begin_row(writer);
+    for(size_t i = 0; i < count; i++) {
+        if(i != 0) {
+            hf_csv__writer_put(writer, &writer->dialect.delimiter, 1);
+        }
+        if(values[i].value) {
+            hf_csv__writer_put_value(writer, values[i].value, values[i].length, i);
+        }
+    }
+    return !writer->error;
+}
+
+bool hf_csv_writer_write_csv(HF_CSV_writer* writer, HF_CSV* csv) {
+    if(!writer || !csv) {
+        return false;
+    }
+    if(!hf_csv__materialize(csv)) {
+        return false;
+    }
+
+    for(size_t row = 0; row < csv->rows; row++) {
+        hf_csv__writer_begin_row(writer);
+        for(size_t column = 0; column < csv->columns; column++) {
+            if(column != 0) {
+                hf_csv__writer_put(writer, &writer->dialect.delimiter, 1);
+            }
+            const HF_CSV__cell* cell = &csv->values[row][column];
+            if(cell->value) {
+                hf_csv__writer_put_value(writer, cell->value, cell->length, column);
+            }
+        }
+    }
+    return !writer->error;
+}
+
+bool hf_csv_writer_set_dialect(HF_CSV_writer* writer, const HF_CSV_dialect* dialect) {
+    if(!writer || !dialect || !hf_csv__dialect_valid(dialect)) {
+        return false;
+    }
+    writer->dialect = *dialect;
+    return true;
+}
+
+bool hf_csv_writer_close(HF_CSV_writer* writer) {
+    if(!writer) {
+        return false;
+    }
+
+    hf_csv__writer_flush(writer);
+    if(fflush(writer->file) != 0) {
+        writer->error = true;
+    }
+    if(writer->owns_file && fclose(writer->file) != 0) {
+        writer->error = true;
+    }
+
+    bool success = !writer->error;
+    free(writer);
+    return success;
+}
+
+//returns filename with a .tmp suffix, allocated by csv
+static char* hf_csv__temp_filename(HF_CSV* csv, const char* filename, size_t* size_ptr) {
+    size_t filename_length = strlen(filename);
+    char* temp_filename = (char*)hf_csv__alloc(&csv->allocator, filename_length + 5);
+    if(!temp_filename) {
+        return NULL;
+    }
+    memcpy(temp_filename, filename, filename_length);
+    memcpy(temp_filename + filename_length, ".tmp", 5);
+    *size_ptr = filename_length + 5;
+    return temp_filename;
+}
+
+//moves a fully written temporary file over filename, or removes it if writing failed. Returns true if filename was replaced
+static bool hf_csv__replace_file(const char* temp_filename, const char* filename, bool success) {
+#ifdef _WIN32
+    success = success && MoveFileExA(temp_filename, filename, MOVEFILE_REPLACE_EXISTING);
+#else
+    success = success && rename(temp_filename, filename) == 0;
+#endif
+    if(!success) {
+        remove(temp_filename);
+    }
+    return success;
+}
+
+bool hf_csv_to_file(HF_CSV* csv, const char* filename) {
+    if(!csv) {
+        return false;
+    }
+    if(!hf_csv__materialize(csv)) {
+        return false;
+    }
+
+    if(!csv->mapping) {
+        HF_CSV_writer* writer = hf_csv_writer_open(filename);
+        if(!writer) {
+            return false;
+        }
+
+        writer->dialect = csv->dialect;
+        bool success = hf_csv_writer_write_csv(writer, csv);
+        return hf_csv_writer_close(writer) && success;
+    }
+
+    //values may still point into the mapped file, which could be filename itself. Contents are written aside and then replace it
+    size_t temp_size;
+    char* temp_filename = hf_csv__temp_filename(csv, filename, &temp_size);
+    if(!temp_filename) {
+        return false;
+    }
+
+    HF_CSV_writer* writer = hf_csv_writer_open(temp_filename);
+    if(!writer) {
+        hf_csv__free(&csv->allocator, temp_filename, temp_size);
+        return false;
+    }
+    writer->dialect = csv->dialect;
+    bool success = hf_csv_writer_write_csv(writer, csv);
+    success = hf_csv_writer_close(writer) && success;
+    success = hf_csv__replace_file(temp_filename, filename, success);
+    hf_csv__free(&csv->allocator, temp_filename, temp_size);
+    return success;
+}
+
+static inline uint64_t hf_csv__cell_hash(const HF_CSV__cell* cell) {
+    return cell->value ? hf_csv__hash(cell->value, cell->length) : hf_csv__hash("", 0);
+}
+
+static inline HF_CSV__cell* hf_csv__index_cell(HF_CSV* csv, const HF_CSV__index* index, size_t position) {
+    return index->by_row ? &csv->values[index->line][position] : &csv->values[position][index->line];
+}
+
+//compares the value at position of an index line, reading it in place while csv is a loaded snapshot
+static inline bool hf_csv__index_equals(HF_CSV* csv, const HF_CSV__index* index, size_t position, const char* value, size_t length) {
+    if(csv->snapshot_offsets) {
+        size_t row = index->by_row ? index->line : position;
+        size_t column = index->by_row ? position : index->line;
+        const uint64_t* offset = &csv->snapshot_offsets[row * csv->columns + column];
+        return offset[1] - offset[0] - 1 == length && memcmp(csv->snapshot_blob + offset[0], value, length) == 0;
+    }
+    return hf_csv__cell_equals(hf_csv__index_cell(csv, index, position), value, length);
+}
+
+static void hf_csv__index_insert_entry(HF_CSV__index* index, uint64_t hash, size_t position) {
+    size_t mask = index->capacity - 1;
+    size_t slot = (size_t)hash & mask;
+    while(index->entries[slot].position != 0 && index->entries[slot].position != HF_CSV__INDEX_TOMBSTONE) {
+        slot = (slot + 1) & mask;
+    }
+    if(index->entries[slot].position == 0) {
+        index->used++;
+    }
+    index->entries[slot].hash = hash;
+    index->entries[slot].position = position + 1;
+}
+
+//rehashes index into a table able to hold count cells. Returns false if allocation failed, leaving index untouched
+static bool hf_csv__index_rehash(HF_CSV* csv, HF_CSV__index* index, size_t count) {
+    size_t capacity = 16;
+    while(capacity < count * 2) {
+        capacity *= 2;
+    }
+
+    HF_CSV__index_entry* entries = (HF_CSV__index_entry*)hf_csv__alloc(&csv->allocator, sizeof(HF_CSV__index_entry) * capacity);
+    if(!entries) {
+        return false;
+    }
+    memset(entries, 0, sizeof(HF_CSV__index_entry) * capacity);
+
+    HF_CSV__index_entry* old_entries = index->entries;
+    size_t old_capacity = index->capacity;
+    index->entries = entries;
+    index->capacity = capacity;
+    index->used = 0;
+    for(size_t i = 0; i < old_capacity; i++) {
+        size_t position = old_entries[i].position;
+        if(position != 0 && position != HF_CSV__INDEX_TOMBSTONE) {
+            hf_csv__index_insert_entry(index, old_entries[i].hash, position - 1);
+        }
+    }
+    hf_csv__free(&csv->allocator, old_entries, sizeof(HF_CSV__index_entry) * old_capacity);
+    return true;
+}
+
+//fills index with every cell of its line. Returns false if allocation failed
+static bool hf_csv__index_fill(HF_CSV* csv, HF_CSV__index* index, size_t* duplicates) {
+    size_t count = index->by_row ? csv->columns : csv->rows;
+    hf_csv__free(&csv->allocator, index->entries, sizeof(HF_CSV__index_entry) * index->capacity);
+    index->entries = NULL;
+    index->capacity = 0;
+    if(!hf_csv__index_rehash(csv, index, count)) {
+        return false;
+    }
+
+    size_t mask = index->capacity - 1;
+    size_t duplicate_count = 0;
+    for(size_t position = 0; position < count; position++) {
+        const HF_CSV__cell* cell = hf_csv__index_cell(csv, index, position);
+        uint64_t hash = hf_csv__cell_hash(cell);
+
+        //look for an equal value already inserted, then insert at the first free slot of the sequence
+        size_t slot = (size_t)hash & mask;
+        bool duplicate = false;
+        while(index->entries[slot].position != 0) {
+            if(!duplicate && index->entries[slot].hash == hash) {
+                const HF_CSV__cell* other = hf_csv__index_cell(csv, index, index->entries[slot].position - 1);
+                duplicate = hf_csv__cell_equals(other, cell->value ? cell->value : "", cell->value ? cell->length : 0);
+            }
+            slot = (slot + 1) & mask;
+        }
+        index->entries[slot].hash = hash;
+        index->entries[slot].position = position + 1;
+        index->used++;
+        duplicate_count += duplicate;
+    }
+
+    if(duplicates) {
+        *duplicates = duplicate_count;
+    }
+    return true;
+}
+
+static void hf_csv__index_drop(HF_CSV* csv, HF_CSV__index* index) {
+    HF_CSV__index** link = &csv->indexes;
+    while(*link != index) {
+        link = &(*link)->next;
+    }
+    *link = index->next;
+    hf_csv__free(&csv->allocator, index->entries, sizeof(HF_CSV__index_entry) * index->capacity);
+    hf_csv__free(&csv->allocator, index, sizeof(HF_CSV__index));
+}
+
+static HF_CSV__index* hf_csv__index_find(HF_CSV* csv, bool by_row, size_t line) {
+    for(HF_CSV__index* index = csv->indexes; index; index = index->next) {
+        if(index->by_row == by_row && index->line == line) {
+            return index;
+        }
+    }
+    return NULL;
+}
+
+//finds lowest position holding length bytes of value. Returns false if not found
+static bool hf_csv__index_lookup(HF_CSV* csv, const HF_CSV__index* index, const char* value, size_t length, size_t* position_ptr) {
+    uint64_t hash = hf_csv__hash(value, length);
+    size_t mask = index->capacity - 1;
+    size_t found = 0;
+    for(size_t slot = (size_t)hash & mask; index->entries[slot].position != 0; slot = (slot + 1) & mask) {
+        size_t position = index->entries[slot].position;
+        if(position == HF_CSV__INDEX_TOMBSTONE || index->entries[slot].hash != hash || (found != 0 && position > found)) {
+            continue;
+        }
+        if(hf_csv__index_equals(csv, index, position - 1, value, length)) {
+            found = position;
+        }
+    }
+
+    if(found == 0) {
+        return false;
+    }
+    *position_ptr = found - 1;
+    return true;
+}
+
+//removes the entries of the cell at row and column from every index covering it
+static void hf_csv__indexes_remove(HF_CSV* csv, size_t row, size_t column) {
+    for(HF_CSV__index* index = csv->indexes; index; index = index->next) {
+        if(index->line != (index->by_row ? row : column)) {
+            continue;
+        }
+        size_t position = (index->by_row ? column : row) + 1;
+        uint64_t hash = hf_csv__cell_hash(&csv->values[row][column]);
+        size_t mask = index->capacity - 1;
+        for(size_t slot = (size_t)hash & mask; index->entries[slot].position != 0; slot = (slot + 1) & mask) {
+            if(index->entries[slot].position == position) {
+                index->entries[slot].position = HF_CSV__INDEX_TOMBSTONE;
+                break;
+            }
+        }
+    }
+}
+
+//inserts the cell at row and column into every index covering it. Indexes that fail to grow are dropped, searches then fall back to linear scans
+static void hf_csv__indexes_insert(HF_CSV* csv, size_t row, size_t column) {
+    HF_CSV__index* index = csv->indexes;
+    while(index) {
+        HF_CSV__index* next = index->next;
+        if(index->line == (index->by_row ? row : column)) {
+            size_t count = index->by_row ? csv->columns : csv->rows;
+            if((index->used + 1) * 2 > index->capacity && !hf_csv__index_rehash(csv, index, count)) {
+                hf_csv__index_drop(csv, index);
+            }
+            else {
+                hf_csv__index_insert_entry(index, hf_csv__cell_hash(&csv->values[row][column]), index->by_row ? column : row);
+            }
+        }
+        index = next;
+    }
+}
+
+static bool hf_csv__build_index(HF_CSV* csv, bool by_row, size_t line, size_t* duplicates) {
+    if(!csv || line >= (by_row ? csv->rows : csv->columns)) {
+        return false;
+    }
+    if(!hf_csv__materialize(csv)) {
+        return false;
+    }
+
+    HF_CSV__index* index = hf_csv__index_find(csv, by_row, line);
+    if(!index) {
+        index = (HF_CSV__index*)hf_csv__alloc(&csv->allocator, sizeof(HF_CSV__index));
+        if(!index) {
+            return false;
+        }
+        memset(index, 0, sizeof(HF_CSV__index));
+        index->by_row = by_row;
+        index->line = line;
+        index->next = csv->indexes;
+        csv->indexes = index;
+    }
+
+    if(!hf_csv__index_fill(csv, index, duplicates)) {
+        hf_csv__index_drop(csv, index);
+        return false;
+    }
+    return true;
+}
+
+bool hf_csv_build_index(HF_CSV* csv, size_t column, size_t* duplicates) {
+    return hf_csv__build_index(csv, false, column, duplicates);
+}
+
+bool hf_csv_build_row_index(HF_CSV* csv, size_t row, size_t* duplicates) {
+    return hf_csv__build_index(csv, true, row, duplicates);
+}
+
+bool hf_csv_encode_column(HF_CSV* csv, size_t column, size_t* distinct) {
+    if(!csv || column >= csv->columns) {
+        return false;
+    }
+    if(!hf_csv__materialize(csv) || !hf_csv__detach(csv) || !hf_csv__dictionaries_reserve(csv, column + 1)) {
+        return false;
+    }
+
+    HF_CSV__dictionary* dictionary = csv->dictionaries[column];
+    if(!dictionary) {
+        dictionary = hf_csv__dictionary_create(csv);
+        if(!dictionary) {
+            return false;
+        }
+        //arena values become dictionary values in place, others are copied once per distinct value
+        size_t row = 0;
+        for(; row < csv->rows; row++) {
+            HF_CSV__cell* cell = &csv->values[row][column];
+            if(!cell->value) {
+                continue;
+            }
+            uint32_t code = hf_csv__dictionary_intern(csv, dictionary, cell->value, cell->length, !cell->view && !cell->owned);
+            if(code == 0) {
+                break;
+            }
+            hf_csv__dictionary_assign(csv, dictionary, cell, code);
+        }
+        if(row < csv->rows) {//values already encoded keep pointing to dictionary values, which stay in the arena
+            for(size_t encoded = 0; encoded < row; encoded++) {
+                csv->values[encoded][column].code = 0;
+            }
+            hf_csv__dictionary_free(csv, dictionary);
+            return false;
+        }
+        csv->dictionaries[column] = dictionary;
+    }
+
+    if(distinct) {
+        *distinct = dictionary->count;
+    }
+    return true;
+}
+
+bool hf_csv_find_row(HF_CSV* csv, size_t column, const char* value, size_t* row) {
+    if(!csv || column >= csv->columns) {
+        return false;
+    }
+
+    //indexes of a loaded snapshot are searched in place
+    size_t length = strlen(value);
+    HF_CSV__index* index = hf_csv__index_find(csv, false, column);
+    if(index) {
+        size_t found;
+        if(!hf_csv__index_lookup(csv, index, value, length, &found)) {
+            return false;
+        }
+        if(row) {
+            *row = found;
+        }
+        return true;
+    }
+
+    if(!hf_csv__materialize(csv)) {
+        return false;
+    }
+
+    //values of encoded columns are compared by code. Cells never set have none, and equal the empty string
+    HF_CSV__dictionary* dictionary = hf_csv__dictionary_of(csv, column);
+    if(dictionary) {
+        size_t slot;
+        uint32_t code = hf_csv__dictionary_find(dictionary, value, length, hf_csv__hash(value, length), &slot);
+        if(code == 0 && length != 0) {
+            return false;
+        }
+        for(size_t r = 0; r < csv->rows; r++) {
+            const HF_CSV__cell* cell = &csv->values[r][column];
+            if(cell->code == code || (length == 0 && !cell->value)) {
+                if(row) {
+                    *row = r;
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+    for(size_t r = 0; r < csv->rows; r++) {
+        if(hf_csv__cell_equals(&csv->values[r][column], value, length)) {
+            if(row) {
+                *row = r;
+            }
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool hf_csv_find_column(HF_CSV* csv, size_t row, const char* value, size_t* column) {
+    if(!csv || row >= csv->rows) {
+        return false;
+    }
+
+    //indexes of a loaded snapshot are searched in place
+    size_t length = strlen(value);
+    HF_CSV__index* index = hf_csv__index_find(csv, true, row);
+    if(index) {
+        size_t found;
+        if(!hf_csv__index_lookup(csv, index, value, length, &found)) {
+            return false;
+        }
+        if(column) {
+            *column = found;
+        }
+        return true;
+    }
+
+    if(!hf_csv__materialize(csv)) {
+        return false;
+    }
+
+    for(size_t c = 0; c < csv->columns; c++) {
+        if(hf_csv__cell_equals(&csv->values[row][c], value, length)) {
+            if(column) {
+                *column = c;
+            }
+            return true;
+        }
+    }
+
+    return false;
+}
+
+#ifndef HF_CSV__JOIN_BATCH
+#define HF_CSV__JOIN_BATCH 16
+#endif
+
+//right row of a join hash table, holding its key so probes don't have to go through the row
+typedef struct HF_CSV__join_entry_s {
+    uint64_t hash;
+    const char* key;
+    size_t length;
+    size_t next;//next right row plus one of the same bucket, 0 at the end of the chain
+    bool matched;//some left row matched it, so its values are copied to the result
+} HF_CSV__join_entry;
+
+//state of a join. right is hashed on its key column, with rows of a bucket chained in ascending order, then left is probed in chunks of rows
+typedef struct HF_CSV__join_s {
+    HF_CSV* left;
+    size_t left_column;
+    HF_CSV* right;
+    size_t right_column;
+    HF_CSV_join_kind kind;
+    size_t left_first;//first row of left that is joined, 1 if it is a header
+    size_t* heads;//first right row plus one of every bucket, 0 for empty buckets
+    HF_CSV__join_entry* entries;//by right row
+    size_t mask;
+    size_t* matches;//first matching right row plus one of every joined left row, 0 if none, found while counting and followed while filling
+    const HF_CSV__cell* right_cells;//copies in the result of the values of matched right rows, by right row
+    size_t chunk_rows;
+    size_t* chunk_rows_out;//rows and bytes of left values of every chunk in the result, then their offsets
+    size_t* chunk_bytes;
+    HF_CSV* result;
+    char* arena;//values of left rows in the result
+} HF_CSV__join;
+
+static inline bool hf_csv__join_projects_right(HF_CSV_join_kind kind) {
+    return kind == HF_CSV_JOIN_INNER || kind == HF_CSV_JOIN_LEFT;
+}
+
+//returns the first right row plus one, from position on along its chain, whose key equals length bytes of key. 0 if there is none
+static inline size_t hf_csv__join_match(const HF_CSV__join* join, size_t position, uint64_t hash, const char* key, size_t length) {
+    for(; position != 0; position = join->entries[position - 1].next) {
+        const HF_CSV__join_entry* entry = &join->entries[position - 1];
+        if(entry->hash == hash && entry->length == length && memcmp(entry->key, key, length) == 0) {
+            return position;
+        }
+    }
+    return 0;
+}
+
+//returns the rows of the result made from a left row with matches matching right rows
+static inline size_t hf_csv__join_rows_out(HF_CSV_join_kind kind, size_t matches) {
+    switch(kind) {
+    case HF_CSV_JOIN_INNER:
+        return matches;
+    case HF_CSV_JOIN_LEFT:
+        return matches > 0 ? matches : 1;
+    case HF_CSV_JOIN_SEMI:
+        return matches > 0 ? 1 : 0;
+    default:
+        return matches > 0 ? 0 : 1;
+    }
+}
+
+//probes left rows in batches: every bucket of a batch is prefetched, then every first entry, before any chain is followed
+static void hf_csv__join_count_task(void* context, size_t index) {
+    HF_CSV__join* join = (HF_CSV__join*)context;
+    HF_CSV* left = join->left;
+    size_t first_row = join->left_first + index * join->chunk_rows;
+    size_t end_row = first_row + join->chunk_rows < left->rows ? first_row + join->chunk_rows : left->rows;
+    size_t rows_out = 0;
+    size_t bytes = 0;
+    uint64_t hashes[HF_CSV__JOIN_BATCH];
+    size_t positions[HF_CSV__JOIN_BATCH];
+    for(size_t batch = first_row; batch < end_row; batch += HF_CSV__JOIN_BATCH) {
+        size_t count = end_row - batch < HF_CSV__JOIN_BATCH ? end_row - batch : HF_CSV__JOIN_BATCH;
+        for(size_t i = 0; i < count; i++) {
+            hashes[i] = hf_csv__cell_hash(&left->values[batch + i][join->left_column]);
+            HF_CSV__PREFETCH(&join->heads[(size_t)hashes[i] & join->mask]);
+        }
+        for(size_t i = 0; i < count; i++) {
+            positions[i] = join->heads[(size_t)hashes[i] & join->mask];
+            if(positions[i] != 0) {
+                HF_CSV__PREFETCH(&join->entries[positions[i] - 1]);
+            }
+        }
+
+        for(size_t i = 0; i < count; i++) {
+            const HF_CSV__cell* key = &left->values[batch + i][join->left_column];
+            const char* value = key->value ? key->value : "";
+            size_t length = key->value ? key->length : 0;
+            size_t position = hf_csv__join_match(join, positions[i], hashes[i], value, length);
+            join->matches[batch + i - join->left_first] = position;
+            //semi and anti joins only need to know if there is a match
+            size_t matches = position != 0;
+            while(position != 0 && hf_csv__join_projects_right(join->kind)) {
+                position = hf_csv__join_match(join, join->entries[position - 1].next, hashes[i], value, length);
+                matches += position != 0;
+            }
+            size_t row_count = hf_csv__join_rows_out(join->kind, matches);
+            if(row_count > 0) {
+                rows_out += row_count;
+                bytes += hf_csv__cells_size(left->values[batch + i], left->columns);
+            }
+        }
+    }
+    join->chunk_rows_out[index] = rows_out;
+    join->chunk_bytes[index] = bytes;
+}
+
+//flags the right rows matched by some left row. Every left row with a key matches from the first right row of that key on, so each chain of matches is walked once
+static void hf_csv__join_mark(HF_CSV__join* join, size_t left_rows) {
+    for(size_t row = 0; row < left_rows; row++) {
+        size_t position = join->matches[row];
+        if(position == 0 || join->entries[position - 1].matched) {
+            continue;
+        }
+        const HF_CSV__join_entry* entry = &join->entries[position - 1];
+        for(; position != 0; position = hf_csv__join_match(join, join->entries[position - 1].next, entry->hash, entry->key, entry->length)) {
+            join->entries[position - 1].matched = true;
+        }
+    }
+}
+
+//values of a left row are copied once, to its first row in the result, and shared by the following ones
+static void hf_csv__join_fill_task(void* context, size_t index) {
+    HF_CSV__join* join = (HF_CSV__join*)context;
+    HF_CSV* left = join->left;
+    HF_CSV* result = join->result;
+    size_t first_row = join->left_first + index * join->chunk_rows;
+    size_t end_row = first_row + join->chunk_rows < left->rows ? first_row + join->chunk_rows : left->rows;
+    size_t right_columns = result->columns - left->columns;
+    size_t out = join->left_first + join->chunk_rows_out[index];
+    char* arena = join->arena + join->chunk_bytes[index];
+    for(size_t row = first_row; row < end_row; row++) {
+        size_t position = join->matches[row - join->left_first];
+        if(hf_csv__join_rows_out(join->kind, position != 0) == 0) {
+            continue;
+        }
+
+        HF_CSV__cell* first = result->values[out];
+        arena = hf_csv__copy_cells(left->values[row], left->columns, first, arena);
+        if(right_columns == 0) {
+            out++;
+            continue;
+        }
+        if(position == 0) {//left join without match
+            memset(first + left->columns, 0, sizeof(HF_CSV__cell) * right_columns);
+            out++;
+            continue;
+        }
+        const HF_CSV__join_entry* entry = &join->entries[position - 1];
+        for(; position != 0; position = hf_csv__join_match(join, join->entries[position - 1].next, entry->hash, entry->key, entry->length)) {
+            HF_CSV__cell* cells = result->values[out++];
+            if(cells != first) {
+                memcpy(cells, first, sizeof(HF_CSV__cell) * left->columns);
+            }
+            memcpy(cells + left->columns, join->right_cells + (position - 1) * right_columns, sizeof(HF_CSV__cell) * right_columns);
+        }
+    }
+}
+
+//hashes the key column of right. Returns false if allocation failed
+static bool hf_csv__join_build(HF_CSV__join* join, const HF_CSV_allocator* allocator, size_t right_first) {
+    HF_CSV* right = join->right;
+    size_t buckets = 16;
+    while(buckets < right->rows * 2) {
+        buckets *= 2;
+    }
+    join->mask = buckets - 1;
+    join->heads = (size_t*)hf_csv__alloc(allocator, sizeof(size_t) * buckets);
+    join->entries = (HF_CSV__join_entry*)hf_csv__alloc(allocator, sizeof(HF_CSV__join_entry) * right->rows);
+    if(!join->heads || !join->entries) {
+        return false;
+    }
+    memset(join->heads, 0, sizeof(size_t) * buckets);
+
+    //rows are pushed in reverse, so every bucket chains them in ascending order
+    for(size_t row = right->rows; row > right_first; row--) {
+        const HF_CSV__cell* key = &right->values[row - 1][join->right_column];
+        HF_CSV__join_entry* entry = &join->entries[row - 1];
+        entry->hash = hf_csv__cell_hash(key);
+        entry->key = key->value ? key->value : "";
+        entry->length = key->value ? key->length : 0;
+        entry->matched = false;
+        size_t bucket = (size_t)entry->hash & join->mask;
+        entry->next = join->heads[bucket];
+        join->heads[bucket] = row;
+    }
+    return true;
+}
+
+static void hf_csv__join_free(HF_CSV__join* join, const HF_CSV_allocator* allocator, size_t chunk_count) {
+    hf_csv__free(allocator, join->heads, sizeof(size_t) * (join->mask + 1));
+    hf_csv__free(allocator, join->entries, sizeof(HF_CSV__join_entry) * join->right->rows);
+    hf_csv__free(allocator, join->matches, sizeof(size_t) * (join->left->rows - join->left_first));
+    hf_csv__free(allocator, (void*)join->right_cells, sizeof(HF_CSV__cell) * join->right->rows * join->right->columns);
+    hf_csv__free(allocator, join->chunk_rows_out, sizeof(size_t) * chunk_count);
+    hf_csv__free(allocator, join->chunk_bytes, sizeof(size_t) * chunk_count);
+}
+
+//allocates the result of a join with every row and value storage, leaving cells uninitialized. Returns NULL if allocation failed
+static HF_CSV* hf_csv__join_result(const HF_CSV_allocator* allocator, size_t rows, size_t columns, size_t bytes, char** arena_ptr) {
+    HF_CSV* result = hf_csv__alloc_csv(allocator);
+    if(!result) {
+        return NULL;
+    }
+    result->values = (HF_CSV__cell**)hf_csv__alloc(allocator, sizeof(HF_CSV__cell*) * rows);
+    HF_CSV__cell* cells = (HF_CSV__cell*)hf_csv__alloc_block(result, &result->row_blocks, sizeof(HF_CSV__cell) * rows * columns);
+    *arena_ptr = (char*)hf_csv__alloc_block(result, &result->blocks, bytes);
+    if(!result->values || !cells || !*arena_ptr) {
+        hf_csv__free(allocator, result->values, sizeof(HF_CSV__cell*) * rows);
+        result->values = NULL;
+        hf_csv_destroy(result);
+        return NULL;
+    }
+    result->rows = rows;
+    result->columns = columns;
+    result->row_capacity = rows;
+    result->column_capacity = columns;
+    for(size_t row = 0; row < rows; row++) {
+        result->values[row] = cells + row * columns;
+    }
+    return result;
+}
+
+HF_CSV* hf_csv_join(HF_CSV* left, size_t left_column, HF_CSV* right, size_t right_column, HF_CSV_join_kind kind) {
+    return hf_csv_join_parallel(left, left_column, right, right_column, kind, 1);
+}
+
+HF_CSV* hf_csv_join_parallel(HF_CSV* left, size_t left_column, HF_CSV* right, size_t right_column, HF_CSV_join_kind kind, size_t threads) {
+    if(!left || !right || left_column >= left->columns || right_column >= right->columns || kind < HF_CSV_JOIN_INNER || kind > HF_CSV_JOIN_ANTI) {
+        return NULL;
+    }
+    if(!hf_csv__materialize(left) || !hf_csv__materialize(right)) {
+        return NULL;
+    }
+
+    const HF_CSV_allocator* allocator = &left->allocator;
+    HF_CSV__join join;
+    memset(&join, 0, sizeof(HF_CSV__join));
+    join.left = left;
+    join.left_column = left_column;
+    join.right = right;
+    join.right_column = right_column;
+    join.kind = kind;
+    join.left_first = left->dialect.header ? 1 : 0;
+    size_t right_first = right->dialect.header ? 1 : 0;
+    size_t right_columns = hf_csv__join_projects_right(kind) ? right->columns : 0;
+
+    size_t left_rows = left->rows - join.left_first;
+    size_t chunk_count = left_rows / HF_CSV__MIN_CHUNK_ROWS;
+    if(chunk_count > threads) {
+        chunk_count = threads;
+    }
+    if(chunk_count == 0) {
+        chunk_count = 1;
+    }
+    join.chunk_rows = (left_rows + chunk_count - 1) / chunk_count;
+    chunk_count = join.chunk_rows ? (left_rows + join.chunk_rows - 1) / join.chunk_rows : 0;
+    join.chunk_rows_out = (size_t*)hf_csv__alloc(allocator, sizeof(size_t) * chunk_count);
+    join.chunk_bytes = (size_t*)hf_csv__alloc(allocator, sizeof(size_t) * chunk_count);
+    join.matches = (size_t*)hf_csv__alloc(allocator, sizeof(size_t) * left_rows);
+    if((chunk_count > 0 && (!join.chunk_rows_out || !join.chunk_bytes || !join.matches)) || !hf_csv__join_build(&join, allocator, right_first)) {
+        hf_csv__join_free(&join, allocator, chunk_count);
+        return NULL;
+    }
+    hf_csv__parallel_for(allocator, chunk_count, threads, hf_csv__join_count_task, &join);
+
+    //the header row is made of both headers, and values of right rows are copied once however many rows match them, unmatched ones never
+    size_t rows = join.left_first;
+    size_t bytes = join.left_first ? hf_csv__cells_size(left->values[0], left->columns) : 0;
+    if(right_columns > 0) {
+        hf_csv__join_mark(&join, left_rows);
+        if(join.left_first && right_first && right->rows > 0) {
+            bytes += hf_csv__cells_size(right->values[0], right->columns);
+        }
+        for(size_t row = right_first; row < right->rows; row++) {
+            bytes += join.entries[row].matched ? hf_csv__cells_size(right->values[row], right->columns) : 0;
+        }
+    }
+    for(size_t i = 0; i < chunk_count; i++) {
+        size_t chunk_rows = join.chunk_rows_out[i];
+        size_t chunk_bytes = join.chunk_bytes[i];
+        join.chunk_rows_out[i] = rows - join.left_first;
+        join.chunk_bytes[i] = bytes;
+        rows += chunk_rows;
+        bytes += chunk_bytes;
+    }
+    if(rows == 0) {//a csv always has at least one row
+        hf_csv__join_free(&join, allocator, chunk_count);
+        return NULL;
+    }
+
+    HF_CSV* result = hf_csv__join_result(allocator, rows, left->columns + right_columns, bytes, &join.arena);
+    HF_CSV__cell* right_cells = right_columns > 0 ? (HF_CSV__cell*)hf_csv__alloc(allocator, sizeof(HF_CSV__cell) * right->rows * right->columns) : NULL;
+    join.right_cells = right_cells;
+    if(!result || (right_columns > 0 && !right_cells)) {
+        hf_csv_destroy(result);
+        hf_csv__join_free(&join, allocator, chunk_count);
+        return NULL;
+    }
+
+    char* arena = join.arena;
+    if(join.left_first) {
+        arena = hf_csv__copy_cells(left->values[0], left->columns, result->values[0], arena);
+        if(right_columns > 0) {
+            memset(result->values[0] + left->columns, 0, sizeof(HF_CSV__cell) * right_columns);
+        }
+    }
+    if(right_columns > 0) {
+        if(join.left_first && right_first && right->rows > 0) {
+            arena = hf_csv__copy_cells(right->values[0], right->columns, result->values[0] + left->columns, arena);
+        }
+        for(size_t row = right_first; row < right->rows; row++) {
+            if(join.entries[row].matched) {
+                arena = hf_csv__copy_cells(right->values[row], right->columns, right_cells + row * right->columns, arena);
+            }
+        }
+    }
+    join.result = result;
+    hf_csv__parallel_for(allocator, chunk_count, threads, hf_csv__join_fill_task, &join);
+
+    hf_csv__join_free(&join, allocator, chunk_count);
+    result->dialect = left->dialect;
+    return result;
+}
+
+#define HF_CSV__SNAPSHOT_VERSION 1
+#define HF_CSV__SNAPSHOT_BYTE_ORDER 0x01020304u
+#define HF_CSV__SNAPSHOT_TOMBSTONE UINT64_MAX
+#define HF_CSV__SNAPSHOT_SEED 0x9E3779B97F4A7C15ull
+
+//start of a snapshot file. It is followed by rows * columns + 1 cell offsets into the blob, the blob holding every value null-terminated, and the indexes.
+//Every index is a record of 4 words (by_row, line, capacity, used) followed by capacity entries of 2 words (hash, position).
+//Fields are written in the byte order of the machine, and every section is aligned to 8 bytes so the file can be used in place once mapped
+typedef struct HF_CSV__snapshot_header_s {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;//HF_CSV__SNAPSHOT_BYTE_ORDER as seen by the writer
+    uint64_t rows;
+    uint64_t columns;
+    uint64_t blob_size;//padded to a multiple of 8
+    uint64_t index_count;
+    uint64_t data_checksum;//of everything after the header
+    uint64_t header_checksum;//of the fields above
+} HF_CSV__snapshot_header;
+
+static const char hf_csv__snapshot_magic[8] = {'H', 'F', 'C', 'S', 'V', 'S', 'N', 'P'};
+
+//mixes size bytes of data into checksum, 8 at a time. size must be a multiple of 8
+static uint64_t hf_csv__checksum(uint64_t checksum, const char* data, size_t size) {
+    for(size_t i = 0; i < size; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        checksum = (checksum ^ word) * 0xFF51AFD7ED558CCDull;
+        checksum ^= checksum >> 32;
+    }
+    return checksum;
+}
+
+//buffered output of a snapshot, checksumming data as it is flushed. Only the last flush may write less than a full buffer
+typedef struct HF_CSV__snapshot_writer_s {
+    FILE* file;
+    char* buffer;
+    size_t filled;
+    uint64_t checksum;
+    bool error;
+} HF_CSV__snapshot_writer;
+
+static void hf_csv__snapshot_flush(HF_CSV__snapshot_writer* writer) {
+    writer->checksum = hf_csv__checksum(writer->checksum, writer->buffer, writer->filled);
+    if(writer->filled > 0 && fwrite(writer->buffer, 1, writer->filled, writer->file) != writer->filled) {
+        writer->error = true;
+    }
+    writer->filled = 0;
+}
+
+static void hf_csv__snapshot_put(HF_CSV__snapshot_writer* writer, const void* data, size_t size) {
+    const char* itr = (const char*)data;
+    while(size > 0) {
+        size_t chunk = HF_CSV__WRITER_BUFFER_SIZE - writer->filled;
+        if(chunk > size) {
+            chunk = size;
+        }
+        memcpy(writer->buffer + writer->filled, itr, chunk);
+        writer->filled += chunk;
+        itr += chunk;
+        size -= chunk;
+        if(writer->filled == HF_CSV__WRITER_BUFFER_SIZE) {
+            hf_csv__snapshot_flush(writer);
+        }
+    }
+}
+
+static inline void hf_csv__snapshot_put_word(HF_CSV__snapshot_writer* writer, uint64_t word) {
+    hf_csv__snapshot_put(writer, &word, sizeof(word));
+}
+
+//writes every section after the header. Returns the padded blob size through blob_size_ptr
+static void hf_csv__snapshot_write_data(HF_CSV* csv, HF_CSV__snapshot_writer* writer, uint64_t* blob_size_ptr) {
+    uint64_t offset = 0;
+    for(size_t row = 0; row < csv->rows; row++) {
+        for(size_t column = 0; column < csv->columns; column++) {
+            hf_csv__snapshot_put_word(writer, offset);
+            const HF_CSV__cell* cell = &csv->values[row][column];
+            offset += (cell->value ? cell->length : 0) + 1;
+        }
+    }
+    hf_csv__snapshot_put_word(writer, offset);
+
+    for(size_t row = 0; row < csv->rows; row++) {
+        for(size_t column = 0; column < csv->columns; column++) {
+            const HF_CSV__cell* cell = &csv->values[row][column];
+            if(cell->value) {
+                hf_csv__snapshot_put(writer, cell->value, cell->length);
+            }
+            hf_csv__snapshot_put(writer, "", 1);
+        }
+    }
+    static const char padding[8] = {0};
+    hf_csv__snapshot_put(writer, padding, (size_t)((8 - offset % 8) % 8));
+    *blob_size_ptr = (offset + 7) / 8 * 8;
+
+    for(const HF_CSV__index* index = csv->indexes; index; index = index->next) {
+        hf_csv__snapshot_put_word(writer, index->by_row);
+        hf_csv__snapshot_put_word(writer, index->line);
+        hf_csv__snapshot_put_word(writer, index->capacity);
+        hf_csv__snapshot_put_word(writer, index->used);
+        for(size_t i = 0; i < index->capacity; i++) {
+            size_t position = index->entries[i].position;
+            hf_csv__snapshot_put_word(writer, index->entries[i].hash);
+            hf_csv__snapshot_put_word(writer, position == HF_CSV__INDEX_TOMBSTONE ? HF_CSV__SNAPSHOT_TOMBSTONE : position);
+        }
+    }
+}
+
+bool hf_csv_save_snapshot(HF_CSV* csv, const char* filename) {
+    if(!csv || !filename) {
+        return false;
+    }
+    if(!hf_csv__materialize(csv)) {
+        return false;
+    }
+
+    size_t temp_size;
+    char* temp_filename = hf_csv__temp_filename(csv, filename, &temp_size);
+    if(!temp_filename) {
+        return false;
+    }
+    HF_CSV__snapshot_writer writer;
+    memset(&writer, 0, sizeof(writer));
+    writer.buffer = (char*)hf_csv__alloc(&csv->allocator, HF_CSV__WRITER_BUFFER_SIZE);
+    writer.file = writer.buffer ? hf_csv__fopen(temp_filename, "wb") : NULL;
+    if(!writer.file) {
+        hf_csv__free(&csv->allocator, writer.buffer, HF_CSV__WRITER_BUFFER_SIZE);
+        hf_csv__free(&csv->allocator, temp_filename, temp_size);
+        return false;
+    }
+
+    //the header is written last, once the checksum of the data is known
+    HF_CSV__snapshot_header header;
+    memset(&header, 0, sizeof(header));
+    writer.error = fseek(writer.file, (long)sizeof(header), SEEK_SET) != 0;
+    writer.checksum = HF_CSV__SNAPSHOT_SEED;
+    hf_csv__snapshot_write_data(csv, &writer, &header.blob_size);
+    hf_csv__snapshot_flush(&writer);
+
+    memcpy(header.magic, hf_csv__snapshot_magic, sizeof(header.magic));
+    header.version = HF_CSV__SNAPSHOT_VERSION;
+    header.byte_order = HF_CSV__SNAPSHOT_BYTE_ORDER;
+    header.rows = csv->rows;
+    header.columns = csv->columns;
+    for(const HF_CSV__index* index = csv->indexes; index; index = index->next) {
+        header.index_count++;
+    }
+    header.data_checksum = writer.checksum;
+    header.header_checksum = hf_csv__hash((const char*)&header, offsetof(HF_CSV__snapshot_header, header_checksum));
+    if(fseek(writer.file, 0, SEEK_SET) != 0 || fwrite(&header, 1, sizeof(header), writer.file) != sizeof(header)) {
+        writer.error = true;
+    }
+    if(fclose(writer.file) != 0) {
+        writer.error = true;
+    }
+
+    bool success = hf_csv__replace_file(temp_filename, filename, !writer.error);
+    hf_csv__free(&csv->allocator, writer.buffer, HF_CSV__WRITER_BUFFER_SIZE);
+    hf_csv__free(&csv->allocator, temp_filename, temp_size);
+    return success;
+}
+
+//checks every value offset and index entry of a snapshot against the layout. Only done when verifying, since it reads the whole file
+static bool hf_csv__snapshot_verify(const HF_CSV* csv, const char* end) {
+    const HF_CSV__snapshot_header* header = (const HF_CSV__snapshot_header*)csv->mapping;
+    if(hf_csv__checksum(HF_CSV__SNAPSHOT_SEED, (const char*)(header + 1), (size_t)(end - (const char*)(header + 1))) != header->data_checksum) {
+        return false;
+    }
+
+    size_t cells = csv->rows * csv->columns;
+    for(size_t i = 0; i < cells; i++) {
+        uint64_t offset = csv->snapshot_offsets[i];
+        uint64_t next = csv->snapshot_offsets[i + 1];
+        if(next <= offset || csv->snapshot_blob[next - 1] != '\0') {
+            return false;
+        }
+    }
+
+    for(const HF_CSV__index* index = csv->indexes; index; index = index->next) {
+        size_t count = index->by_row ? csv->columns : csv->rows;
+        size_t used = 0;
+        for(size_t i = 0; i < index->capacity; i++) {
+            size_t position = index->entries[i].position;
+            if(position != HF_CSV__INDEX_TOMBSTONE && position > count) {
+                return false;
+            }
+            used += position != 0;
+        }
+        if(used != index->used) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//links the indexes stored from position on to csv, in place if entries have the same layout in memory. Returns the position after them, or 0 if they don't fit the file
+static size_t hf_csv__snapshot_load_indexes(HF_CSV* csv, size_t position, size_t size, uint64_t index_count) {
+    const char* mapping = (const char*)csv->mapping;
+    for(uint64_t i = 0; i < index_count; i++) {
+        if(size - position < 4 * sizeof(uint64_t)) {
+            return 0;
+        }
+        uint64_t record[4];
+        memcpy(record, mapping + position, sizeof(record));
+        position += sizeof(record);
+        uint64_t by_row = record[0];
+        uint64_t line = record[1];
+        uint64_t capacity = record[2];
+        uint64_t used = record[3];
+        //lookups stop at empty entries, so at least one must exist
+        if(by_row > 1 || line >= (by_row ? csv->rows : csv->columns) || capacity == 0 || (capacity & (capacity - 1)) != 0 || used >= capacity || capacity > (size - position) / 16) {
+            return 0;
+        }
+
+        HF_CSV__index* index = (HF_CSV__index*)hf_csv__alloc(&csv->allocator, sizeof(HF_CSV__index));
+        if(!index) {
+            return 0;
+        }
+        memset(index, 0, sizeof(HF_CSV__index));
+        index->by_row = by_row != 0;
+        index->line = (size_t)line;
+        index->capacity = (size_t)capacity;
+        index->used = (size_t)used;
+        index->next = csv->indexes;
+        csv->indexes = index;
+
+        if(sizeof(HF_CSV__index_entry) == 16 && sizeof(size_t) == sizeof(uint64_t)) {
+            index->entries = (HF_CSV__index_entry*)(mapping + position);
+            index->mapped = true;
+        }
+        else {
+            index->entries = (HF_CSV__index_entry*)hf_csv__alloc(&csv->allocator, sizeof(HF_CSV__index_entry) * index->capacity);
+            if(!index->entries) {
+                return 0;
+            }
+            for(size_t entry = 0; entry < index->capacity; entry++) {
+                uint64_t words[2];
+                memcpy(words, mapping + position + entry * 16, sizeof(words));
+                index->entries[entry].hash = words[0];
+                index->entries[entry].position = words[1] == HF_CSV__SNAPSHOT_TOMBSTONE ? HF_CSV__INDEX_TOMBSTONE : (size_t)words[1];
+            }
+        }
+        position += index->capacity * 16;
+    }
+    return position;
+}
+
+HF_CSV* hf_csv_load_snapshot(const char* filename, bool verify) {
+    return hf_csv_load_snapshot_with_allocator(filename, verify, NULL);
+}
+
+HF_CSV* hf_csv_load_snapshot_with_allocator(const char* filename, bool verify, const HF_CSV_allocator* allocator) {
+    void* mapping;
+    size_t size;
+    if(!filename || !hf_csv__map_file(filename, &mapping, &size)) {
+        return NULL;
+    }
+    const HF_CSV__snapshot_header* header = (const HF_CSV__snapshot_header*)mapping;
+    if(size < sizeof(HF_CSV__snapshot_header) || memcmp(header->magic, hf_csv__snapshot_magic, sizeof(header->magic)) != 0 ||
+       header->version != HF_CSV__SNAPSHOT_VERSION || header->byte_order != HF_CSV__SNAPSHOT_BYTE_ORDER ||
+       header->header_checksum != hf_csv__hash((const char*)header, offsetof(HF_CSV__snapshot_header, header_checksum))) {
+        hf_csv__unmap_file(mapping, size);
+        return NULL;
+    }
+
+    //every cell takes at least 9 bytes (offset and terminator), which bounds the sizes below without overflowing
+    uint64_t rows = header->rows;
+    uint64_t columns = header->columns;
+    if(rows == 0 || columns == 0 || rows > size / 9 / columns) {
+        hf_csv__unmap_file(mapping, size);
+        return NULL;
+    }
+    size_t cells = (size_t)(rows * columns);
+    size_t blob_position = sizeof(HF_CSV__snapshot_header) + (cells + 1) * sizeof(uint64_t);
+    const uint64_t* offsets = (const uint64_t*)(header + 1);
+    if(blob_position > size || header->blob_size > size - blob_position || header->blob_size % 8 != 0 || offsets[0] != 0 || offsets[cells] > header->blob_size) {
+        hf_csv__unmap_file(mapping, size);
+        return NULL;
+    }
+
+    HF_CSV* new_csv = hf_csv__alloc_csv(allocator);
+    if(!new_csv) {
+        hf_csv__unmap_file(mapping, size);
+        return NULL;
+    }
+    new_csv->mapping = mapping;
+    new_csv->mapping_size = size;
+    new_csv->rows = (size_t)rows;
+    new_csv->columns = (size_t)columns;
+    new_csv->snapshot_offsets = offsets;
+    new_csv->snapshot_blob = (const char*)mapping + blob_position;
+
+    size_t end = hf_csv__snapshot_load_indexes(new_csv, blob_position + (size_t)header->blob_size, size, header->index_count);
+    if(end != size || (verify && !hf_csv__snapshot_verify(new_csv, (const char*)mapping + size))) {
+        hf_csv_destroy(new_csv);
+        return NULL;
+    }
+    return new_csv;
+}
+
+static inline bool hf_csv__is_little_endian(void) {
+    const uint16_t value = 1;
+    unsigned char first;
+    memcpy(&first, &value, 1);
+    return first == 1;
+}
+
+//reads 8 bytes as a little endian integer, so the first character is the lowest byte
+static inline uint64_t hf_csv__load_le64(const char* string) {
+    uint64_t value;
+    memcpy(&value, string, sizeof(value));
+    if(!hf_csv__is_little_endian()) {
+        uint64_t swapped = 0;
+        for(int i = 0; i < 8; i++) {
+            swapped = (swapped << 8) | ((value >> (i * 8)) & 0xFF);
+        }
+        value = swapped;
+    }
+    return value;
+}
+
+//checks 8 characters at once, returning true if all of them are digits
+static inline bool hf_csv__is_eight_digits(uint64_t chunk) {
+    return (((chunk & 0xF0F0F0F0F0F0F0F0ull) | (((chunk + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) == 0x3333333333333333ull);
+}
+
+//converts 8 digits at once, combining pairs, then quads, then both halves with multiplications
+static inline uint32_t hf_csv__parse_eight_digits(uint64_t chunk) {
+    chunk -= 0x3030303030303030ull;
+    chunk = (chunk * 10) + (chunk >> 8);
+    chunk = (((chunk & 0x000000FF000000FFull) * (100 + (1000000ull << 32))) + (((chunk >> 16) & 0x000000FF000000FFull) * (1 + (10000ull << 32)))) >> 32;
+    return (uint32_t)chunk;
+}
+
+//accumulates digits into mantissa, 8 at a time while possible. Digits that don't fit 19 decimal places are counted in dropped but not accumulated.
+//Returns the number of digits consumed.
+static size_t hf_csv__parse_digits(const char* string, const char* end, uint64_t* mantissa, size_t* digits, size_t* dropped) {
+    const char* itr = string;
+    while(end - itr >= 8 && *digits + 8 <= 19) {
+        uint64_t chunk = hf_csv__load_le64(itr);
+        if(!hf_csv__is_eight_digits(chunk)) {
+            break;
+        }
+        uint32_t eight = hf_csv__parse_eight_digits(chunk);
+        if(*mantissa == 0) {//leading zeros are not significant
+            for(uint32_t rest = eight; rest != 0; rest /= 10) {
+                (*digits)++;
+            }
+        }
+        else {
+            *digits += 8;
+        }
+        *mantissa = *mantissa * 100000000u + eight;
+        itr += 8;
+    }
+    while(itr < end && *itr >= '0' && *itr <= '9') {
+        if(*digits < 19) {
+            *mantissa = *mantissa * 10 + (uint64_t)(*itr - '0');
+            if(*mantissa != 0) {
+                (*digits)++;
+            }
+        }
+        else {
+            (*dropped)++;
+        }
+        itr++;
+    }
+    return (size_t)(itr - string);
+}
+
+static bool hf_csv__parse_int64(const char* string, size_t length, int64_t* value_ptr) {
+    const char* end = string + length;
+    bool negative = length > 0 && *string == '-';
+    if(length > 0 && (*string == '-' || *string == '+')) {
+        string++;
+    }
+
+    uint64_t mantissa = 0;
+    size_t digits = 0;
+    size_t dropped = 0;
+    size_t consumed = hf_csv__parse_digits(string, end, &mantissa, &digits, &dropped);
+    if(consumed == 0 || string + consumed != end || dropped > 0) {
+        return false;
+    }
+    if(mantissa > (uint64_t)INT64_MAX + (negative ? 1u : 0u)) {
+        return false;
+    }
+    *value_ptr = negative ? (int64_t)(0 - mantissa) : (int64_t)mantissa;
+    return true;
+}
+
+//the decimal point printf and strtod use under the current locale, "." in the C locale
+static const char* hf_csv__decimal_point(void) {
+    const char* point = localeconv()->decimal_point;
+    return point && point[0] ? point : ".";
+}
+
+static bool hf_csv__parse_double(const char* string, size_t length, double* value_ptr) {
+    static const double powers[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+    };
+    const char* start = string;
+    const char* end = string + length;
+    bool negative = length > 0 && *string == '-';
+    if(length > 0 && (*string == '-' || *string == '+')) {
+        string++;
+    }
+
+    uint64_t mantissa = 0;
+    size_t digits = 0;
+    size_t dropped = 0;
+    size_t integer_digits = hf_csv__parse_digits(string, end, &mantissa, &digits, &dropped);
+    string += integer_digits;
+    //integer digits beyond precision scale the value up, accumulated fraction digits scale it down
+    long exponent = (long)dropped;
+    size_t fraction_digits = 0;
+    if(string < end && *string == '.') {
+        string++;
+        dropped = 0;
+        fraction_digits = hf_csv__parse_digits(string, end, &mantissa, &digits, &dropped);
+        string += fraction_digits;
+        exponent -= (long)(fraction_digits - dropped);
+    }
+    if(integer_digits + fraction_digits == 0) {
+        return false;
+    }
+    if(string < end && (*string == 'e' || *string == 'E')) {
+        string++;
+        bool negative_exponent = string < end && *string == '-';
+        if(string < end && (*string == '-' || *string == '+')) {
+            string++;
+        }
+        long written = 0;
+        const char* exponent_start = string;
+        while(string < end && *string >= '0' && *string <= '9') {
+            if(written < 100000) {
+                written = written * 10 + (*string - '0');
+            }
+            string++;
+        }
+        if(string == exponent_start) {
+            return false;
+        }
+        exponent += negative_exponent ? -written : written;
+    }
+    if(string != end) {
+        return false;
+    }
+
+    //exact when both mantissa and power of ten are representable, otherwise rounding is left to strtod
+    if(mantissa <= (1ull << 53) && exponent >= -22 && exponent <= 22) {
+        double value = (double)mantissa;
+        value = exponent < 0 ? value / powers[-exponent] : value * powers[exponent];
+        *value_ptr = negative ? -value : value;
+        return true;
+    }
+
+    //strtod reads the decimal point of the locale, so it replaces '.' in a terminated copy, on the heap when the value is long
+    const char* point = hf_csv__decimal_point();
+    size_t point_length = strlen(point);
+    char buffer[128];
+    char* copy = length + point_length <= sizeof(buffer) ? buffer : (char*)malloc(length + point_length);
+    if(!copy) {
+        return false;
+    }
+    size_t written = 0;
+    for(string = start; string < end; string++) {
+        if(*string == '.') {
+            memcpy(copy + written, point, point_length);
+            written += point_length;
+        }
+        else {
+            copy[written++] = *string;
+        }
+    }
+    copy[written] = '\0';
+    *value_ptr = strtod(copy, NULL);
+    if(copy != buffer) {
+        free(copy);
+    }
+    return true;
+}
+
+//mapped values are not null-terminated, so the first request copies one to the arena of csv, owning cell. The copy is published atomically
+//while holding the view lock, so threads reading csv at once never see a cell half updated nor copy the same value twice.
+//Returns NULL if allocation failed
+static const char* hf_csv__terminate_view(HF_CSV* csv, HF_CSV__cell* cell) {
+    uintptr_t start = (uintptr_t)csv->mapping;
+    char* value = (char*)hf_csv__atomic_load((void* volatile*)&cell->value);
+    if((uintptr_t)value - start > csv->mapping_size) {//copied already
+        return value;
+    }
+
+    hf_csv__mutex_lock(&csv->view_lock->mutex);
+    value = cell->value;
+    if((uintptr_t)value - start <= csv->mapping_size) {
+        char* copy = hf_csv__arena_alloc(csv, cell->length + 1);
+        if(copy) {
+            if(cell->length > 0) {//empty files have no mapping to copy from
+                memcpy(copy, value, cell->length);
+            }
+            copy[cell->length] = '\0';
+            hf_csv__atomic_store((void* volatile*)&cell->value, copy);
+        }
+        value = copy;
+    }
+    hf_csv__mutex_unlock(&csv->view_lock->mutex);
+    return value;
+}
+
+const char* hf_csv_get_value(HF_CSV* csv, size_t row, size_t column) {
+    if(!csv || row >= csv->rows || column >= csv->columns) {
+        return NULL;
+    }
+    if(csv->lazy || csv->snapshot_offsets) {//decoded rows and snapshot blobs are always null-terminated
+        return hf_csv_get_value_n(csv, row, column, NULL);
+    }
+
+    HF_CSV__cell* cell = &csv->values[row][column];
+    if(cell->view) {//cells of views belong to their source
+        return hf_csv__terminate_view(csv->source ? csv->source : csv, cell);
+    }
+    return cell->value ? cell->value : "";
+}
+
+const char* hf_csv_get_value_n(HF_CSV* csv, size_t row, size_t column, size_t* length) {
+    if(!csv || row >= csv->rows || column >= csv->columns) {
+        return NULL;
+    }
+
+    if(csv->snapshot_offsets) {
+        const uint64_t* offset = &csv->snapshot_offsets[row * csv->columns + column];
+        if(length) {
+            *length = (size_t)(offset[1] - offset[0] - 1);
+        }
+        return csv->snapshot_blob + offset[0];
+    }
+
+    //mapped values are returned in place, length makes termination unnecessary
+    const HF_CSV__cell* cell = NULL;
+    if(csv->lazy) {
+        const HF_CSV__cell* cells = hf_csv__lazy_row(csv, row);
+        if(!cells) {
+            return NULL;
+        }
+        cell = &cells[column];
+    }
+    else {
+        cell = &csv->values[row][column];
+    }
+    //hf_csv_get_value may be replacing a mapped value by its copy meanwhile, either is fine
+    const char* value = cell->view ? (const char*)hf_csv__atomic_load((void* volatile*)&cell->value) : cell->value;
+    if(length) {
+        *length = value ? cell->length : 0;
+    }
+    return value ? value : "";
+}
+
+bool hf_csv_set_value(HF_CSV* csv, size_t row, size_t column, const char* value) {
+    if(!value) {
+        return false;
+    }
+    return hf_csv_set_value_n(csv, row, column, value, strlen(value));
+}
+
+bool hf_csv_set_value_n(HF_CSV* csv, size_t row, size_t column, const char* value, size_t length) {
+    if(!csv || !value || row >= csv->rows || column >= csv->columns) {
+        return false;
+    }
+    if(!hf_csv__materialize(csv) || !hf_csv__detach(csv)) {
+        return false;
+    }
+
+    HF_CSV__cell* cell = &csv->values[row][column];
+    HF_CSV__dictionary* dictionary = hf_csv__dictionary_of(csv, column);
+    if(dictionary) {//values of encoded columns are only copied the first time they are set
+        uint32_t code = hf_csv__dictionary_intern(csv, dictionary, value, length, false);
+        if(code == 0) {
+            return false;
+        }
+        hf_csv__indexes_remove(csv, row, column);
+        hf_csv__dictionary_assign(csv, dictionary, cell, code);
+        hf_csv__indexes_insert(csv, row, column);
+        hf_csv__typed_invalidate(csv, column);
+        return true;
+    }
+
+    size_t new_size = length + 1;
+    hf_csv__indexes_remove(csv, row, column);
+    //arena values can't be resized, so cell gets its own allocation
+    char* new_str = cell->owned ? (char*)hf_csv__realloc(&csv->allocator, cell->value, cell->length + 1, new_size) : (char*)hf_csv__alloc(&csv->allocator, new_size);
+    if(!new_str) {
+        hf_csv__indexes_insert(csv, row, column);
+        return false;
+    }
+    if(!cell->owned) {
+        cell->owned = true;
+        csv->owned_count++;
+    }
+    cell->view = false;
+    cell->value = new_str;
+    cell->length = length;
+    memcpy(cell->value, value, length);
+    cell->value[length] = '\0';
+    hf_csv__indexes_insert(csv, row, column);
+    hf_csv__typed_invalidate(csv, column);
+
+    return true;
+}
+
+bool hf_csv_get_size(HF_CSV* csv, size_t* rows, size_t* columns) {
+    if(!csv) {
+        return false;
+    }
+
+    if(rows) {
+        *rows = csv->rows;
+    }
+    if(columns) {
+        *columns = csv->columns;
+    }
+    return true;
+}
+
+//frees values owned by count cells and leaves them empty
+static void hf_csv__clear_cells(HF_CSV* csv, HF_CSV__cell* cells, size_t count) {
+    for(size_t i = 0; i < count; i++) {
+        if(cells[i].owned) {
+            hf_csv__free(&csv->allocator, cells[i].value, cells[i].length + 1);
+            csv->owned_count--;
+        }
+    }
+    memset(cells, 0, sizeof(HF_CSV__cell) * count);
+}
+
+//makes room for at least rows row pointers, growing geometrically
+static bool hf_csv__reserve_rows(HF_CSV* csv, size_t rows) {
+    if(rows <= csv->row_capacity) {
+        return true;
+    }
+
+    size_t capacity = csv->row_capacity + csv->row_capacity / 2;
+    if(capacity < rows) {
+        capacity = rows;
+    }
+    HF_CSV__cell** values = (HF_CSV__cell**)hf_csv__realloc(&csv->allocator, csv->values, sizeof(HF_CSV__cell*) * csv->row_capacity, sizeof(HF_CSV__cell*) * capacity);
+    if(!values) {
+        return false;
+    }
+    csv->values = values;
+    csv->row_capacity = capacity;
+    return true;
+}
+
+//takes empty storage for a new row, reusing storage of deleted rows first. Row blocks are allocated for half as many rows as csv already has
+static HF_CSV__cell* hf_csv__take_row(HF_CSV* csv) {
+    HF_CSV__cell* cells;
+    if(csv->free_row_count > 0) {
+        cells = csv->free_rows[--csv->free_row_count];
+    }
+    else {
+        if(csv->spare_rows == 0) {
+            size_t block_rows = csv->rows / 2 > 16 ? csv->rows / 2 : 16;
+            csv->spare_cells = (HF_CSV__cell*)hf_csv__alloc_block(csv, &csv->row_blocks, sizeof(HF_CSV__cell) * csv->column_capacity * block_rows);
+            if(!csv->spare_cells) {
+                return NULL;
+            }
+            csv->spare_rows = block_rows;
+        }
+        cells = csv->spare_cells;
+        csv->spare_cells += csv->column_capacity;
+        csv->spare_rows--;
+    }
+
+    memset(cells, 0, sizeof(HF_CSV__cell) * csv->column_capacity);
+    return cells;
+}
+
+//keeps storage of a removed row for later reuse. Its values must have been cleared
+static void hf_csv__give_row(HF_CSV* csv, HF_CSV__cell* cells) {
+    if(csv->free_row_count == csv->free_row_capacity) {
+        size_t capacity = csv->free_row_capacity ? csv->free_row_capacity * 2 : 16;
+        HF_CSV__cell** free_rows = (HF_CSV__cell**)hf_csv__realloc(&csv->allocator, csv->free_rows, sizeof(HF_CSV__cell*) * csv->free_row_capacity, sizeof(HF_CSV__cell*) * capacity);
+        if(!free_rows) {//storage is simply not reused
+            return;
+        }
+        csv->free_rows = free_rows;
+        csv->free_row_capacity = capacity;
+    }
+    csv->free_rows[csv->free_row_count++] = cells;
+}
+
+//moves every row into storage able to hold column_capacity cells. Cells are moved, values keep their memory
+static bool hf_csv__widen_rows(HF_CSV* csv, size_t column_capacity) {
+    HF_CSV__block* row_blocks = NULL;
+    HF_CSV__cell* cells = (HF_CSV__cell*)hf_csv__alloc_block(csv, &row_blocks, sizeof(HF_CSV__cell) * column_capacity * csv->row_capacity);
+    if(!cells) {
+        return false;
+    }
+
+    for(size_t row = 0; row < csv->rows; row++) {
+        HF_CSV__cell* new_row = cells + row * column_capacity;
+        memcpy(new_row, csv->values[row], sizeof(HF_CSV__cell) * csv->columns);
+        memset(new_row + csv->columns, 0, sizeof(HF_CSV__cell) * (column_capacity - csv->columns));
+        csv->values[row] = new_row;
+    }
+
+    //old storage is no longer referenced, remaining capacity of the new block becomes spare rows
+    hf_csv__free_blocks(csv, csv->row_blocks);
+    csv->row_blocks = row_blocks;
+    csv->column_capacity = column_capacity;
+    csv->spare_cells = cells + csv->rows * column_capacity;
+    csv->spare_rows = csv->row_capacity - csv->rows;
+    csv->free_row_count = 0;
+    return true;
+}
+
+//refills every index after cells changed position. Indexes that can't be refilled are dropped
+static void hf_csv__indexes_refill(HF_CSV* csv) {
+    HF_CSV__index* index = csv->indexes;
+    while(index) {
+        HF_CSV__index* next = index->next;
+        if(index->line >= (index->by_row ? csv->rows : csv->columns) || !hf_csv__index_fill(csv, index, NULL)) {
+            hf_csv__index_drop(csv, index);
+        }
+        index = next;
+    }
+}
+
+//appends count empty rows. Returns false if allocation failed, leaving csv untouched
+static bool hf_csv__append_rows(HF_CSV* csv, size_t count) {
+    if(!hf_csv__reserve_rows(csv, csv->rows + count)) {
+        return false;
+    }
+
+    for(size_t i = 0; i < count; i++) {
+        HF_CSV__cell* cells = hf_csv__take_row(csv);
+        if(!cells) {
+            for(; i > 0; i--) {
+                hf_csv__give_row(csv, csv->values[--csv->rows]);
+            }
+            return false;
+        }
+        csv->values[csv->rows++] = cells;
+    }
+    return true;
+}
+
+static void hf_csv__delete_rows(HF_CSV* csv, size_t row, size_t count) {
+    for(size_t i = row; i < row + count; i++) {
+        hf_csv__clear_cells(csv, csv->values[i], csv->columns);
+        hf_csv__give_row(csv, csv->values[i]);
+    }
+    memmove(csv->values + row, csv->values + row + count, sizeof(HF_CSV__cell*) * (csv->rows - row - count));
+    csv->rows -= count;
+}
+
+bool hf_csv_resize(HF_CSV* csv, size_t rows, size_t columns) {
+    if(!csv || rows == 0 || columns == 0 || (rows == csv->rows && columns == csv->columns)) {
+        return false;
+    }
+    if(!hf_csv__materialize(csv) || !hf_csv__detach(csv)) {
+        return false;
+    }
+
+    //grow first so a failed allocation leaves csv untouched
+    if(columns > csv->column_capacity && !hf_csv__widen_rows(csv, columns)) {
+        return false;
+    }
+    if(rows > csv->rows && !hf_csv__append_rows(csv, rows - csv->rows)) {
+        return false;
+    }
+
+    if(rows < csv->rows) {
+        hf_csv__delete_rows(csv, rows, csv->rows - rows);
+    }
+    if(columns < csv->columns) {
+        for(size_t row = 0; row < csv->rows; row++) {
+            hf_csv__clear_cells(csv, csv->values[row] + columns, csv->columns - columns);
+        }
+        for(size_t column = columns; column < csv->dictionary_count; column++) {
+            hf_csv__dictionary_free(csv, csv->dictionaries[column]);
+            csv->dictionaries[column] = NULL;
+        }
+    }
+    csv->columns = columns;
+
+    //indexes whose line still exists are rebuilt, others are dropped
+    hf_csv__indexes_refill(csv);
+    hf_csv__typed_invalidate(csv, SIZE_MAX);
+    return true;
+}
+
+bool hf_csv_append_row(HF_CSV* csv) {
+    if(!csv) {
+        return false;
+    }
+    if(!hf_csv__materialize(csv) || !hf_csv__detach(csv) || !hf_csv__append_rows(csv, 1)) {
+        return false;
+    }
+
+    //new empty values only need to be added to column indexes
+    for(size_t column = 0; column < csv->columns && csv->indexes; column++) {
+        hf_csv__indexes_insert(csv, csv->rows - 1, column);
+    }
+    hf_csv__typed_invalidate(csv, SIZE_MAX);
+    return true;
+}
+
+bool hf_csv_insert_column(HF_CSV* csv, size_t column) {
+    if(!csv || column > csv->columns) {
+        return false;
+    }
+    if(!hf_csv__materialize(csv) || !hf_csv__detach(csv)) {
+        return false;
+    }
+
+    //dictionaries of the following columns move along with them
+    if(column < csv->dictionary_count && !hf_csv__dictionaries_reserve(csv, csv->dictionary_count + 1)) {
+        return false;
+    }
+    if(csv->columns == csv->column_capacity) {
+        size_t capacity = csv->column_capacity + csv->column_capacity / 2 + 1;
+        if(!hf_csv__widen_rows(csv, capacity)) {
+            return false;
+        }
+    }
+    if(column < csv->dictionary_count) {
+        memmove(csv->dictionaries + column + 1, csv->dictionaries + column, sizeof(HF_CSV__dictionary*) * (csv->dictionary_count - column - 1));
+        csv->dictionaries[column] = NULL;
+    }
+
+    for(size_t row = 0; row < csv->rows; row++) {
+        HF_CSV__cell* cells = csv->values[row];
+        memmove(cells + column + 1, cells + column, sizeof(HF_CSV__cell) * (csv->columns - column));
+        memset(cells + column, 0, sizeof(HF_CSV__cell));
+    }
+    csv->columns++;
+
+    for(HF_CSV__index* index = csv->indexes; index; index = index->next) {
+        if(!index->by_row && index->line >= column) {
+            index->line++;
+        }
+    }
+    hf_csv__indexes_refill(csv);
+    hf_csv__typed_invalidate(csv, SIZE_MAX);
+    return true;
+}
+
+bool hf_csv_delete_rows(HF_CSV* csv, size_t row, size_t count) {
+    //a csv always keeps at least one row
+    if(!csv || count == 0 || row >= csv->rows || count > csv->rows - row || count == csv->rows) {
+        return false;
+    }
+    if(!hf_csv__materialize(csv) || !hf_csv__detach(csv)) {
+        return false;
+    }
+
+    hf_csv__delete_rows(csv, row, count);
+
+    HF_CSV__index* index = csv->indexes;
+    while(index) {
+        HF_CSV__index* next = index->next;
+        if(index->by_row && index->line >= row) {
+            if(index->line < row + count) {
+                hf_csv__index_drop(csv, index);
+            }
+            else {
+                index->line -= count;
+            }
+        }
+        index = next;
+    }
+    hf_csv__indexes_refill(csv);
+    hf_csv__typed_invalidate(csv, SIZE_MAX);
+    return true;
+}
+
+//finds where the first and last rows completed in string end, i.e. past newlines outside quotes, 0 if none is. in_quotes tells if string
+//starts inside quotes, and is updated to tell if it ends inside them, so a file can be scanned a block at a time
+static void hf_csv__scan_rows(const char* string, size_t size, char delimiter, char quote, uint64_t* in_quotes, size_t* first_ptr, size_t* last_ptr) {
+    hf_csv__select_classifier();
+
+    size_t first = 0;
+    size_t last = 0;
+    for(size_t block_start = 0; block_start < size; block_start += 64) {
+        const char* block = string + block_start;
+        char padded[64];
+        if(size - block_start < 64) {
+            memset(padded, 0, sizeof(padded));
+            memcpy(padded, block, size - block_start);
+            block = padded;
+        }
+
+        HF_CSV__block_masks masks;
+        hf_csv__classify(block, delimiter, quote, &masks);
+        uint64_t quoted = hf_csv__prefix_xor(quote != '\0' ? masks.quotes : 0) ^ *in_quotes;
+        *in_quotes = (quoted >> 63) ? ~(uint64_t)0 : 0;
+        uint64_t newlines = masks.newlines & ~quoted;
+        if(newlines && first == 0) {
+            first = block_start + hf_csv__ctz64(newlines) + 1;
+        }
+        while(newlines) {
+            last = block_start + hf_csv__ctz64(newlines) + 1;
+            newlines &= newlines - 1;
+        }
+    }
+    //padding holds no quotes (zeros only match a disabled quote), so the state at the end of the last block is the state at the end of string
+    *first_ptr = first;
+    *last_ptr = last;
+}
+
+//returns the size of the rows of string ending with a line break, i.e. up to the last newline outside quotes. 0 if no row is complete yet
+static size_t hf_csv__complete_rows_size(const char* string, size_t size) {
+    uint64_t in_quotes = 0;
+    size_t first;
+    size_t complete;
+    hf_csv__scan_rows(string, size, ',', '\"', &in_quotes, &first, &complete);
+    return complete;
+}
+
+//seeks file to offset, saving its size. Returns false if file is shorter than offset or can't be seeked
+static bool hf_csv__seek_file(FILE* file, uint64_t offset, uint64_t* size_ptr) {
+#ifdef _WIN32
+    if(_fseeki64(file, 0, SEEK_END) != 0) {
+        return false;
+    }
+    __int64 size = _ftelli64(file);
+    if(size < 0 || (uint64_t)size < offset) {
+        return false;
+    }
+    *size_ptr = (uint64_t)size;
+    return _fseeki64(file, (__int64)offset, SEEK_SET) == 0;
+#else
+    if(fseeko(file, 0, SEEK_END) != 0) {
+        return false;
+    }
+    off_t size = ftello(file);
+    if(size < 0 || (uint64_t)size < offset) {
+        return false;
+    }
+    *size_ptr = (uint64_t)size;
+    return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+HF_CSV* hf_csv_create_from_file_tail(const char* filename) {
+    return hf_csv_create_from_file_tail_with_allocator(filename, NULL);
+}
+
+HF_CSV* hf_csv_create_from_file_tail_with_allocator(const char* filename, const HF_CSV_allocator* allocator) {
+    if(!filename) {
+        return NULL;
+    }
+    void* mapping;
+    size_t size;
+    if(!hf_csv__map_file(filename, &mapping, &size)) {
+        return NULL;
+    }
+
+    size_t complete = hf_csv__complete_rows_size((const char*)mapping, size);
+    HF_CSV* new_csv = complete > 0 ? hf_csv__create_from_buffer(allocator, (const char*)mapping, complete, true, NULL) : NULL;
+    size_t filename_size = strlen(filename) + 1;
+    char* tail_filename = new_csv && hf_csv__view_lock_create(new_csv) ? (char*)hf_csv__alloc(&new_csv->allocator, filename_size) : NULL;
+    if(!tail_filename) {
+        hf_csv_destroy(new_csv);
+        hf_csv__unmap_file(mapping, size);
+        return NULL;
+    }
+    memcpy(tail_filename, filename, filename_size);
+    new_csv->mapping = mapping;
+    new_csv->mapping_size = size;
+    new_csv->tail_filename = tail_filename;
+    new_csv->tail_offset = complete;
+    return new_csv;
+}
+
+//moves the rows of parsed after the rows of csv. Cells are copied into row storage of csv, values stay in the arenas of parsed, which are handed over
+static bool hf_csv__adopt_rows(HF_CSV* csv, HF_CSV* parsed) {
+    if(!hf_csv__reserve_rows(csv, csv->rows + parsed->rows)) {
+        return false;
+    }
+    for(size_t row = 0; row < parsed->rows; row++) {
+        HF_CSV__cell* cells = hf_csv__take_row(csv);
+        if(!cells) {
+            for(; row > 0; row--) {
+                hf_csv__give_row(csv, csv->values[--csv->rows]);
+            }
+            return false;
+        }
+        memcpy(cells, parsed->values[row], sizeof(HF_CSV__cell) * csv->columns);
+        csv->values[csv->rows++] = cells;
+        //new values of encoded columns are copied, since the arenas of parsed are only handed over once every row is adopted
+        for(size_t column = 0; column < csv->dictionary_count; column++) {
+            HF_CSV__dictionary* dictionary = csv->dictionaries[column];
+            uint32_t code = dictionary ? hf_csv__dictionary_intern(csv, dictionary, cells[column].value, cells[column].length, false) : 1;
+            if(code == 0) {
+                for(row++; row > 0; row--) {
+                    hf_csv__give_row(csv, csv->values[--csv->rows]);
+                }
+                return false;
+            }
+            if(dictionary) {
+                hf_csv__dictionary_assign(csv, dictionary, &cells[column], code);
+            }
+        }
+    }
+    hf_csv__splice_blocks(&csv->blocks, parsed->blocks);
+    parsed->blocks = NULL;
+    return true;
+}
+
+bool hf_csv_refresh(HF_CSV* csv, size_t* added_rows) {
+    if(!csv || !csv->tail_filename) {
+        return false;
+    }
+    if(added_rows) {
+        *added_rows = 0;
+    }
+
+    FILE* file = hf_csv__fopen(csv->tail_filename, "rb");
+    if(!file) {
+        return false;
+    }
+    uint64_t file_size;
+    if(!hf_csv__seek_file(file, csv->tail_offset, &file_size) || file_size - csv->tail_offset > (size_t)-1 - 1) {
+        fclose(file);
+        return false;
+    }
+    size_t size = (size_t)(file_size - csv->tail_offset);
+    if(size == 0) {
+        fclose(file);
+        return true;
+    }
+
+    //only bytes past the last refresh are read. A partial row at the end is read again by the next refresh
+    char* buffer = (char*)hf_csv__alloc(&csv->allocator, size);
+    if(!buffer) {
+        fclose(file);
+        return false;
+    }
+    size = fread(buffer, 1, size, file);
+    fclose(file);
+    size_t complete = hf_csv__complete_rows_size(buffer, size);
+    if(complete == 0) {
+        hf_csv__free(&csv->allocator, buffer, (size_t)(file_size - csv->tail_offset));
+        return true;
+    }
+
+    HF_CSV* parsed = hf_csv__create_from_buffer(&csv->allocator, buffer, complete, false, NULL);
+    hf_csv__free(&csv->allocator, buffer, (size_t)(file_size - csv->tail_offset));
+    if(!parsed) {
+        return false;
+    }
+    size_t first_row = csv->rows;
+    bool success = parsed->columns == csv->columns && hf_csv__adopt_rows(csv, parsed);
+    hf_csv_destroy(parsed);
+    if(!success) {
+        return false;
+    }
+
+    for(size_t row = first_row; row < csv->rows && csv->indexes; row++) {
+        for(size_t column = 0; column < csv->columns; column++) {
+            hf_csv__indexes_insert(csv, row, column);
+        }
+    }
+    hf_csv__typed_invalidate(csv, SIZE_MAX);
+    csv->tail_offset += complete;
+    if(added_rows) {
+        *added_rows = csv->rows - first_row;
+    }
+    return true;
+}
+
+#ifndef HF_CSV__STREAM_BLOCK_SIZE
+#define HF_CSV__STREAM_BLOCK_SIZE (1 << 20)
+#endif
+#define HF_CSV__STREAM_MAX_READERS 16
+
+//state of a block of a streamed load, readers only refill free blocks and the parser only consumes ready ones
+typedef enum HF_CSV__stream_state_e {
+    HF_CSV__STREAM_FREE,
+    HF_CSV__STREAM_READING,
+    HF_CSV__STREAM_READY,
+    HF_CSV__STREAM_FAILED,
+} HF_CSV__stream_state;
+
+//file read by reader threads into a ring of blocks, block i of the file going to buffer i % slot_count, while the calling thread parses the blocks read
+typedef struct HF_CSV__stream_s {
+    FILE* file;
+    uint64_t size;
+    size_t block_count;
+    size_t slot_count;
+    char* buffers;
+    HF_CSV__stream_state* states;
+    size_t next_read;//next block a reader takes
+    size_t next_parse;//block the parser waits for. Readers stay within slot_count blocks of it
+    bool stop;
+    HF_CSV__mutex mutex;
+    HF_CSV__cond ready;//a block was read
+    HF_CSV__cond free;//a block was parsed, or reading stops
+
+    //parser side
+    const HF_CSV_allocator* allocator;
+    const HF_CSV_load_options* options;
+    const HF_CSV_dialect* dialect;
+    uint64_t in_quotes;//whether the bytes scanned so far end inside quotes
+    char* pending;//start of a row spanning blocks, completed by the next one ending a row
+    size_t pending_size;
+    size_t pending_capacity;
+    size_t rows_left;//rows still to parse if options have max_rows
+    HF_CSV* csv;
+} HF_CSV__stream;
+
+//reads size bytes of file at offset without moving its position, so several threads can read it at once. Returns false on errors and short reads
+static bool hf_csv__read_at(FILE* file, char* buffer, size_t size, uint64_t offset) {
+#ifdef _WIN32
+    HANDLE handle = (HANDLE)_get_osfhandle(_fileno(file));
+    while(size > 0) {
+        OVERLAPPED overlapped;
+        memset(&overlapped, 0, sizeof(overlapped));
+        overlapped.Offset = (DWORD)offset;
+        overlapped.OffsetHigh = (DWORD)(offset >> 32);
+        DWORD read = 0;
+        if(!ReadFile(handle, buffer, size < (1u << 30) ? (DWORD)size : (1u << 30), &read, &overlapped) || read == 0) {
+            return false;
+        }
+        buffer += read;
+        size -= read;
+        offset += read;
+    }
+#else
+    int descriptor = fileno(file);
+    while(size > 0) {
+        ssize_t read = pread(descriptor, buffer, size, (off_t)offset);
+        if(read <= 0) {
+            if(read < 0 && errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        buffer += read;
+        size -= (size_t)read;
+        offset += (uint64_t)read;
+    }
+#endif
+    return true;
+}
+
+static size_t hf_csv__stream_block_size(const HF_CSV__stream* stream, size_t block) {
+    uint64_t start = (uint64_t)block * HF_CSV__STREAM_BLOCK_SIZE;
+    return stream->size - start < HF_CSV__STREAM_BLOCK_SIZE ? (size_t)(stream->size - start) : HF_CSV__STREAM_BLOCK_SIZE;
+}
+
+//reads blocks in order of the file as long as their slot is free. Every reader keeps one read in flight
+static void hf_csv__stream_read_task(void* context, size_t index) {
+    (void)index;
+    HF_CSV__stream* stream = (HF_CSV__stream*)context;
+    hf_csv__mutex_lock(&stream->mutex);
+    while(true) {
+        while(!stream->stop && stream->next_read < stream->block_count && stream->next_read >= stream->next_parse + stream->slot_count) {
+            hf_csv__cond_wait(&stream->free, &stream->mutex);
+        }
+        if(stream->stop || stream->next_read >= stream->block_count) {
+            break;
+        }
+        size_t block = stream->next_read++;
+        size_t slot = block % stream->slot_count;
+        stream->states[slot] = HF_CSV__STREAM_READING;
+        hf_csv__mutex_unlock(&stream->mutex);
+
+        bool read = hf_csv__read_at(stream->file, stream->buffers + slot * HF_CSV__STREAM_BLOCK_SIZE, hf_csv__stream_block_size(stream, block), (uint64_t)block * HF_CSV__STREAM_BLOCK_SIZE);
+
+        hf_csv__mutex_lock(&stream->mutex);
+        stream->states[slot] = read ? HF_CSV__STREAM_READY : HF_CSV__STREAM_FAILED;
+        hf_csv__cond_broadcast(&stream->ready);
+    }
+    hf_csv__mutex_unlock(&stream->mutex);
+}
+
+#ifdef _WIN32
+static DWORD WINAPI hf_csv__stream_thread_main(LPVOID stream) {
+    hf_csv__stream_read_task(stream, 0);
+    return 0;
+}
+#else
+static void* hf_csv__stream_thread_main(void* stream) {
+    hf_csv__stream_read_task(stream, 0);
+    return NULL;
+}
+#endif
+
+static bool hf_csv__stream_thread_start(HF_CSV__thread* thread, HF_CSV__stream* stream) {
+#ifdef _WIN32
+    *thread = CreateThread(NULL, 0, hf_csv__stream_thread_main, stream, 0, NULL);
+    return *thread != NULL;
+#else
+    return pthread_create(thread, NULL, hf_csv__stream_thread_main, stream) == 0;
+#endif
+}
+
+//parses size bytes of complete rows and appends them to the rows parsed so far. Encoded columns are only set up by the first rows, later ones are interned as adopted
+static bool hf_csv__stream_parse(HF_CSV__stream* stream, const char* string, size_t size) {
+    if(stream->options && stream->options->max_rows > 0 && stream->rows_left == 0) {
+        return true;
+    }
+    HF_CSV_load_options options;
+    memset(&options, 0, sizeof(options));
+    if(stream->options) {
+        options = *stream->options;
+    }
+    options.dialect = stream->dialect;
+    options.max_rows = stream->rows_left;
+    if(stream->csv) {
+        options.dictionary_columns = NULL;
+        options.dictionary_column_count = 0;
+    }
+    HF_CSV* parsed = hf_csv__create_from_buffer(stream->allocator, string, size, false, &options);
+    if(!parsed) {
+        return false;
+    }
+    if(stream->options && stream->options->max_rows > 0) {
+        stream->rows_left -= parsed->rows < stream->rows_left ? parsed->rows : stream->rows_left;
+    }
+    if(!stream->csv) {
+        stream->csv = parsed;
+        return true;
+    }
+    bool adopted = parsed->columns == stream->csv->columns && hf_csv__adopt_rows(stream->csv, parsed);
+    hf_csv_destroy(parsed);
+    return adopted;
+}
+
+//appends bytes to the row pending from previous blocks, growing it geometrically
+static bool hf_csv__stream_pend(HF_CSV__stream* stream, const char* bytes, size_t size) {
+    if(size == 0) {
+        return true;
+    }
+    if(stream->pending_size + size > stream->pending_capacity) {
+        size_t capacity = stream->pending_capacity ? stream->pending_capacity * 2 : HF_CSV__STREAM_BLOCK_SIZE;
+        while(capacity < stream->pending_size + size) {
+            capacity *= 2;
+        }
+        char* pending = (char*)hf_csv__realloc(stream->allocator, stream->pending, stream->pending_capacity, capacity);
+        if(!pending) {
+            return false;
+        }
+        stream->pending = pending;
+        stream->pending_capacity = capacity;
+    }
+    memcpy(stream->pending + stream->pending_size, bytes, size);
+    stream->pending_size += size;
+    return true;
+}
+
+//completes the pending row with the start of block, parses the rows completed in block in place, and keeps the partial row at its end pending.
+//Quotes are tracked across blocks, so newlines of quoted values never end a row
+static bool hf_csv__stream_consume(HF_CSV__stream* stream, const char* block, size_t size) {
+    size_t first;
+    size_t last;
+    hf_csv__scan_rows(block, size, stream->dialect->delimiter, stream->dialect->quote, &stream->in_quotes, &first, &last);
+    size_t start = 0;
+    if(stream->pending_size > 0 && first > 0) {
+        if(!hf_csv__stream_pend(stream, block, first) || !hf_csv__stream_parse(stream, stream->pending, stream->pending_size)) {
+            return false;
+        }
+        stream->pending_size = 0;
+        start = first;
+    }
+    if(last > start && !hf_csv__stream_parse(stream, block + start, last - start)) {
+        return false;
+    }
+    start = last > start ? last : start;
+    return hf_csv__stream_pend(stream, block + start, size - start);
+}
+
+HF_CSV* hf_csv_create_from_file_streamed(const char* filename, size_t read_ahead, const HF_CSV_load_options* options) {
+    if(!filename) {
+        return NULL;
+    }
+    //rows can only be parsed apart with the block scanner, and without options depending on earlier rows. Kept columns are one of them,
+    //since rows are validated against the column count of the file which parsed chunks don't keep
+    const HF_CSV_dialect* dialect = options && options->dialect ? options->dialect : &hf_csv__dialect_csv;
+    if(options && (options->column_count > 0 || options->names || options->predicate || options->recovery != HF_CSV_RECOVERY_NONE || options->diagnostics || hf_csv__dialect_scalar(dialect) || !hf_csv__dialect_valid(dialect))) {
+        return hf_csv__create_from_mapped_file(options->allocator, filename, 1, options);
+    }
+
+    HF_CSV__stream stream;
+    memset(&stream, 0, sizeof(stream));
+    stream.file = hf_csv__fopen(filename, "rb");
+    if(!stream.file || !hf_csv__seek_file(stream.file, 0, &stream.size)) {
+        if(stream.file) {
+            fclose(stream.file);
+        }
+        return NULL;
+    }
+    stream.allocator = options && options->allocator ? options->allocator : &hf_csv__default_allocator;
+    stream.options = options;
+    stream.dialect = dialect;
+    stream.rows_left = options ? options->max_rows : 0;
+    stream.block_count = (size_t)((stream.size + HF_CSV__STREAM_BLOCK_SIZE - 1) / HF_CSV__STREAM_BLOCK_SIZE);
+    size_t readers = read_ahead < HF_CSV__STREAM_MAX_READERS ? read_ahead : HF_CSV__STREAM_MAX_READERS;
+    stream.slot_count = readers + 1;//blocks read ahead plus the one being parsed
+    stream.buffers = (char*)hf_csv__alloc(stream.allocator, (size_t)HF_CSV__STREAM_BLOCK_SIZE * stream.slot_count);
+    stream.states = (HF_CSV__stream_state*)hf_csv__alloc(stream.allocator, sizeof(HF_CSV__stream_state) * stream.slot_count);
+    bool synchronized = hf_csv__mutex_init(&stream.mutex);
+    bool ready_init = synchronized && hf_csv__cond_init(&stream.ready);
+    bool free_init = ready_init && hf_csv__cond_init(&stream.free);
+    bool failed = !stream.buffers || !stream.states || !free_init;
+
+    //blocks are read by as many threads, or by the parser itself if none could be started
+    HF_CSV__thread threads[HF_CSV__STREAM_MAX_READERS];
+    size_t started = 0;
+    while(!failed && started < readers && started < stream.block_count && hf_csv__stream_thread_start(&threads[started], &stream)) {
+        started++;
+    }
+    for(size_t block = 0; block < stream.block_count && !failed; block++) {
+        size_t slot = block % stream.slot_count;
+        char* buffer = stream.buffers + slot * HF_CSV__STREAM_BLOCK_SIZE;
+        if(started == 0) {
+            failed = !hf_csv__read_at(stream.file, buffer, hf_csv__stream_block_size(&stream, block), (uint64_t)block * HF_CSV__STREAM_BLOCK_SIZE);
+        }
+        else {
+            hf_csv__mutex_lock(&stream.mutex);
+            while(stream.next_read <= block || stream.states[slot] == HF_CSV__STREAM_READING) {
+                hf_csv__cond_wait(&stream.ready, &stream.mutex);
+            }
+            failed = stream.states[slot] == HF_CSV__STREAM_FAILED;
+            hf_csv__mutex_unlock(&stream.mutex);
+        }
+
+        failed = failed || !hf_csv__stream_consume(&stream, buffer, hf_csv__stream_block_size(&stream, block));
+        if(started > 0) {
+            hf_csv__mutex_lock(&stream.mutex);
+            stream.states[slot] = HF_CSV__STREAM_FREE;
+            stream.next_parse++;
+            stream.stop = failed || (options && options->max_rows > 0 && stream.rows_left == 0);
+            hf_csv__cond_broadcast(&stream.free);
+            hf_csv__mutex_unlock(&stream.mutex);
+        }
+        if(options && options->max_rows > 0 && stream.rows_left == 0) {
+            break;
+        }
+    }
+    if(started > 0 && !stream.stop) {
+        hf_csv__mutex_lock(&stream.mutex);
+        stream.stop = true;
+        hf_csv__cond_broadcast(&stream.free);
+        hf_csv__mutex_unlock(&stream.mutex);
+    }
+    for(size_t i = 0; i < started; i++) {
+        hf_csv__thread_join(threads[i]);
+    }
+
+    //a last row without line break, or files without rows, are parsed as a whole
+    if(!failed && (stream.pending_size > 0 || !stream.csv)) {
+        failed = !hf_csv__stream_parse(&stream, stream.pending ? stream.pending : "", stream.pending_size);
+    }
+    fclose(stream.file);
+    hf_csv__free(stream.allocator, stream.pending, stream.pending_capacity);
+    hf_csv__free(stream.allocator, stream.buffers, (size_t)HF_CSV__STREAM_BLOCK_SIZE * stream.slot_count);
+    hf_csv__free(stream.allocator, stream.states, sizeof(HF_CSV__stream_state) * stream.slot_count);
+    if(free_init) {
+        hf_csv__cond_destroy(&stream.free);
+    }
+    if(ready_init) {
+        hf_csv__cond_destroy(&stream.ready);
+    }
+    if(synchronized) {
+        hf_csv__mutex_destroy(&stream.mutex);
+    }
+    if(failed) {
+        hf_csv_destroy(stream.csv);
+        return NULL;
+    }
+    return stream.csv;
+}
+
+static bool hf_csv__parse_bool(const char* string, size_t length, bool* value_ptr) {
+    static const char* const names[] = { "0", "1", "false", "true" };
+    for(size_t i = 0; i < 4; i++) {
+        size_t name_length = strlen(names[i]);
+        if(length != name_length) {
+            continue;
+        }
+        size_t j = 0;
+        while(j < length && (string[j] | 0x20) == names[i][j]) {//lowercases letters, digits are left untouched
+            j++;
+        }
+        if(j == length) {
+            *value_ptr = (i & 1) != 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+//parses YYYY-MM-DD into days since 1970-01-01
+static bool hf_csv__parse_date(const char* string, size_t length, int32_t* value_ptr) {
+    if(length != 10 || string[4] != '-' || string[7] != '-') {
+        return false;
+    }
+    int parts[3] = { 0, 0, 0 };
+    static const size_t starts[3] = { 0, 5, 8 };
+    static const size_t lengths[3] = { 4, 2, 2 };
+    for(size_t part = 0; part < 3; part++) {
+        for(size_t i = starts[part]; i < starts[part] + lengths[part]; i++) {
+            if(string[i] < '0' || string[i] > '9') {
+                return false;
+            }
+            parts[part] = parts[part] * 10 + (string[i] - '0');
+        }
+    }
+
+    int year = parts[0];
+    int month = parts[1];
+    int day = parts[2];
+    static const int month_days[12] = { 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    if(month < 1 || month > 12 || day < 1 || day > month_days[month - 1] || (month == 2 && day == 29 && !leap)) {
+        return false;
+    }
+
+    //days from civil, counting years from march so leap days come last
+    year -= month <= 2;
+    int era = year / 400;
+    int year_of_era = year - era * 400;
+    int day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    *value_ptr = (int32_t)(era * 146097 + day_of_era - 719468);
+    return true;
+}
+
+static bool hf_csv__parse_typed(HF_CSV_type type, const char* string, size_t length, void* values, size_t index) {
+    switch(type) {
+    case HF_CSV_TYPE_INT64:
+        return hf_csv__parse_int64(string, length, (int64_t*)values + index);
+    case HF_CSV_TYPE_DOUBLE:
+        return hf_csv__parse_double(string, length, (double*)values + index);
+    case HF_CSV_TYPE_BOOL:
+        return hf_csv__parse_bool(string, length, (bool*)values + index);
+    case HF_CSV_TYPE_DATE:
+        return hf_csv__parse_date(string, length, (int32_t*)values + index);
+    default:
+        return false;
+    }
+}
+
+static void hf_csv__typed_unlink(HF_CSV* csv, HF_CSV__typed* typed) {
+    HF_CSV__typed** link = &csv->typed;
+    while(*link != typed) {
+        link = &(*link)->next;
+    }
+    *link = typed->next;
+}
+
+//converts every value of the pending columns in a single pass over the rows
+static void hf_csv__typed_fill(HF_CSV* csv, HF_CSV__typed** pending, size_t count) {
+    size_t first_row = pending[0]->first_row;
+    for(size_t row = first_row; row < csv->rows; row++) {
+        const HF_CSV__cell* cells = csv->values[row];
+        size_t index = row - first_row;
+        for(size_t i = 0; i < count; i++) {
+            HF_CSV_column* column = &pending[i]->column;
+            const HF_CSV__cell* cell = &cells[pending[i]->line];
+            unsigned char* validity = (unsigned char*)column->validity;
+            if(cell->value && cell->length > 0 && hf_csv__parse_typed(column->type, cell->value, cell->length, (void*)column->values, index)) {
+                validity[index / 8] |= (unsigned char)(1u << (index % 8));
+            }
+            else {
+                memset((char*)column->values + index * hf_csv__type_size(column->type), 0, hf_csv__type_size(column->type));
+                column->null_count++;
+            }
+        }
+    }
+}
+
+bool hf_csv_get_columns(HF_CSV* csv, const size_t* columns, const HF_CSV_type* types, size_t count, size_t first_row, const HF_CSV_column** columns_ptr) {
+    if(!csv || !columns || !types || !columns_ptr || first_row >= csv->rows) {
+        return false;
+    }
+    if(!hf_csv__materialize(csv)) {
+        return false;
+    }
+    for(size_t i = 0; i < count; i++) {
+        if(columns[i] >= csv->columns || hf_csv__type_size(types[i]) == 0) {
+            return false;
+        }
+    }
+
+    //columns not cached yet are filled together, a few at a time
+    HF_CSV__typed* pending[16];
+    size_t pending_count = 0;
+    bool success = true;
+    size_t rows = csv->rows - first_row;
+    for(size_t i = 0; i < count; i++) {
+        HF_CSV__typed* typed = csv->typed;
+        while(typed && (typed->line != columns[i] || typed->first_row != first_row || typed->column.type != types[i])) {
+            typed = typed->next;
+        }
+
+        if(!typed) {
+            typed = (HF_CSV__typed*)hf_csv__alloc(&csv->allocator, sizeof(HF_CSV__typed));
+            if(!typed) {
+                success = false;
+                break;
+            }
+            memset(typed, 0, sizeof(HF_CSV__typed));
+            typed->line = columns[i];
+            typed->first_row = first_row;
+            typed->column.type = types[i];
+            typed->column.rows = rows;
+            typed->column.values = hf_csv__alloc(&csv->allocator, hf_csv__type_size(types[i]) * rows);
+            typed->column.validity = (const unsigned char*)hf_csv__alloc(&csv->allocator, (rows + 7) / 8);
+            typed->next = csv->typed;
+            csv->typed = typed;
+            if(!typed->column.values || !typed->column.validity) {
+                hf_csv__typed_unlink(csv, typed);
+                hf_csv__typed_free(csv, typed);
+                success = false;
+                break;
+            }
+            memset((void*)typed->column.validity, 0, (rows + 7) / 8);
+            pending[pending_count++] = typed;
+        }
+        columns_ptr[i] = &typed->column;
+
+        if(pending_count == sizeof(pending) / sizeof(pending[0]) || (i + 1 == count && pending_count > 0)) {
+            hf_csv__typed_fill(csv, pending, pending_count);
+            pending_count = 0;
+        }
+    }
+
+    //on failure columns waiting to be filled are discarded, filled ones stay cached
+    for(size_t i = 0; i < pending_count; i++) {
+        hf_csv__typed_unlink(csv, pending[i]);
+        hf_csv__typed_free(csv, pending[i]);
+    }
+    return success;
+}
+
+const HF_CSV_column* hf_csv_get_column(HF_CSV* csv, size_t column, size_t first_row, HF_CSV_type type) {
+    const HF_CSV_column* typed = NULL;
+    if(!hf_csv_get_columns(csv, &column, &type, 1, first_row, &typed)) {
+        return NULL;
+    }
+    return typed;
+}
+
+bool hf_csv_infer_schema(HF_CSV* csv, size_t first_row, HF_CSV_column_schema* schema) {
+    if(!csv || !schema || first_row >= csv->rows) {
+        return false;
+    }
+    if(!hf_csv__materialize(csv)) {
+        return false;
+    }
+
+    //every column starts as a candidate for all types, values rule types out
+    static const HF_CSV_type candidates[4] = { HF_CSV_TYPE_INT64, HF_CSV_TYPE_DOUBLE, HF_CSV_TYPE_BOOL, HF_CSV_TYPE_DATE };
+    union {
+        int64_t int64;
+        double real;
+        bool boolean;
+        int32_t date;
+    } scratch;
+    for(size_t column = 0; column < csv->columns; column++) {
+        unsigned possible = 0xF;
+        size_t max_width = 0;
+        size_t null_count = 0;
+        for(size_t row = first_row; row < csv->rows; row++) {
+            const HF_CSV__cell* cell = &csv->values[row][column];
+            size_t length = cell->value ? cell->length : 0;
+            if(length == 0) {
+                null_count++;
+                continue;
+            }
+            if(length > max_width) {
+                max_width = length;
+            }
+            for(unsigned i = 0; i < 4; i++) {
+                if((possible & (1u << i)) && !hf_csv__parse_typed(candidates[i], cell->value, length, &scratch, 0)) {
+                    possible &= ~(1u << i);
+                }
+            }
+        }
+
+        schema[column].type = HF_CSV_TYPE_TEXT;
+        for(unsigned i = 0; i < 4 && null_count < csv->rows - first_row; i++) {
+            if(possible & (1u << i)) {
+                schema[column].type = candidates[i];
+                break;
+            }
+        }
+        schema[column].max_width = max_width;
+        schema[column].null_count = null_count;
+    }
+    return true;
+}
+
+#define HF_CSV__SORT_TEXT UINT64_MAX//prefix of values that are not numbers under numeric collation, sorted after every number
+
+//row of a sort, with an order preserving prefix of its first key so most comparisons don't read values
+typedef struct HF_CSV__sort_entry_s {
+    uint64_t prefix;
+    size_t row;
+} HF_CSV__sort_entry;
+
+typedef struct HF_CSV__sort_s {
+    HF_CSV* csv;
+    const HF_CSV_sort_key* keys;
+    size_t key_count;
+    size_t first_row;//1 if the header is kept in place
+    HF_CSV__sort_entry* entries;
+    HF_CSV__sort_entry* buffer;//as many entries, merges alternate between both
+    uint64_t* prefixes;//prefixes of the other keys, key_count - 1 per row after first_row
+    size_t count;
+    size_t run;//entries of every sorted run, the last one may be shorter
+} HF_CSV__sort;
+
+static inline bool hf_csv__is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+//compares runs of digits by their value, leading zeros aside, and other bytes as they are. Values equal that way are ordered by bytes
+static int hf_csv__compare_natural(const char* a, size_t a_length, const char* b, size_t b_length) {
+    size_t i = 0;
+    size_t j = 0;
+    while(i < a_length && j < b_length) {
+        if(!hf_csv__is_digit(a[i]) || !hf_csv__is_digit(b[j])) {
+            if(a[i] != b[j]) {
+                return (unsigned char)a[i] < (unsigned char)b[j] ? -1 : 1;
+            }
+            i++;
+            j++;
+            continue;
+        }
+        while(i < a_length && a[i] == '0') {
+            i++;
+        }
+        while(j < b_length && b[j] == '0') {
+            j++;
+        }
+        size_t a_start = i;
+        size_t b_start = j;
+        while(i < a_length && hf_csv__is_digit(a[i])) {
+            i++;
+        }
+        while(j < b_length && hf_csv__is_digit(b[j])) {
+            j++;
+        }
+        //longer runs are bigger numbers, runs as long compare digit by digit
+        if(i - a_start != j - b_start) {
+            return i - a_start < j - b_start ? -1 : 1;
+        }
+        int order = memcmp(a + a_start, b + b_start, i - a_start);
+        if(order != 0) {
+            return order < 0 ? -1 : 1;
+        }
+    }
+    if(i < a_length || j < b_length) {
+        return i < a_length ? 1 : -1;
+    }
+    return 0;
+}
+
+static int hf_csv__compare_bytes(const char* a, size_t a_length, const char* b, size_t b_length) {
+    int order = memcmp(a, b, a_length < b_length ? a_length : b_length);
+    if(order != 0) {
+        return order < 0 ? -1 : 1;
+    }
+    return a_length == b_length ? 0 : (a_length < b_length ? -1 : 1);
+}
+
+//compares two values under collation, values never set being empty
+static int hf_csv__compare_values(const HF_CSV__cell* a_cell, const HF_CSV__cell* b_cell, HF_CSV_collation collation) {
+    const char* a = a_cell->value ? a_cell->value : "";
+    const char* b = b_cell->value ? b_cell->value : "";
+    size_t a_length = a_cell->value ? a_cell->length : 0;
+    size_t b_length = b_cell->value ? b_cell->length : 0;
+    if(collation == HF_CSV_COLLATION_NUMERIC) {
+        double a_number;
+        double b_number;
+        bool a_valid = hf_csv__parse_double(a, a_length, &a_number);
+        bool b_valid = hf_csv__parse_double(b, b_length, &b_number);
+        if(a_valid && b_valid) {
+            return a_number == b_number ? 0 : (a_number < b_number ? -1 : 1);
+        }
+        if(a_valid || b_valid) {
+            return a_valid ? -1 : 1;
+        }
+    }
+    else if(collation == HF_CSV_COLLATION_NATURAL) {
+        int order = hf_csv__compare_natural(a, a_length, b, b_length);
+        if(order != 0) {
+            return order;
+        }
+    }
+    return hf_csv__compare_bytes(a, a_length, b, b_length);
+}
+
+//prefix of a value under the collation of key, ordered like values, but equal for values that may differ unless hf_csv__sort_exact.
+//Bytes give their first 7 bytes as a big endian number followed by their length up to 8, and numbers are mapped to integers of the same order.
+//Natural order gives the bytes before the first digit run, then the run as '0', its length without leading zeros and its digits, as a run compares to other bytes like any digit
+static uint64_t hf_csv__sort_prefix(const HF_CSV__cell* cell, const HF_CSV_sort_key* key) {
+    const char* value = cell->value ? cell->value : "";
+    size_t length = cell->value ? cell->length : 0;
+    uint64_t prefix = 0;
+    if(key->collation == HF_CSV_COLLATION_BYTES) {
+        for(size_t i = 0; i < 7 && i < length; i++) {
+            prefix |= (uint64_t)(unsigned char)value[i] << (56 - 8 * i);
+        }
+        prefix |= length < 8 ? length : 8;
+    }
+    else if(key->collation == HF_CSV_COLLATION_NUMERIC) {
+        double number;
+        if(!hf_csv__parse_double(value, length, &number)) {
+            prefix = HF_CSV__SORT_TEXT;
+        }
+        else {
+            if(number == 0) {//-0 equals 0
+                number = 0;
+            }
+            memcpy(&prefix, &number, sizeof(prefix));
+            prefix = (prefix >> 63) ? ~prefix : prefix | (1ull << 63);
+        }
+    }
+    else {
+        size_t i = 0;
+        int shift = 56;
+        for(; i < length && shift >= 0 && !hf_csv__is_digit(value[i]); i++, shift -= 8) {
+            prefix |= (uint64_t)(unsigned char)value[i] << shift;
+        }
+        if(i < length && shift >= 0) {
+            prefix |= (uint64_t)'0' << shift;
+            shift -= 8;
+            while(i < length && value[i] == '0') {
+                i++;
+            }
+            size_t start = i;
+            while(i < length && hf_csv__is_digit(value[i])) {
+                i++;
+            }
+            size_t run = i - start;
+            if(shift >= 0) {//longer runs only compare by length
+                prefix |= (uint64_t)(run < 255 ? run : 255) << shift;
+                shift -= 8;
+            }
+            for(size_t j = start; run < 255 && j < i && shift >= 0; j++, shift -= 8) {
+                prefix |= (uint64_t)(unsigned char)value[j] << shift;
+            }
+        }
+    }
+    return key->descending ? ~prefix : prefix;
+}
+
+//true if values with this prefix under key are all equal: shorter than 8 bytes, or numbers
+static inline bool hf_csv__sort_exact(uint64_t prefix, const HF_CSV_sort_key* key) {
+    prefix = key->descending ? ~prefix : prefix;
+    if(key->collation == HF_CSV_COLLATION_BYTES) {
+        return (prefix & 0xFF) < 8;
+    }
+    return key->collation == HF_CSV_COLLATION_NUMERIC && prefix != HF_CSV__SORT_TEXT;
+}
+
+static int hf_csv__sort_compare(const HF_CSV__sort* sort, const HF_CSV__sort_entry* a, const HF_CSV__sort_entry* b) {
+    if(a->prefix != b->prefix) {
+        return a->prefix < b->prefix ? -1 : 1;
+    }
+    //values are only read when prefixes are equal but not exact
+    size_t others = sort->key_count - 1;
+    for(size_t key = 0; key < sort->key_count; key++) {
+        uint64_t prefix = a->prefix;
+        if(key > 0) {
+            prefix = sort->prefixes[(a->row - sort->first_row) * others + key - 1];
+            uint64_t other = sort->prefixes[(b->row - sort->first_row) * others + key - 1];
+            if(prefix != other) {
+                return prefix < other ? -1 : 1;
+            }
+        }
+        if(hf_csv__sort_exact(prefix, &sort->keys[key])) {
+            continue;
+        }
+        size_t column = sort->keys[key].column;
+        const HF_CSV__cell* a_cell = &sort->csv->values[a->row][column];
+        const HF_CSV__cell* b_cell = &sort->csv->values[b->row][column];
+        if(a_cell->code != 0 && a_cell->code == b_cell->code) {//same value of a dictionary encoded column
+            continue;
+        }
+        int order = hf_csv__compare_values(a_cell, b_cell, sort->keys[key].collation);
+        if(order != 0) {
+            return sort->keys[key].descending ? -order : order;
+        }
+    }
+    return 0;
+}
+
+//merges two sorted runs into output, taking from the first one on ties so sorting stays stable
+static void hf_csv__sort_merge(const HF_CSV__sort* sort, const HF_CSV__sort_entry* a, size_t a_count, const HF_CSV__sort_entry* b, size_t b_count, HF_CSV__sort_entry* output) {
+    const HF_CSV__sort_entry* a_end = a + a_count;
+    const HF_CSV__sort_entry* b_end = b + b_count;
+    while(a < a_end && b < b_end) {
+        *output++ = hf_csv__sort_compare(sort, b, a) < 0 ? *b++ : *a++;
+    }
+    memcpy(output, a, sizeof(HF_CSV__sort_entry) * (size_t)(a_end - a));
+    output += a_end - a;
+    memcpy(output, b, sizeof(HF_CSV__sort_entry) * (size_t)(b_end - b));
+}
+
+//stable merge sort of count entries, using as many entries of buffer
+static void hf_csv__sort_entries(const HF_CSV__sort* sort, HF_CSV__sort_entry* entries, HF_CSV__sort_entry* buffer, size_t count) {
+    if(count <= 16) {
+        for(size_t i = 1; i < count; i++) {
+            HF_CSV__sort_entry entry = entries[i];
+            size_t j = i;
+            for(; j > 0 && hf_csv__sort_compare(sort, &entry, &entries[j - 1]) < 0; j--) {
+                entries[j] = entries[j - 1];
+            }
+            entries[j] = entry;
+        }
+        return;
+    }
+
+    size_t half = count / 2;
+    hf_csv__sort_entries(sort, entries, buffer, half);
+    hf_csv__sort_entries(sort, entries + half, buffer + half, count - half);
+    if(hf_csv__sort_compare(sort, &entries[half], &entries[half - 1]) >= 0) {//already in order, as often happens with presorted rows
+        return;
+    }
+    memcpy(buffer, entries, sizeof(HF_CSV__sort_entry) * count);
+    hf_csv__sort_merge(sort, buffer, half, buffer + half, count - half, entries);
+}
+
+//computes the prefixes of a run of entries and sorts it
+static void hf_csv__sort_run_task(void* context, size_t index) {
+    HF_CSV__sort* sort = (HF_CSV__sort*)context;
+    size_t first = index * sort->run;
+    size_t count = first + sort->run < sort->count ? sort->run : sort->count - first;
+    size_t others = sort->key_count - 1;
+    for(size_t i = first; i < first + count; i++) {
+        const HF_CSV__cell* cells = sort->csv->values[sort->first_row + i];
+        sort->entries[i].prefix = hf_csv__sort_prefix(&cells[sort->keys[0].column], &sort->keys[0]);
+        sort->entries[i].row = sort->first_row + i;
+        for(size_t key = 1; key < sort->key_count; key++) {
+            sort->prefixes[i * others + key - 1] = hf_csv__sort_prefix(&cells[sort->keys[key].column], &sort->keys[key]);
+        }
+    }
+    hf_csv__sort_entries(sort, sort->entries + first, sort->buffer + first, count);
+}
+
+//merges the runs at 2 * index and 2 * index + 1 from entries into buffer
+static void hf_csv__sort_merge_task(void* context, size_t index) {
+    HF_CSV__sort* sort = (HF_CSV__sort*)context;
+    size_t first = 2 * index * sort->run;
+    size_t middle = first + sort->run < sort->count ? first + sort->run : sort->count;
+    size_t end = middle + sort->run < sort->count ? middle + sort->run : sort->count;
+    hf_csv__sort_merge(sort, sort->entries + first, middle - first, sort->entries + middle, end - middle, sort->buffer + first);
+}
+
+bool hf_csv_sort(HF_CSV* csv, const HF_CSV_sort_key* keys, size_t key_count, unsigned flags) {
+    return hf_csv_sort_parallel(csv, keys, key_count, flags, 1);
+}
+
+bool hf_csv_sort_parallel(HF_CSV* csv, const HF_CSV_sort_key* keys, size_t key_count, unsigned flags, size_t threads) {
+    if(!csv || !keys || key_count == 0) {
+        return false;
+    }
+    for(size_t key = 0; key < key_count; key++) {
+        if(keys[key].column >= csv->columns || keys[key].collation < HF_CSV_COLLATION_BYTES || keys[key].collation > HF_CSV_COLLATION_NATURAL) {
+            return false;
+        }
+    }
+    if(!hf_csv__materialize(csv)) {
+        return false;
+    }
+
+    HF_CSV__sort sort;
+    sort.csv = csv;
+    sort.keys = keys;
+    sort.key_count = key_count;
+    sort.first_row = (flags & HF_CSV_SORT_KEEP_HEADER) || csv->dialect.header ? 1 : 0;
+    if(csv->rows < sort.first_row + 2) {
+        return true;
+    }
+    sort.count = csv->rows - sort.first_row;
+    sort.entries = (HF_CSV__sort_entry*)hf_csv__alloc(&csv->allocator, sizeof(HF_CSV__sort_entry) * sort.count);
+    sort.buffer = (HF_CSV__sort_entry*)hf_csv__alloc(&csv->allocator, sizeof(HF_CSV__sort_entry) * sort.count);
+    sort.prefixes = key_count > 1 ? (uint64_t*)hf_csv__alloc(&csv->allocator, sizeof(uint64_t) * sort.count * (key_count - 1)) : NULL;
+    HF_CSV__cell** values = (HF_CSV__cell**)hf_csv__alloc(&csv->allocator, sizeof(HF_CSV__cell*) * csv->row_capacity);
+    if(!sort.entries || !sort.buffer || (!sort.prefixes && key_count > 1) || !values) {
+        hf_csv__free(&csv->allocator, sort.entries, sizeof(HF_CSV__sort_entry) * sort.count);
+        hf_csv__free(&csv->allocator, sort.buffer, sizeof(HF_CSV__sort_entry) * sort.count);
+        hf_csv__free(&csv->allocator, sort.prefixes, sizeof(uint64_t) * sort.count * (key_count - 1));
+        hf_csv__free(&csv->allocator, values, sizeof(HF_CSV__cell*) * csv->row_capacity);
+        return false;
+    }
+
+    //runs are sorted by their own thread, then merged pairwise, every round merging half as many runs in parallel
+    size_t run_count = sort.count / HF_CSV__MIN_CHUNK_ROWS;
+    if(run_count > threads) {
+        run_count = threads;
+    }
+    if(run_count == 0) {
+        run_count = 1;
+    }
+    sort.run = (sort.count + run_count - 1) / run_count;
+    run_count = (sort.count + sort.run - 1) / sort.run;
+    hf_csv__parallel_for(&csv->allocator, run_count, threads, hf_csv__sort_run_task, &sort);
+    while(run_count > 1) {
+        hf_csv__parallel_for(&csv->allocator, (run_count + 1) / 2, threads, hf_csv__sort_merge_task, &sort);
+        HF_CSV__sort_entry* entries = sort.entries;
+        sort.entries = sort.buffer;
+        sort.buffer = entries;
+        sort.run *= 2;
+        run_count = (run_count + 1) / 2;
+    }
+
+    //only row pointers move, cells and values stay where they are
+    memcpy(values, csv->values, sizeof(HF_CSV__cell*) * sort.first_row);
+    for(size_t i = 0; i < sort.count; i++) {
+        values[sort.first_row + i] = csv->values[sort.entries[i].row];
+    }
+    for(HF_CSV__index* index = csv->indexes; index; index = index->next) {
+        for(size_t i = 0; index->by_row && index->line >= sort.first_row && i < sort.count; i++) {
+            if(sort.entries[i].row == index->line) {
+                index->line = sort.first_row + i;
+                break;
+            }
+        }
+    }
+    hf_csv__free(&csv->allocator, csv->values, sizeof(HF_CSV__cell*) * csv->row_capacity);
+    csv->values = values;
+    hf_csv__free(&csv->allocator, sort.entries, sizeof(HF_CSV__sort_entry) * sort.count);
+    hf_csv__free(&csv->allocator, sort.buffer, sizeof(HF_CSV__sort_entry) * sort.count);
+    hf_csv__free(&csv->allocator, sort.prefixes, sizeof(uint64_t) * sort.count * (key_count - 1));
+
+    hf_csv__indexes_refill(csv);
+    hf_csv__typed_invalidate(csv, SIZE_MAX);
+    return true;
+}
+
+//distinct key of a group by, represented by the first row holding it
+typedef struct HF_CSV__group_s {
+    uint64_t hash;
+    size_t row;
+} HF_CSV__group;
+
+//running value of an aggregate over a group. count is the amount of rows for counts, and of numbers otherwise
+typedef struct HF_CSV__accumulator_s {
+    double value;
+    size_t count;
+} HF_CSV__accumulator;
+
+static uint64_t hf_csv__row_key_hash(const HF_CSV__cell* cells, const size_t* keys, size_t key_count) {
+    uint64_t hash = 0;
+    for(size_t key = 0; key < key_count; key++) {
+        hash = (hash ^ hf_csv__cell_hash(&cells[keys[key]])) * 0x9E3779B97F4A7C15ull;
+    }
+    return hash;
+}
+
+static bool hf_csv__row_keys_equal(const HF_CSV__cell* cells, const HF_CSV__cell* other, const size_t* keys, size_t key_count) {
+    for(size_t key = 0; key < key_count; key++) {
+        const HF_CSV__cell* cell = &other[keys[key]];
+        if(!hf_csv__cell_equals(&cells[keys[key]], cell->value ? cell->value : "", cell->value ? cell->length : 0)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void hf_csv__accumulate(HF_CSV__accumulator* accumulator, HF_CSV_aggregate_kind kind, const HF_CSV__cell* cell) {
+    if(kind == HF_CSV_AGGREGATE_COUNT) {
+        accumulator->count++;
+        return;
+    }
+    double number;
+    if(!cell->value || !hf_csv__parse_double(cell->value, cell->length, &number)) {
+        return;
+    }
+    if(accumulator->count == 0 || kind == HF_CSV_AGGREGATE_SUM || kind == HF_CSV_AGGREGATE_MEAN) {
+        accumulator->value = accumulator->count == 0 ? number : accumulator->value + number;
+    }
+    else if(kind == HF_CSV_AGGREGATE_MIN ? number < accumulator->value : number > accumulator->value) {
+        accumulator->value = number;
+    }
+    accumulator->count++;
+}
+
+//sets a cell of a new csv to a copy of length bytes of value, taken from its arena. Returns false if allocation failed
+static bool hf_csv__put_value(HF_CSV* csv, HF_CSV__cell* cell, const char* value, size_t length) {
+    char* copy = hf_csv__arena_alloc(csv, length + 1);
+    if(!copy) {
+        return false;
+    }
+    memcpy(copy, value, length);
+    copy[length] = '\0';
+    cell->value = copy;
+    cell->length = length;
+    return true;
+}
+
+//writes number with precision significant digits to buffer, with '.' as decimal point whatever the locale. Returns the length written, 0 if it didn't fit
+static size_t hf_csv__format_double(char* buffer, size_t size, int precision, double number) {
+    int length = snprintf(buffer, size, "%.*g", precision, number);
+    if(length <= 0 || (size_t)length >= size) {
+        return 0;
+    }
+    const char* point = hf_csv__decimal_point();
+    size_t point_length = strlen(point);
+    char* found = strcmp(point, ".") != 0 ? strstr(buffer, point) : NULL;
+    if(found) {
+        *found = '.';
+        memmove(found + 1, found + point_length, (size_t)length - (size_t)(found - buffer) - point_length + 1);
+        length -= (int)(point_length - 1);
+    }
+    return (size_t)length;
+}
+
+//writes an aggregate to cell. Numbers take the shortest of 15 to 17 significant digits reading back as the same double
+static bool hf_csv__put_aggregate(HF_CSV* csv, HF_CSV__cell* cell, const HF_CSV__accumulator* accumulator, HF_CSV_aggregate_kind kind) {
+    char buffer[32];
+    size_t length = 0;
+    if(kind == HF_CSV_AGGREGATE_COUNT) {
+        int written = snprintf(buffer, sizeof(buffer), "%llu", (unsigned long long)accumulator->count);
+        length = written > 0 ? (size_t)written : 0;
+    }
+    else if(accumulator->count > 0 || kind == HF_CSV_AGGREGATE_SUM) {
+        double number = kind == HF_CSV_AGGREGATE_MEAN ? accumulator->value / (double)accumulator->count : accumulator->value;
+        for(int precision = 15; precision <= 17; precision++) {
+            double parsed;
+            length = hf_csv__format_double(buffer, sizeof(buffer), precision, number);
+            if(length > 0 && hf_csv__parse_double(buffer, length, &parsed) && parsed == number) {
+                break;
+            }
+        }
+    }
+    return length == 0 || hf_csv__put_value(csv, cell, buffer, length);
+}
+
+static const char* hf_csv__aggregate_name(HF_CSV_aggregate_kind kind) {
+    static const char* const names[] = { "count", "sum", "min", "max", "mean" };
+    return names[kind];
+}
+
+//adds the row of key and aggregate names to the result of a group by, from the header of csv
+static bool hf_csv__group_header(HF_CSV* result, HF_CSV* csv, const size_t* keys, size_t key_count, const HF_CSV_aggregate* aggregates, size_t aggregate_count) {
+    HF_CSV__cell* cells = result->values[0];
+    for(size_t key = 0; key < key_count; key++) {
+        const HF_CSV__cell* cell = &csv->values[0][keys[key]];
+        if(cell->value && !hf_csv__put_value(result, &cells[key], cell->value, cell->length)) {
+            return false;
+        }
+    }
+    for(size_t i = 0; i < aggregate_count; i++) {
+        const char* name = hf_csv__aggregate_name(aggregates[i].kind);
+        const HF_CSV__cell* cell = &csv->values[0][aggregates[i].column];
+        size_t name_length = strlen(name);
+        size_t column_length = cell->value ? cell->length : 0;
+        size_t length = aggregates[i].kind == HF_CSV_AGGREGATE_COUNT ? name_length : name_length + column_length + 2;
+        char* value = hf_csv__arena_alloc(result, length + 1);
+        if(!value) {
+            return false;
+        }
+        memcpy(value, name, name_length);
+        if(aggregates[i].kind != HF_CSV_AGGREGATE_COUNT) {//e.g. sum(price)
+            value[name_length] = '(';
+            memcpy(value + name_length + 1, cell->value, column_length);
+            value[length - 1] = ')';
+        }
+        value[length] = '\0';
+        cells[key_count + i].value = value;
+        cells[key_count + i].length = length;
+    }
+    return true;
+}
+
+HF_CSV* hf_csv_group_by(HF_CSV* csv, const size_t* keys, size_t key_count, const HF_CSV_aggregate* aggregates, size_t aggregate_count) {
+    if(!csv || (key_count > 0 && !keys) || (aggregate_count > 0 && !aggregates) || key_count + aggregate_count == 0) {
+        return NULL;
+    }
+    for(size_t key = 0; key < key_count; key++) {
+        if(keys[key] >= csv->columns) {
+            return NULL;
+        }
+    }
+    for(size_t i = 0; i < aggregate_count; i++) {
+        if(aggregates[i].kind < HF_CSV_AGGREGATE_COUNT || aggregates[i].kind > HF_CSV_AGGREGATE_MEAN || (aggregates[i].kind != HF_CSV_AGGREGATE_COUNT && aggregates[i].column >= csv->columns)) {
+            return NULL;
+        }
+    }
+    if(!hf_csv__materialize(csv)) {
+        return NULL;
+    }
+
+    //groups are found through an open addressing table of group indices plus one, and keep their accumulators contiguously
+    const HF_CSV_allocator* allocator = &csv->allocator;
+    size_t header = csv->dialect.header ? 1 : 0;
+    size_t slot_capacity = 16;
+    size_t group_capacity = 8;
+    size_t group_count = 0;
+    size_t* slots = (size_t*)hf_csv__alloc(allocator, sizeof(size_t) * slot_capacity);
+    HF_CSV__group* groups = (HF_CSV__group*)hf_csv__alloc(allocator, sizeof(HF_CSV__group) * group_capacity);
+    HF_CSV__accumulator* accumulators = (HF_CSV__accumulator*)hf_csv__alloc(allocator, sizeof(HF_CSV__accumulator) * group_capacity * (aggregate_count ? aggregate_count : 1));
+    bool failed = !slots || !groups || !accumulators;
+    if(slots) {
+        memset(slots, 0, sizeof(size_t) * slot_capacity);
+    }
+
+    for(size_t row = header; row < csv->rows && !failed; row++) {
+        const HF_CSV__cell* cells = csv->values[row];
+        uint64_t hash = hf_csv__row_key_hash(cells, keys, key_count);
+        size_t mask = slot_capacity - 1;
+        size_t slot = (size_t)hash & mask;
+        while(slots[slot] != 0 && (groups[slots[slot] - 1].hash != hash || !hf_csv__row_keys_equal(cells, csv->values[groups[slots[slot] - 1].row], keys, key_count))) {
+            slot = (slot + 1) & mask;
+        }
+
+        if(slots[slot] == 0) {
+            if(group_count == group_capacity) {//both arrays grow together, so a failure leaves them with the same capacity
+                size_t width = aggregate_count ? aggregate_count : 1;
+                HF_CSV__accumulator* new_accumulators = (HF_CSV__accumulator*)hf_csv__alloc(allocator, sizeof(HF_CSV__accumulator) * group_capacity * 2 * width);
+                HF_CSV__group* new_groups = new_accumulators ? (HF_CSV__group*)hf_csv__realloc(allocator, groups, sizeof(HF_CSV__group) * group_capacity, sizeof(HF_CSV__group) * group_capacity * 2) : NULL;
+                if(!new_groups) {
+                    hf_csv__free(allocator, new_accumulators, sizeof(HF_CSV__accumulator) * group_capacity * 2 * width);
+                    failed = true;
+                    break;
+                }
+                memcpy(new_accumulators, accumulators, sizeof(HF_CSV__accumulator) * group_capacity * width);
+                hf_csv__free(allocator, accumulators, sizeof(HF_CSV__accumulator) * group_capacity * width);
+                accumulators = new_accumulators;
+                groups = new_groups;
+                group_capacity *= 2;
+            }
+            if((group_count + 1) * 2 > slot_capacity) {//groups are rehashed from their stored hashes
+                size_t* new_slots = (size_t*)hf_csv__alloc(allocator, sizeof(size_t) * slot_capacity * 2);
+                if(!new_slots) {
+                    failed = true;
+                    break;
+                }
+                hf_csv__free(allocator, slots, sizeof(size_t) * slot_capacity);
+                slots = new_slots;
+                slot_capacity *= 2;
+                memset(slots, 0, sizeof(size_t) * slot_capacity);
+                mask = slot_capacity - 1;
+                for(size_t group = 0; group < group_count; group++) {
+                    size_t other = (size_t)groups[group].hash & mask;
+                    while(slots[other] != 0) {
+                        other = (other + 1) & mask;
+                    }
+                    slots[other] = group + 1;
+                }
+                slot = (size_t)hash & mask;
+                while(slots[slot] != 0) {
+                    slot = (slot + 1) & mask;
+                }
+            }
+            groups[group_count].hash = hash;
+            groups[group_count].row = row;
+            memset(&accumulators[group_count * aggregate_count], 0, sizeof(HF_CSV__accumulator) * aggregate_count);
+            slots[slot] = ++group_count;
+        }
+
+        HF_CSV__accumulator* group_accumulators = &accumulators[(slots[slot] - 1) * aggregate_count];
+        for(size_t i = 0; i < aggregate_count; i++) {
+            hf_csv__accumulate(&group_accumulators[i], aggregates[i].kind, &cells[aggregates[i].kind == HF_CSV_AGGREGATE_COUNT ? 0 : aggregates[i].column]);
+        }
+    }
+
+    //one row per group, in order of first appearance, after the names of the header
+    HF_CSV* result = NULL;
+    if(!failed && header + group_count > 0) {
+        result = hf_csv_create_with_allocator(header + group_count, key_count + aggregate_count, allocator);
+    }
+    failed = failed || !result || (header && !hf_csv__group_header(result, csv, keys, key_count, aggregates, aggregate_count));
+    for(size_t group = 0; group < group_count && !failed; group++) {
+        const HF_CSV__cell* cells = csv->values[groups[group].row];
+        HF_CSV__cell* result_cells = result->values[header + group];
+        for(size_t key = 0; key < key_count && !failed; key++) {
+            const HF_CSV__cell* cell = &cells[keys[key]];
+            failed = cell->value && !hf_csv__put_value(result, &result_cells[key], cell->value, cell->length);
+        }
+        for(size_t i = 0; i < aggregate_count && !failed; i++) {
+            failed = !hf_csv__put_aggregate(result, &result_cells[key_count + i], &accumulators[group * aggregate_count + i], aggregates[i].kind);
+        }
+    }
+
+    hf_csv__free(allocator, slots, sizeof(size_t) * slot_capacity);
+    hf_csv__free(allocator, groups, sizeof(HF_CSV__group) * group_capacity);
+    hf_csv__free(allocator, accumulators, sizeof(HF_CSV__accumulator) * group_capacity * (aggregate_count ? aggregate_count : 1));
+    if(failed) {
+        hf_csv_destroy(result);
+        return NULL;
+    }
+    result->dialect = csv->dialect;
+    return result;
+}
+
+#ifndef HF_CSV__FILTER_WORDS
+#define HF_CSV__FILTER_WORDS 16//words of selection evaluated at once, one condition after another, so each column is read a block at a time
+#endif
+
+//what a condition on a single column evaluates with besides its cells
+typedef struct HF_CSV__filter_leaf_s {
+    const HF_CSV_condition* condition;
+    size_t length;//of condition value
+    unsigned char* matches;//per dictionary code, 0 for cells never set, if the column is encoded
+    size_t match_count;
+    const HF_CSV_column* numbers;//typed column of ranges over columns not encoded
+} HF_CSV__filter_leaf;
+
+typedef struct HF_CSV__filter_s {
+    HF_CSV* csv;
+    const HF_CSV_condition* condition;
+    HF_CSV__filter_leaf* leaves;
+    size_t leaf_count;
+    size_t header;//1 if the first row is never selected
+    uint64_t* selection;
+    size_t words;
+    size_t chunk_words;//words of selection every task fills, the last one may fill fewer
+    size_t* counts;//selected rows per task
+} HF_CSV__filter;
+
+//finds needle in value the way memmem does: memchr skips to candidates for the first byte of needle, and the last byte rules most of them out before comparing
+static bool hf_csv__contains(const char* value, size_t length, const char* needle, size_t needle_length) {
+    if(needle_length == 0) {
+        return true;
+    }
+    const char* end = value + length;
+    while((size_t)(end - value) >= needle_length) {
+        const char* found = (const char*)memchr(value, needle[0], (size_t)(end - value) - needle_length + 1);
+        if(!found) {
+            return false;
+        }
+        if(found[needle_length - 1] == needle[needle_length - 1] && memcmp(found + 1, needle + 1, needle_length - 1) == 0) {
+            return true;
+        }
+        value = found + 1;
+    }
+    return false;
+}
+
+static bool hf_csv__leaf_matches(const HF_CSV__filter_leaf* leaf, const char* value, size_t length) {
+    const HF_CSV_condition* condition = leaf->condition;
+    switch(condition->kind) {
+    case HF_CSV_CONDITION_EQUALS:
+        return length == leaf->length && memcmp(value, condition->value, length) == 0;
+    case HF_CSV_CONDITION_PREFIX:
+        return length >= leaf->length && memcmp(value, condition->value, leaf->length) == 0;
+    case HF_CSV_CONDITION_CONTAINS:
+        return hf_csv__contains(value, length, condition->value, leaf->length);
+    default: {
+        double number;
+        return hf_csv__parse_double(value, length, &number) && number >= condition->minimum && number <= condition->maximum;
+    }
+    }
+}
+
+static bool hf_csv__condition_valid(const HF_CSV* csv, const HF_CSV_condition* condition, size_t* leaf_count) {
+    if(condition->kind == HF_CSV_CONDITION_AND || condition->kind == HF_CSV_CONDITION_OR) {
+        if(condition->condition_count > 0 && !condition->conditions) {
+            return false;
+        }
+        for(size_t i = 0; i < condition->condition_count; i++) {
+            if(!hf_csv__condition_valid(csv, &condition->conditions[i], leaf_count)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    (*leaf_count)++;
+    return condition->kind >= HF_CSV_CONDITION_EQUALS && condition->kind <= HF_CSV_CONDITION_RANGE && condition->column < csv->columns && (condition->kind == HF_CSV_CONDITION_RANGE || condition->value);
+}
+
+//prepares the leaves of condition before rows are evaluated concurrently: encoded columns get the result of every distinct value, ranges their typed column
+static bool hf_csv__filter_prepare(HF_CSV__filter* filter, const HF_CSV_condition* condition) {
+    if(condition->kind == HF_CSV_CONDITION_AND || condition->kind == HF_CSV_CONDITION_OR) {
+        for(size_t i = 0; i < condition->condition_count; i++) {
+            if(!hf_csv__filter_prepare(filter, &condition->conditions[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    HF_CSV* csv = filter->csv;
+    HF_CSV__filter_leaf* leaf = &filter->leaves[filter->leaf_count++];
+    leaf->condition = condition;
+    leaf->length = condition->kind == HF_CSV_CONDITION_RANGE ? 0 : strlen(condition->value);
+    const HF_CSV__dictionary* dictionary = hf_csv__dictionary_of(csv, condition->column);
+    if(dictionary) {
+        leaf->match_count = dictionary->count + 1;
+        leaf->matches = (unsigned char*)hf_csv__alloc(&csv->allocator, leaf->match_count);
+        if(!leaf->matches) {
+            return false;
+        }
+        leaf->matches[0] = hf_csv__leaf_matches(leaf, "", 0);
+        for(size_t code = 1; code < leaf->match_count; code++) {
+            leaf->matches[code] = hf_csv__leaf_matches(leaf, dictionary->entries[code - 1].value, dictionary->entries[code - 1].length);
+        }
+    }
+    else if(condition->kind == HF_CSV_CONDITION_RANGE) {
+        leaf->numbers = hf_csv_get_column(csv, condition->column, 0, HF_CSV_TYPE_DOUBLE);
+        if(!leaf->numbers) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static const HF_CSV__filter_leaf* hf_csv__filter_leaf(const HF_CSV__filter* filter, const HF_CSV_condition* condition) {
+    size_t leaf = 0;
+    while(filter->leaves[leaf].condition != condition) {
+        leaf++;
+    }
+    return &filter->leaves[leaf];
+}
+
+//evaluates condition over the rows of words words of selection from row first, only for rows set in mask. Bits of other rows are cleared
+static void hf_csv__filter_words(const HF_CSV__filter* filter, const HF_CSV_condition* condition, size_t first, size_t words, const uint64_t* mask, uint64_t* bits) {
+    if(condition->kind == HF_CSV_CONDITION_AND) {
+        //each condition only looks at rows every previous one kept, mask is bits already when nested in another and
+        if(bits != mask) {
+            memcpy(bits, mask, sizeof(uint64_t) * words);
+        }
+        for(size_t i = 0; i < condition->condition_count; i++) {
+            hf_csv__filter_words(filter, &condition->conditions[i], first, words, bits, bits);
+        }
+        return;
+    }
+    if(condition->kind == HF_CSV_CONDITION_OR) {
+        //and only at rows no previous one selected
+        uint64_t left[HF_CSV__FILTER_WORDS];
+        uint64_t selected[HF_CSV__FILTER_WORDS];
+        memcpy(left, mask, sizeof(uint64_t) * words);
+        memset(bits, 0, sizeof(uint64_t) * words);
+        for(size_t i = 0; i < condition->condition_count; i++) {
+            hf_csv__filter_words(filter, &condition->conditions[i], first, words, left, selected);
+            for(size_t word = 0; word < words; word++) {
+                bits[word] |= selected[word];
+                left[word] &= ~selected[word];
+            }
+        }
+        return;
+    }
+
+    const HF_CSV__filter_leaf* leaf = hf_csv__filter_leaf(filter, condition);
+    HF_CSV__cell* const* rows = filter->csv->values + first;
+    size_t column = condition->column;
+    for(size_t word = 0; word < words; word++) {
+        uint64_t left = mask[word];
+        uint64_t result = 0;
+        if(left != 0 && leaf->numbers) {//typed values are compared a word at a time, without branches
+            const double* numbers = (const double*)leaf->numbers->values + first + word * 64;
+            const unsigned char* validity = leaf->numbers->validity + (first + word * 64) / 8;
+            size_t count = filter->csv->rows - first - word * 64 < 64 ? filter->csv->rows - first - word * 64 : 64;
+            for(size_t i = 0; i < count; i++) {
+                uint64_t valid = (validity[i / 8] >> (i % 8)) & 1;
+                result |= (valid & (uint64_t)(numbers[i] >= condition->minimum) & (uint64_t)(numbers[i] <= condition->maximum)) << i;
+            }
+            result &= left;
+        }
+        else if(leaf->matches) {
+            for(; left != 0; left &= left - 1) {
+                unsigned bit = hf_csv__ctz64(left);
+                result |= (uint64_t)leaf->matches[rows[word * 64 + bit][column].code] << bit;
+            }
+        }
+        else {
+            for(; left != 0; left &= left - 1) {
+                unsigned bit = hf_csv__ctz64(left);
+                const HF_CSV__cell* cell = &rows[word * 64 + bit][column];
+                result |= (uint64_t)hf_csv__leaf_matches(leaf, cell->value ? cell->value : "", cell->value ? cell->length : 0) << bit;
+            }
+        }
+        bits[word] = result;
+    }
+}
+
+static void hf_csv__filter_task(void* context, size_t index) {
+    HF_CSV__filter* filter = (HF_CSV__filter*)context;
+    size_t first_word = index * filter->chunk_words;
+    size_t end_word = first_word + filter->chunk_words < filter->words ? first_word + filter->chunk_words : filter->words;
+    size_t count = 0;
+    for(size_t word = first_word; word < end_word; word += HF_CSV__FILTER_WORDS) {
+        size_t words = end_word - word < HF_CSV__FILTER_WORDS ? end_word - word : HF_CSV__FILTER_WORDS;
+        //rows past the end and the header are masked out from the start
+        uint64_t mask[HF_CSV__FILTER_WORDS];
+        for(size_t i = 0; i < words; i++) {
+            size_t first_row = (word + i) * 64;
+            mask[i] = filter->csv->rows - first_row >= 64 ? UINT64_MAX : (1ull << (filter->csv->rows - first_row)) - 1;
+        }
+        if(word == 0) {
+            mask[0] &= ~(uint64_t)filter->header;
+        }
+        hf_csv__filter_words(filter, filter->condition, word * 64, words, mask, filter->selection + word);
+        for(size_t i = 0; i < words; i++) {
+            count += hf_csv__popcount64(filter->selection[word + i]);
+        }
+    }
+    filter->counts[index] = count;
+}
+
+bool hf_csv_filter(HF_CSV* csv, const HF_CSV_condition* condition, uint64_t* selection, size_t* count) {
+    return hf_csv_filter_parallel(csv, condition, selection, count, 1);
+}
+
+bool hf_csv_filter_parallel(HF_CSV* csv, const HF_CSV_condition* condition, uint64_t* selection, size_t* count, size_t threads) {
+    if(!csv || !condition || !selection) {
+        return false;
+    }
+    HF_CSV__filter filter;
+    filter.leaf_count = 0;
+    if(!hf_csv__condition_valid(csv, condition, &filter.leaf_count) || !hf_csv__materialize(csv)) {
+        return false;
+    }
+
+    filter.csv = csv;
+    filter.condition = condition;
+    filter.header = csv->dialect.header ? 1 : 0;
+    filter.selection = selection;
+    filter.words = (csv->rows + 63) / 64;
+    size_t chunk_count = csv->rows / HF_CSV__MIN_CHUNK_ROWS;
+    if(chunk_count > threads) {
+        chunk_count = threads;
+    }
+    if(chunk_count == 0) {
+        chunk_count = 1;
+    }
+    //tasks fill whole blocks of words, so they never share one
+    size_t blocks = (filter.words + HF_CSV__FILTER_WORDS - 1) / HF_CSV__FILTER_WORDS;
+    filter.chunk_words = (blocks + chunk_count - 1) / chunk_count * HF_CSV__FILTER_WORDS;
+    chunk_count = filter.words > 0 ? (filter.words + filter.chunk_words - 1) / filter.chunk_words : 0;
+
+    size_t leaves_size = sizeof(HF_CSV__filter_leaf) * filter.leaf_count;
+    filter.leaves = (HF_CSV__filter_leaf*)hf_csv__alloc(&csv->allocator, leaves_size ? leaves_size : 1);
+    filter.counts = (size_t*)hf_csv__alloc(&csv->allocator, sizeof(size_t) * (chunk_count ? chunk_count : 1));
+    bool prepared = filter.leaves && filter.counts;
+    if(filter.leaves) {
+        memset(filter.leaves, 0, leaves_size);
+    }
+    filter.leaf_count = 0;
+    prepared = prepared && hf_csv__filter_prepare(&filter, condition);
+    if(prepared) {
+        hf_csv__parallel_for(&csv->allocator, chunk_count, threads, hf_csv__filter_task, &filter);
+        if(count) {
+            *count = 0;
+            for(size_t chunk = 0; chunk < chunk_count; chunk++) {
+                *count += filter.counts[chunk];
+            }
+        }
+    }
+
+    for(size_t leaf = 0; filter.leaves && leaf < filter.leaf_count; leaf++) {
+        hf_csv__free(&csv->allocator, filter.leaves[leaf].matches, filter.leaves[leaf].match_count);
+    }
+    hf_csv__free(&csv->allocator, filter.leaves, leaves_size ? leaves_size : 1);
+    hf_csv__free(&csv->allocator, filter.counts, sizeof(size_t) * (chunk_count ? chunk_count : 1));
+    return prepared;
+}
+
+HF_CSV* hf_csv_view(HF_CSV* csv, const uint64_t* selection) {
+    if(!csv || !selection || !hf_csv__materialize(csv)) {
+        return NULL;
+    }
+
+    size_t header = csv->dialect.header && csv->rows > 0 ? 1 : 0;
+    size_t rows = header;
+    for(size_t row = header; row < csv->rows; row++) {
+        rows += (selection[row / 64] >> (row % 64)) & 1;
+    }
+    if(rows == 0) {
+        return NULL;
+    }
+    HF_CSV* view = hf_csv__alloc_csv(&csv->allocator);
+    if(!view) {
+        return NULL;
+    }
+    view->values = (HF_CSV__cell**)hf_csv__alloc(&csv->allocator, sizeof(HF_CSV__cell*) * rows);
+    if(!view->values) {
+        hf_csv_destroy(view);
         return NULL;
     }
-    memset(new_csv->values, 0, sizeof(char**) * rows);
 
-    for(size_t row = 0; row < rows; row++) {
-        new_csv->values[row] = (char**)malloc(sizeof(char*) * columns);
-        if(!new_csv->values[row]) {
-            hf_csv_destroy(new_csv);
-            return NULL;
+    //views of views share the cells of the first source
+    view->row_capacity = rows;
+    view->columns = csv->columns;
+    view->column_capacity = csv->columns;
+    view->dialect = csv->dialect;
+    view->source = csv->source ? csv->source : csv;
+    if(header) {
+        view->values[view->rows++] = csv->values[0];
+    }
+    for(size_t row = header; row < csv->rows; row++) {
+        if((selection[row / 64] >> (row % 64)) & 1) {
+            view->values[view->rows++] = csv->values[row];
         }
-        memset(new_csv->values[row], 0, sizeof(char*) * columns);
     }
-
-    return new_csv;
+    return view;
 }
 
-HF_CSV* hf_csv_create_from_string(const char* string) {
-    if(!string) {
+HF_CSV_reader* hf_csv_reader_open(const char* filename) {
+    HF_CSV_reader* reader = (HF_CSV_reader*)malloc(sizeof(HF_CSV_reader));
+    if(!reader) {
         return NULL;
     }
+    memset(reader, 0, sizeof(HF_CSV_reader));
 
-    size_t buffer_size = 128;
-    char* buffer = (char*)malloc(buffer_size);
-    if(!buffer) {
+    reader->buffer_size = HF_CSV__READER_BUFFER_SIZE;
+    reader->buffer = (char*)malloc(reader->buffer_size + 1);
+    reader->file = hf_csv__fopen(filename, "rb");
+    if(!reader->buffer || !reader->file) {
+        hf_csv_reader_close(reader);
         return NULL;
     }
 
-    const char* string_itr = string;
+    return reader;
+}
 
-    //first-pass, count values and basic error check
-    size_t row_count = 0;
-    size_t column_count = 0;
-    size_t curr_row = 0;
-    size_t curr_column = 0; 
-    do {
-        bool valid = hf_csv__parse_value(&string_itr, &buffer, &buffer_size);
-        if(!valid) {
-            free(buffer);
-            return NULL;
-        }
+//moves unread bytes to the beginning of buffer and reads more from file, growing buffer if a single row doesn't fit in it.
+//Returns false if no bytes could be read
+static bool hf_csv__reader_fill(HF_CSV_reader* reader) {
+    if(reader->start > 0) {
+        memmove(reader->buffer, reader->buffer + reader->start, reader->filled - reader->start);
+        reader->filled -= reader->start;
+        reader->start = 0;
+    }
 
-        //only count columns in first row 
-        if(row_count == 0) {
-            column_count++;
+    if(reader->filled == reader->buffer_size) {
+        char* new_buffer = (char*)realloc(reader->buffer, reader->buffer_size * 2 + 1);
+        if(!new_buffer) {
+            reader->error = true;
+            return false;
         }
+        reader->buffer = new_buffer;
+        reader->buffer_size *= 2;
+    }
 
-        curr_column++;
-        if(*string_itr == '\n' || *string_itr == '\0') {
-            if(curr_row != 0 && curr_column != column_count) {//invalid amout of columns
-                free(buffer);
-                return NULL;
-            }
+    size_t read = fread(reader->buffer + reader->filled, 1, reader->buffer_size - reader->filled, reader->file);
+    if(read == 0) {
+        reader->eof = true;
+        reader->error = ferror(reader->file) != 0;
+        return false;
+    }
+    reader->filled += read;
+    return true;
+}
 
-            row_count++;
-            curr_row++;
-            curr_column = 0;
-            if(*string_itr == '\0') {
+bool hf_csv_reader_next_row(HF_CSV_reader* reader, const HF_CSV_value** values_ptr, size_t* columns_ptr) {
+    if(!reader || reader->error) {
+        return false;
+    }
+
+    //find end of row, the first newline outside quotes, refilling buffer as needed
+    size_t scan = reader->start;
+    bool in_quotes = false;
+    size_t row_end;
+    while(true) {
+        const char* scan_ptr = reader->buffer + scan;
+        const char* filled_ptr = reader->buffer + reader->filled;
+        const char* newline = (const char*)memchr(scan_ptr, '\n', (size_t)(filled_ptr - scan_ptr));
+        const char* scan_end = newline ? newline : filled_ptr;
+        while((scan_ptr = (const char*)memchr(scan_ptr, '\"', (size_t)(scan_end - scan_ptr))) != NULL) {
+            in_quotes = !in_quotes;
+            scan_ptr++;
+        }
+
+        if(newline) {
+            scan = (size_t)(newline - reader->buffer) + 1;
+            if(!in_quotes) {
+                row_end = scan;
                 break;
             }
+            continue;
         }
 
-        string_itr++;
-    } while(true);
-    
-    string_itr = string;
-    curr_row = 0;
-    curr_column = 0;
+        scan = reader->filled;
+        if(reader->eof) {
+            if(reader->start == reader->filled && reader->rows_read > 0) {//nothing left
+                return false;
+            }
+            row_end = reader->filled;
+            break;
+        }
 
-    //second pass, create csv and fill it with data
-    HF_CSV* new_csv = hf_csv_create(row_count, column_count);
-    if(!new_csv) {
-        free(buffer);
-        return NULL;
+        size_t consumed = reader->start;
+        if(!hf_csv__reader_fill(reader) && reader->error) {
+            return false;
+        }
+        scan -= consumed;
     }
 
-    do {
-        hf_csv__parse_value(&string_itr, &buffer, &buffer_size);
-
-        if(!hf_csv_set_value(new_csv, curr_row, curr_column, buffer)) {//likely allocation error
-            hf_csv_destroy(new_csv);
-            free(buffer);
-            return NULL;
+    //values are unescaped in place, which never writes past the byte being read
+    const char* itr = reader->buffer + reader->start;
+    const char* end = reader->buffer + row_end;
+    size_t column_count = 0;
+    while(true) {
+        if(column_count == reader->values_capacity) {
+            size_t new_capacity = reader->values_capacity ? reader->values_capacity * 2 : 16;
+            HF_CSV_value* new_values = (HF_CSV_value*)realloc(reader->values, sizeof(HF_CSV_value) * new_capacity);
+            if(!new_values) {
+                reader->error = true;
+                return false;
+            }
+            reader->values = new_values;
+            reader->values_capacity = new_capacity;
         }
 
-        curr_column++;
-        if(*string_itr == '\n') {
-            curr_row++;
-            curr_column = 0;
+        char* value = (char*)itr;
+        size_t length;
+        if(!hf_csv__parse_value(&itr, end, value, &length, &hf_csv__dialect_csv)) {
+            reader->error = true;
+            return false;
         }
+        reader->values[column_count].value = value;
+        reader->values[column_count].length = length;
+        column_count++;
 
-        if(*string_itr == '\0') {
+        if(itr == end) {
             break;
         }
+        itr++;//terminator was overwritten, but only a comma can come before the end of row
+    }
 
-        string_itr++;
-    } while(true);
-    
-    free(buffer);
-    return new_csv;
+    if(reader->rows_read == 0) {//only count columns in first row
+        reader->columns = column_count;
+    }
+    else if(column_count != reader->columns) {//invalid amout of columns
+        reader->error = true;
+        return false;
+    }
+
+    reader->start = row_end;
+    reader->rows_read++;
+    if(values_ptr) {
+        *values_ptr = reader->values;
+    }
+    if(columns_ptr) {
+        *columns_ptr = column_count;
+    }
+    return true;
 }
 
-void hf_csv_destroy(HF_CSV* csv) {
-    if(!csv) {
+bool hf_csv_reader_error(HF_CSV_reader* reader) {
+    return !reader || reader->error;
+}
+
+void hf_csv_reader_close(HF_CSV_reader* reader) {
+    if(!reader) {
         return;
     }
 
-    if(csv->values) {
-        for(size_t row = 0; row < csv->rows; row++) {
-            if(csv->values[row]) {
-                for(size_t column = 0; column < csv->columns; column++) {
-                    if(csv->values[row][column]) {
-                        free(csv->values[row][column]);
-                    }
-                }
-                free(csv->values[row]);
+    if(reader->file) {
+        fclose(reader->file);
+    }
+    free(reader->buffer);
+    free(reader->values);
+    free(reader);
+}
+
+#ifndef HF_CSV__SHARED_PAGE_ROWS
+#define HF_CSV__SHARED_PAGE_ROWS 256
+#endif
+
+//row of a shared version. Rows are never modified once published, writers replace them with copies
+typedef struct HF_CSV__shared_row_s {
+    HF_CSV__cell* cells;
+    bool owned;//cells, and values of cells marked owned, were allocated by a writer. Other rows belong to the wrapped csv
+} HF_CSV__shared_row;
+
+//memory no longer reachable from newer versions
+typedef struct HF_CSV__garbage_s {
+    struct HF_CSV__garbage_s* next;
+    void* block;
+    size_t size;
+} HF_CSV__garbage;
+
+//immutable state of a shared csv. Row pointers are split in pages, so writers only copy the page of the row they change
+typedef struct HF_CSV__version_s {
+    size_t rows;
+    size_t columns;
+    HF_CSV__shared_row** pages;
+    size_t page_count;
+    struct HF_CSV__version_s* next;//newer version, NULL for the current one
+    HF_CSV__garbage* garbage;//replaced by the next version, freed along with this one
+} HF_CSV__version;
+
+//hazard slot of a reader. Padded to a cache line so readers of different slots don't contend
+struct HF_CSV_version_s {
+    void* volatile version;//HF_CSV__version held by the reader, NULL for free slots. Only accessed atomically
+    const struct HF_CSV__version_s* state;//same version, read by the reader alone without synchronization
+    char padding[64 - 2 * sizeof(void*)];
+};
+
+struct HF_CSV_shared_s {
+    HF_CSV* csv;
+    void* volatile current;//latest HF_CSV__version
+    HF_CSV__version* oldest;//versions from oldest to current are linked through next, older ones were freed
+    HF_CSV_version* slots;
+    size_t slot_count;
+    volatile size_t next_slot;//where readers start looking for a free slot, spreads them over slots
+    HF_CSV__mutex mutex;//held by writers
+};
+
+static inline HF_CSV__shared_row* hf_csv__version_row(const HF_CSV__version* version, size_t row) {
+    return &version->pages[row / HF_CSV__SHARED_PAGE_ROWS][row % HF_CSV__SHARED_PAGE_ROWS];
+}
+
+static inline size_t hf_csv__shared_page_count(size_t rows) {
+    return (rows + HF_CSV__SHARED_PAGE_ROWS - 1) / HF_CSV__SHARED_PAGE_ROWS;
+}
+
+//allocates count garbage nodes, so that retiring blocks can't fail once a version is half built
+static bool hf_csv__garbage_reserve(HF_CSV_shared* shared, size_t count, HF_CSV__garbage** spare) {
+    *spare = NULL;
+    for(size_t i = 0; i < count; i++) {
+        HF_CSV__garbage* garbage = (HF_CSV__garbage*)hf_csv__alloc(&shared->csv->allocator, sizeof(HF_CSV__garbage));
+        if(!garbage) {
+            while(*spare) {
+                garbage = (*spare)->next;
+                hf_csv__free(&shared->csv->allocator, *spare, sizeof(HF_CSV__garbage));
+                *spare = garbage;
             }
+            return false;
         }
-        free(csv->values);
+        garbage->next = *spare;
+        *spare = garbage;
     }
-    free(csv);
+    return true;
+}
 
-    return;
+//adds block to the memory freed along with version, using one of the reserved nodes
+static void hf_csv__retire(HF_CSV__version* version, HF_CSV__garbage** spare, void* block, size_t size) {
+    HF_CSV__garbage* garbage = *spare;
+    *spare = garbage->next;
+    garbage->block = block;
+    garbage->size = size;
+    garbage->next = version->garbage;
+    version->garbage = garbage;
 }
 
-char* hf_csv_to_string(HF_CSV* csv) {
-    if(!csv) {
+static void hf_csv__version_free(HF_CSV_shared* shared, HF_CSV__version* version) {
+    HF_CSV_allocator* allocator = &shared->csv->allocator;
+    HF_CSV__garbage* garbage = version->garbage;
+    while(garbage) {
+        HF_CSV__garbage* next = garbage->next;
+        hf_csv__free(allocator, garbage->block, garbage->size);
+        hf_csv__free(allocator, garbage, sizeof(HF_CSV__garbage));
+        garbage = next;
+    }
+    hf_csv__free(allocator, version->pages, sizeof(HF_CSV__shared_row*) * version->page_count);
+    hf_csv__free(allocator, version, sizeof(HF_CSV__version));
+}
+
+//allocates a version whose page table is copied from base, pages themselves are shared until replaced
+static HF_CSV__version* hf_csv__version_create(HF_CSV_shared* shared, const HF_CSV__version* base, size_t rows, size_t columns) {
+    HF_CSV_allocator* allocator = &shared->csv->allocator;
+    HF_CSV__version* version = (HF_CSV__version*)hf_csv__alloc(allocator, sizeof(HF_CSV__version));
+    if(!version) {
+        return NULL;
+    }
+    version->rows = rows;
+    version->columns = columns;
+    version->page_count = hf_csv__shared_page_count(rows);
+    version->next = NULL;
+    version->garbage = NULL;
+    version->pages = (HF_CSV__shared_row**)hf_csv__alloc(allocator, sizeof(HF_CSV__shared_row*) * version->page_count);
+    if(!version->pages) {
+        hf_csv__free(allocator, version, sizeof(HF_CSV__version));
         return NULL;
     }
+    for(size_t page = 0; page < version->page_count; page++) {
+        version->pages[page] = base && page < base->page_count ? base->pages[page] : NULL;
+    }
+    return version;
+}
 
-    size_t len = 1;
-    for(size_t row = 0; row < csv->rows; row++) {
-        if(row != 0) {//add extra space for \r\n
-            len += 2;
+//allocates an empty page, or a copy of page
+static HF_CSV__shared_row* hf_csv__shared_page_copy(HF_CSV_shared* shared, const HF_CSV__shared_row* page) {
+    size_t size = sizeof(HF_CSV__shared_row) * HF_CSV__SHARED_PAGE_ROWS;
+    HF_CSV__shared_row* copy = (HF_CSV__shared_row*)hf_csv__alloc(&shared->csv->allocator, size);
+    if(copy) {
+        if(page) {
+            memcpy(copy, page, size);
+        }
+        else {
+            memset(copy, 0, size);
         }
+    }
+    return copy;
+}
 
-        for(size_t column = 0; column < csv->columns; column++) {
-            if(column != 0) {//add extra space for comma
-                len++;
-            }
+//allocates a row of columns cells holding the first values of row, if any, and empty ones after them. Values are shared with row, and only
+//marked owned if row was allocated by a writer too
+static HF_CSV__cell* hf_csv__shared_row_copy(HF_CSV_shared* shared, const HF_CSV__shared_row* row, size_t row_columns, size_t columns) {
+    HF_CSV__cell* cells = (HF_CSV__cell*)hf_csv__alloc(&shared->csv->allocator, sizeof(HF_CSV__cell) * columns);
+    if(!cells) {
+        return NULL;
+    }
+    size_t copied = row ? (row_columns < columns ? row_columns : columns) : 0;
+    if(copied > 0) {
+        memcpy(cells, row->cells, sizeof(HF_CSV__cell) * copied);
+    }
+    for(size_t column = 0; column < copied && !row->owned; column++) {
+        cells[column].owned = false;
+    }
+    memset(cells + copied, 0, sizeof(HF_CSV__cell) * (columns - copied));
+    return cells;
+}
 
-            const char* value = csv->values[row][column];
-            if(!value) {//uninitialized value
-                continue;
-            }
+//makes version the current one and frees versions no reader holds anymore. version must be the next one of the current version.
+//A version can only be freed along with every older one, since its garbage may still be referenced by them
+static void hf_csv__shared_publish(HF_CSV_shared* shared, HF_CSV__version* version) {
+    HF_CSV__version* current = (HF_CSV__version*)shared->current;
+    current->next = version;
+    hf_csv__atomic_store(&shared->current, version);
 
-            size_t value_len = strlen(value);
-            len += value_len;
+    while(shared->oldest != version) {
+        bool held = false;
+        for(size_t slot = 0; slot < shared->slot_count && !held; slot++) {
+            held = hf_csv__atomic_load(&shared->slots[slot].version) == shared->oldest;
+        }
+        if(held) {
+            break;
+        }
+        HF_CSV__version* next = shared->oldest->next;
+        hf_csv__version_free(shared, shared->oldest);
+        shared->oldest = next;
+    }
+}
 
-            //check if quotes are needed
-            for(size_t i = 0; i < value_len; i++) {
-                if(value[i] == '\n' || value[i] == '\"' || value[i] == ',') {
-                    len += 2;
-                    break;
-                }
-            }
-            //check for double quotes requirement
-            for(size_t i = 0; i < value_len; i++) {
-                if(value[i] == '\"') {
-                    len++;
-                }
+HF_CSV_shared* hf_csv_shared_create(HF_CSV* csv, size_t max_readers) {
+    if(!csv || max_readers == 0 || !hf_csv__materialize(csv) || !hf_csv__detach(csv)) {
+        return NULL;
+    }
+    //versions are read concurrently without the view lock, so values must be null-terminated beforehand
+    for(size_t row = 0; row < csv->rows; row++) {
+        for(size_t column = 0; column < csv->columns; column++) {
+            if(csv->values[row][column].view && !hf_csv_get_value(csv, row, column)) {
+                return NULL;
             }
         }
     }
 
-    char* out_string = (char*)malloc(len);
-    if(!out_string) {
+    HF_CSV_shared* shared = (HF_CSV_shared*)hf_csv__alloc(&csv->allocator, sizeof(HF_CSV_shared));
+    if(!shared) {
+        return NULL;
+    }
+    shared->csv = csv;
+    shared->slot_count = max_readers;
+    shared->next_slot = 0;
+    shared->slots = (HF_CSV_version*)hf_csv__alloc(&csv->allocator, sizeof(HF_CSV_version) * max_readers);
+    if(!shared->slots || !hf_csv__mutex_init(&shared->mutex)) {
+        hf_csv__free(&csv->allocator, shared->slots, sizeof(HF_CSV_version) * max_readers);
+        hf_csv__free(&csv->allocator, shared, sizeof(HF_CSV_shared));
         return NULL;
     }
+    for(size_t slot = 0; slot < max_readers; slot++) {
+        shared->slots[slot].version = NULL;
+    }
 
-    size_t index = 0;
-    for(size_t row = 0; row < csv->rows; row++) {
-        if(row != 0) {
-            out_string[index++] = '\r';
-            out_string[index++] = '\n';
+    //first version refers to the rows of csv, which stay untouched until destroy
+    HF_CSV__version* version = hf_csv__version_create(shared, NULL, csv->rows, csv->columns);
+    bool failed = !version;
+    for(size_t page = 0; !failed && page < version->page_count; page++) {
+        version->pages[page] = hf_csv__shared_page_copy(shared, NULL);
+        failed = !version->pages[page];
+    }
+    if(failed) {
+        for(size_t page = 0; version && page < version->page_count; page++) {
+            hf_csv__free(&csv->allocator, version->pages[page], sizeof(HF_CSV__shared_row) * HF_CSV__SHARED_PAGE_ROWS);
         }
+        if(version) {
+            hf_csv__version_free(shared, version);
+        }
+        hf_csv__mutex_destroy(&shared->mutex);
+        hf_csv__free(&csv->allocator, shared->slots, sizeof(HF_CSV_version) * max_readers);
+        hf_csv__free(&csv->allocator, shared, sizeof(HF_CSV_shared));
+        return NULL;
+    }
+    for(size_t row = 0; row < csv->rows; row++) {
+        hf_csv__version_row(version, row)->cells = csv->values[row];
+    }
+    shared->current = version;
+    shared->oldest = version;
+    return shared;
+}
 
-        for(size_t column = 0; column < csv->columns; column++) {
-            if(column != 0) {
-                out_string[index++] = ',';
-            }
+void hf_csv_shared_destroy(HF_CSV_shared* shared) {
+    if(!shared) {
+        return;
+    }
 
-            const char* value = csv->values[row][column];
-            if(!value) {//uninitialized value
-                continue;
+    HF_CSV* csv = shared->csv;
+    HF_CSV_allocator* allocator = &csv->allocator;
+    HF_CSV__version* current = (HF_CSV__version*)shared->current;
+    for(size_t row = 0; row < current->rows; row++) {
+        HF_CSV__shared_row* shared_row = hf_csv__version_row(current, row);
+        for(size_t column = 0; column < current->columns && shared_row->owned; column++) {
+            HF_CSV__cell* cell = &shared_row->cells[column];
+            if(cell->owned) {
+                hf_csv__free(allocator, cell->value, cell->length + 1);
             }
+        }
+        if(shared_row->owned) {
+            hf_csv__free(allocator, shared_row->cells, sizeof(HF_CSV__cell) * current->columns);
+        }
+    }
+    for(size_t page = 0; page < current->page_count; page++) {
+        hf_csv__free(allocator, current->pages[page], sizeof(HF_CSV__shared_row) * HF_CSV__SHARED_PAGE_ROWS);
+    }
 
-            size_t value_len = strlen(value);
+    HF_CSV__version* version = shared->oldest;
+    while(version) {
+        HF_CSV__version* next = version->next;
+        hf_csv__version_free(shared, version);
+        version = next;
+    }
+    hf_csv__mutex_destroy(&shared->mutex);
+    hf_csv__free(allocator, shared->slots, sizeof(HF_CSV_version) * shared->slot_count);
+    hf_csv__free(allocator, shared, sizeof(HF_CSV_shared));
+    hf_csv_destroy(csv);
+}
 
-            //check if quotes are needed
-            bool needs_quotes = false;
-            for(size_t i = 0; i < value_len; i++) {
-                if(value[i] == '\n' || value[i] == '\"' || value[i] == ',') {
-                    needs_quotes = true;
-                    break;
-                }
-            }
-            
-            //beggining quote
-            if(needs_quotes) {
-                out_string[index++] = '\"';
-            }
+const HF_CSV_version* hf_csv_shared_acquire(HF_CSV_shared* shared) {
+    if(!shared) {
+        return NULL;
+    }
 
-            //copy contents
-            for(size_t i = 0; i < value_len; i++) {
-                char c = value[i];
-                out_string[index++] = c;
-                if(c == '\"') {//make double quote
-                    out_string[index++] = c;
-                }
-            }
+    size_t start = hf_csv__atomic_increment(&shared->next_slot);
+    for(size_t i = 0; i < shared->slot_count; i++) {
+        HF_CSV_version* slot = &shared->slots[(start + i) % shared->slot_count];
+        void* version = hf_csv__atomic_load(&shared->current);
+        if(!hf_csv__atomic_replace(&slot->version, NULL, version)) {//taken by another reader
+            continue;
+        }
 
-            //ending quotes
-            if(needs_quotes) {
-                out_string[index++] = '\"';
-            }
+        //version may have been replaced, and freed, before the slot was seen by the writer
+        void* latest;
+        while((latest = hf_csv__atomic_load(&shared->current)) != version) {
+            version = latest;
+            hf_csv__atomic_store(&slot->version, version);
         }
+        slot->state = (const HF_CSV__version*)version;
+        return slot;
     }
-
-    out_string[len - 1] = '\0';
-    return out_string;
+    return NULL;
 }
 
-void hf_csv_free_string(char* string) {
-    free(string);
+void hf_csv_shared_release(HF_CSV_shared* shared, const HF_CSV_version* version) {
+    if(!shared || !version) {
+        return;
+    }
+    hf_csv__atomic_store(&((HF_CSV_version*)version)->version, NULL);
 }
 
-bool hf_csv_to_file(HF_CSV* csv, const char* filename) {
-    FILE* file = hf_csv__fopen(filename, "w");
-    if(!file) {
+bool hf_csv_version_get_size(const HF_CSV_version* version, size_t* rows, size_t* columns) {
+    if(!version) {
         return false;
     }
 
-    char* string = hf_csv_to_string(csv);
-    if(!string) {
-        return false;
+    const HF_CSV__version* state = version->state;
+    if(rows) {
+        *rows = state->rows;
+    }
+    if(columns) {
+        *columns = state->columns;
     }
+    return true;
+}
 
-    fprintf(file, "%s", string);
+const char* hf_csv_version_get_value(const HF_CSV_version* version, size_t row, size_t column) {
+    return hf_csv_version_get_value_n(version, row, column, NULL);
+}
 
-    free(string);
-    fclose(file);
-    return true;
+const char* hf_csv_version_get_value_n(const HF_CSV_version* version, size_t row, size_t column, size_t* length) {
+    if(!version) {
+        return NULL;
+    }
+    const HF_CSV__version* state = version->state;
+    if(row >= state->rows || column >= state->columns) {
+        return NULL;
+    }
+
+    const HF_CSV__cell* cell = &hf_csv__version_row(state, row)->cells[column];
+    if(length) {
+        *length = cell->value ? cell->length : 0;
+    }
+    return cell->value ? cell->value : "";
 }
 
-bool hf_csv_find_row(HF_CSV* csv, size_t column, const char* value, size_t* row) {
-    if(!csv || column >= csv->columns) {
+bool hf_csv_shared_set_value_n(HF_CSV_shared* shared, size_t row, size_t column, const char* value, size_t length) {
+    if(!shared || !value) {
         return false;
     }
 
-    for(size_t r = 0; r < csv->rows; r++) {
-        const char* value_to_compare = hf_csv_get_value(csv, r, column);
-        if(strcmp(value, value_to_compare) == 0) {
-            if(row) {
-                *row = r;
-            }
-            return true;
-        }
+    hf_csv__mutex_lock(&shared->mutex);
+    HF_CSV_allocator* allocator = &shared->csv->allocator;
+    HF_CSV__version* current = (HF_CSV__version*)shared->current;
+    if(row >= current->rows || column >= current->columns) {
+        hf_csv__mutex_unlock(&shared->mutex);
+        return false;
     }
 
-    return false;
-}
-
-bool hf_csv_find_column(HF_CSV* csv, size_t row, const char* value, size_t* column) {
-    if(!csv || row >= csv->rows) {
+    //copies of the value, row and page, then a version pointing to them. The replaced page, and row and value if a writer allocated them, are retired
+    size_t page = row / HF_CSV__SHARED_PAGE_ROWS;
+    const HF_CSV__shared_row* old_row = hf_csv__version_row(current, row);
+    const HF_CSV__cell* old_cell = &old_row->cells[column];
+    size_t retired = 1 + (old_row->owned ? 1 + (old_cell->owned ? 1 : 0) : 0);
+    HF_CSV__garbage* spare = NULL;
+    char* new_value = (char*)hf_csv__alloc(allocator, length + 1);
+    HF_CSV__cell* cells = hf_csv__shared_row_copy(shared, old_row, current->columns, current->columns);
+    HF_CSV__shared_row* new_page = hf_csv__shared_page_copy(shared, current->pages[page]);
+    HF_CSV__version* version = hf_csv__version_create(shared, current, current->rows, current->columns);
+    if(!new_value || !cells || !new_page || !version || !hf_csv__garbage_reserve(shared, retired, &spare)) {
+        hf_csv__free(allocator, new_value, length + 1);
+        hf_csv__free(allocator, cells, sizeof(HF_CSV__cell) * current->columns);
+        hf_csv__free(allocator, new_page, sizeof(HF_CSV__shared_row) * HF_CSV__SHARED_PAGE_ROWS);
+        if(version) {
+            hf_csv__version_free(shared, version);
+        }
+        hf_csv__mutex_unlock(&shared->mutex);
         return false;
     }
 
-    for(size_t c = 0; c < csv->columns; c++) {
-        const char* value_to_compare = hf_csv_get_value(csv, row, c);
-        if(strcmp(value, value_to_compare) == 0) {
-            if(column) {
-                *column = c;
-            }
-            return true;
+    hf_csv__retire(current, &spare, current->pages[page], sizeof(HF_CSV__shared_row) * HF_CSV__SHARED_PAGE_ROWS);
+    if(old_row->owned) {
+        if(old_cell->owned) {
+            hf_csv__retire(current, &spare, old_cell->value, old_cell->length + 1);
         }
+        hf_csv__retire(current, &spare, old_row->cells, sizeof(HF_CSV__cell) * current->columns);
     }
 
-    return false;
+    memcpy(new_value, value, length);
+    new_value[length] = '\0';
+    cells[column].value = new_value;
+    cells[column].length = length;
+    cells[column].owned = true;
+    cells[column].view = false;
+    cells[column].code = 0;
+    new_page[row % HF_CSV__SHARED_PAGE_ROWS].cells = cells;
+    new_page[row % HF_CSV__SHARED_PAGE_ROWS].owned = true;
+    version->pages[page] = new_page;
+    hf_csv__shared_publish(shared, version);
+    hf_csv__mutex_unlock(&shared->mutex);
+    return true;
 }
 
-const char* hf_csv_get_value(HF_CSV* csv, size_t row, size_t column) {
-    if(!csv || row >= csv->rows || column >= csv->columns) {
-        return NULL;
-    }
-
-    const char* value = csv->values[row][column];
+bool hf_csv_shared_set_value(HF_CSV_shared* shared, size_t row, size_t column, const char* value) {
     if(!value) {
-        return "";
+        return false;
     }
-    return value;
+    return hf_csv_shared_set_value_n(shared, row, column, value, strlen(value));
 }
 
-bool hf_csv_set_value(HF_CSV* csv, size_t row, size_t column, const char* value) {
-    if(!csv || !value || row >= csv->rows || column >= csv->columns) {
+//resize of hf_csv_shared_resize, called with the mutex held
+static bool hf_csv__shared_resize(HF_CSV_shared* shared, size_t rows, size_t columns) {
+    HF_CSV_allocator* allocator = &shared->csv->allocator;
+    HF_CSV__version* current = (HF_CSV__version*)shared->current;
+    if(rows == 0 || columns == 0 || (rows == current->rows && columns == current->columns)) {
         return false;
     }
 
-    size_t new_size = strlen(value) + 1;
-    char* new_str = (char*)realloc(csv->values[row][column], sizeof(char) * new_size);
-    if(!new_str) {
-        return false;
-    }
-    csv->values[row][column] = new_str;
-    memcpy(csv->values[row][column], value, new_size);
+    //rows from first_row and pages from first_page are new, others are shared with the current version.
+    //Keeping the columns only touches the page of the last row, removed rows are left in shared pages past the end
+    bool widen = columns != current->columns;
+    size_t page_count = hf_csv__shared_page_count(rows);
+    size_t first_row = widen ? 0 : current->rows;
+    size_t first_page = widen ? 0 : (rows > current->rows ? current->rows / HF_CSV__SHARED_PAGE_ROWS : page_count);
+    size_t page_size = sizeof(HF_CSV__shared_row) * HF_CSV__SHARED_PAGE_ROWS;
 
-    return true;
-}
+    HF_CSV__version* version = hf_csv__version_create(shared, current, rows, columns);
+    bool failed = !version;
+    size_t built_pages = first_page;
+    for(size_t page = first_page; !failed && page < page_count; page++, built_pages++) {
+        version->pages[page] = hf_csv__shared_page_copy(shared, page < current->page_count ? current->pages[page] : NULL);
+        failed = !version->pages[page];
+    }
+    size_t built_rows = first_row;
+    for(size_t row = first_row; !failed && row < rows; row++, built_rows++) {
+        HF_CSV__shared_row* new_row = hf_csv__version_row(version, row);
+        new_row->cells = hf_csv__shared_row_copy(shared, row < current->rows ? hf_csv__version_row(current, row) : NULL, current->columns, columns);
+        new_row->owned = true;
+        failed = !new_row->cells;
+    }
 
-bool hf_csv_get_size(HF_CSV* csv, size_t* rows, size_t* columns) {
-    if(!csv) {
+    //replaced pages, and rows and values allocated by writers that are removed or copied
+    size_t first_retired_row = widen ? 0 : rows;
+    size_t retired = first_page < current->page_count ? current->page_count - first_page : 0;
+    for(size_t row = first_retired_row; row < current->rows; row++) {
+        const HF_CSV__shared_row* old_row = hf_csv__version_row(current, row);
+        for(size_t column = 0; column < current->columns && old_row->owned; column++) {
+            retired += old_row->cells[column].owned && (row >= rows || column >= columns);
+        }
+        retired += old_row->owned;
+    }
+    HF_CSV__garbage* spare = NULL;
+    if(failed || !hf_csv__garbage_reserve(shared, retired, &spare)) {
+        for(size_t row = first_row; row < built_rows; row++) {
+            HF_CSV__shared_row* new_row = hf_csv__version_row(version, row);
+            hf_csv__free(allocator, new_row->cells, sizeof(HF_CSV__cell) * columns);
+        }
+        for(size_t page = first_page; page < built_pages; page++) {
+            hf_csv__free(allocator, version->pages[page], page_size);
+        }
+        if(version) {
+            hf_csv__version_free(shared, version);
+        }
         return false;
     }
 
-    if(rows) {
-        *rows = csv->rows;
+    for(size_t page = first_page; page < current->page_count; page++) {
+        hf_csv__retire(current, &spare, current->pages[page], page_size);
     }
-    if(columns) {
-        *columns = csv->columns;
+    for(size_t row = first_retired_row; row < current->rows; row++) {
+        const HF_CSV__shared_row* old_row = hf_csv__version_row(current, row);
+        if(!old_row->owned) {
+            continue;
+        }
+        for(size_t column = 0; column < current->columns; column++) {
+            const HF_CSV__cell* cell = &old_row->cells[column];
+            if(cell->owned && (row >= rows || column >= columns)) {
+                hf_csv__retire(current, &spare, cell->value, cell->length + 1);
+            }
+        }
+        hf_csv__retire(current, &spare, old_row->cells, sizeof(HF_CSV__cell) * current->columns);
     }
+    hf_csv__shared_publish(shared, version);
     return true;
 }
 
-bool hf_csv_resize(HF_CSV* csv, size_t rows, size_t columns) {
-    if(!csv || rows == 0 || columns == 0 || (rows == csv->rows && columns == csv->columns)) {
+bool hf_csv_shared_resize(HF_CSV_shared* shared, size_t rows, size_t columns) {
+    if(!shared) {
         return false;
     }
 
-    //create a new csv to temporarily store values
-    HF_CSV* new_csv = hf_csv_create(rows, columns);
-    if(!new_csv) {
-        return false;//
-    }
-
-    size_t min_rows = csv->rows > rows ? rows : csv->rows;
-    size_t min_columns = csv->columns > columns ? columns : csv->columns;
+    hf_csv__mutex_lock(&shared->mutex);
+    bool success = hf_csv__shared_resize(shared, rows, columns);
+    hf_csv__mutex_unlock(&shared->mutex);
+    return success;
+}
 
-    //copy each value into new csv
-    for(size_t row = 0; row < min_rows; row++) {
-        for(size_t column = 0; column < min_columns; column++) {
-            bool res = hf_csv_set_value(new_csv, row, column, hf_csv_get_value(csv, row, column));
-            if(!res) {
-                hf_csv_destroy(new_csv);
-                return false;
-            }
-        }
+bool hf_csv_shared_append_row(HF_CSV_shared* shared) {
+    if(!shared) {
+        return false;
     }
 
-    //swap values between csv structs and free temp
-    HF_CSV temp_csv = *csv;
-    *csv = *new_csv;
-    *new_csv = temp_csv;
-    hf_csv_destroy(new_csv);
-
-    return true;
+    hf_csv__mutex_lock(&shared->mutex);
+    const HF_CSV__version* current = (const HF_CSV__version*)shared->current;
+    bool success = hf_csv__shared_resize(shared, current->rows + 1, current->columns);
+    hf_csv__mutex_unlock(&shared->mutex);
+    return success;
 }
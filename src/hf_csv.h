@@ -3,63 +3,514 @@
 
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
 
 typedef struct HF_CSV_s HF_CSV;
+typedef struct HF_CSV_reader_s HF_CSV_reader;
+typedef struct HF_CSV_writer_s HF_CSV_writer;
+typedef struct HF_CSV_pool_s HF_CSV_pool;
+typedef struct HF_CSV_shared_s HF_CSV_shared;
+typedef struct HF_CSV_version_s HF_CSV_version;
+
+//Memory functions used for every allocation owned by a csv struct, including strings returned by hf_csv_to_string, and for the scratch memory of operations on it.
+//Only two allocations never go through them: HF_CSV_reader and HF_CSV_writer, which belong to no csv struct, and the copy made to convert a number of 128 bytes or more
+//that can't be converted exactly, which happens on the worker threads of parallel operations, where a pool allocator could not be used.
+//Sizes are always provided, so allocators don't need to track them: free and realloc get the size the block was last allocated with.
+//realloc is never called with a NULL block. user is passed to every function untouched.
+typedef struct HF_CSV_allocator_s {
+    void* (*alloc)(void* user, size_t size);
+    void* (*realloc)(void* user, void* block, size_t old_size, size_t new_size);
+    void (*free)(void* user, void* block, size_t size);
+    void* user;
+} HF_CSV_allocator;
+
+//A value read by HF_CSV_reader or written by HF_CSV_writer. Values read are null-terminated and point into the reader's own buffer.
+typedef struct HF_CSV_value_s {
+    const char* value;
+    size_t length;
+} HF_CSV_value;
+
+//How quotes and other characters are escaped inside quoted values.
+typedef enum HF_CSV_escape_e {
+    HF_CSV_ESCAPE_DOUBLE,//a quote is written twice, as in RFC 4180
+    HF_CSV_ESCAPE_BACKSLASH,//any character preceded by a backslash is taken as is, and the backslash dropped
+} HF_CSV_escape;
+
+//Syntax of a csv file, see hf_csv_dialect. Rows are always saved separated by \r\n, and both \n and \r\n are accepted when parsing.
+typedef struct HF_CSV_dialect_s {
+    char delimiter;//separates values of a row. Can't be a null character, quote, newline, carriage or, when trimming, a space or tab
+    char quote;//encloses values holding delimiters, newlines or quotes. '\0' disables quoting, such values can't be saved then
+    HF_CSV_escape escape;
+    char comment;//lines starting with it are skipped when parsing, '\0' for none. Values starting with it are quoted when saved first in a row
+    bool header;//first row holds column names, and is never passed to load predicates
+    bool trim;//spaces and tabs around values are dropped when parsing. Values starting or ending with them are quoted when saved
+} HF_CSV_dialect;
+
+//Types a column can be converted to by hf_csv_get_column.
+typedef enum HF_CSV_type_e {
+    HF_CSV_TYPE_INT64,//int64_t values, optionally signed decimal digits
+    HF_CSV_TYPE_DOUBLE,//double values, decimal numbers with optional fraction and exponent
+    HF_CSV_TYPE_BOOL,//bool values, true/false in any case or 1/0
+    HF_CSV_TYPE_DATE,//int32_t values, days since 1970-01-01 of a YYYY-MM-DD date
+    HF_CSV_TYPE_TEXT,//any other value, only reported by hf_csv_infer_schema
+} HF_CSV_type;
+
+//A column converted to contiguous values of a single type.
+typedef struct HF_CSV_column_s {
+    HF_CSV_type type;
+    size_t rows;//amount of values
+    const void* values;//array of rows values of the C type listed in HF_CSV_type. Values that could not be converted are 0
+    const unsigned char* validity;//bit (i % 8) of byte (i / 8) is set if value i was converted, empty and malformed values are not
+    size_t null_count;//amount of values not converted
+} HF_CSV_column;
+
+//Column type and width found by hf_csv_infer_schema.
+typedef struct HF_CSV_column_schema_s {
+    HF_CSV_type type;//first of int64, double, bool and date every non-empty sampled value converts to, text otherwise
+    size_t max_width;//length in bytes of the longest sampled value, after unescaping
+    size_t null_count;//amount of empty sampled values
+} HF_CSV_column_schema;
+
+//Reasons a csv could not be loaded, or rows of it were recovered.
+typedef enum HF_CSV_error_kind_e {
+    HF_CSV_ERROR_NONE,
+    HF_CSV_ERROR_UNCLOSED_QUOTE,//quoted value never closed, offset is its opening quote
+    HF_CSV_ERROR_UNEXPECTED_QUOTE,//quote inside a value that doesn't start with one
+    HF_CSV_ERROR_TEXT_AFTER_QUOTE,//characters between the closing quote of a value and the next delimiter or newline
+    HF_CSV_ERROR_COLUMN_COUNT,//row has another amount of values than the first one, offset is where it starts and column its amount of values
+    HF_CSV_ERROR_MISSING_COLUMN,//a column to keep is not in the input, column is its position in columns or names of the options
+    HF_CSV_ERROR_NO_ROWS,//every row was dropped
+    HF_CSV_ERROR_INVALID_OPTIONS,
+    HF_CSV_ERROR_OUT_OF_MEMORY,
+    HF_CSV_ERROR_IO,//file could not be opened or read
+} HF_CSV_error_kind;
+
+//An error found while loading a csv.
+typedef struct HF_CSV_error_s {
+    HF_CSV_error_kind kind;
+    size_t offset;//in bytes from the start of the input
+    size_t line;//line of offset, from 1. Quoted newlines count as lines too
+    size_t row;//row of the input, from 0, counting rows that were dropped
+    size_t column;//value of the row, from 0
+} HF_CSV_error;
+
+//Errors found while loading a csv, filled in input order. Only the first capacity ones are kept, but all are counted.
+typedef struct HF_CSV_diagnostics_s {
+    HF_CSV_error* errors;//array of capacity errors, can be NULL to only count them
+    size_t capacity;
+    size_t count;//set to the amount of errors found, can exceed capacity
+} HF_CSV_diagnostics;
+
+//What to do with malformed rows.
+typedef enum HF_CSV_recovery_e {
+    HF_CSV_RECOVERY_NONE,//loading fails on the first malformed row
+    HF_CSV_RECOVERY_SKIP,//malformed rows are dropped, parsing resumes after the line where the error was found
+    HF_CSV_RECOVERY_PAD,//rows with too few values get empty ones, and extra values are dropped. Other malformed rows are dropped
+} HF_CSV_recovery;
+
+//Rows kept by hf_csv_join.
+typedef enum HF_CSV_join_kind_e {
+    HF_CSV_JOIN_INNER,//every pair of matching rows, with the values of the left row followed by those of the right one
+    HF_CSV_JOIN_LEFT,//same as inner, plus left rows without match followed by empty values
+    HF_CSV_JOIN_SEMI,//left rows with at least one match, only with their own values
+    HF_CSV_JOIN_ANTI,//left rows without match, only with their own values
+} HF_CSV_join_kind;
+
+//How hf_csv_sort orders the values of a key.
+typedef enum HF_CSV_collation_e {
+    HF_CSV_COLLATION_BYTES,//byte by byte, shorter values first when one starts the other
+    HF_CSV_COLLATION_NUMERIC,//by number, values that are not numbers come after every number and compare as bytes
+    HF_CSV_COLLATION_NATURAL,//runs of digits compare as numbers, so "file9" comes before "file10". Ties compare as bytes
+} HF_CSV_collation;
+
+//Column hf_csv_sort orders rows by. Later keys only order rows whose earlier keys are equal.
+typedef struct HF_CSV_sort_key_s {
+    size_t column;
+    HF_CSV_collation collation;
+    bool descending;
+} HF_CSV_sort_key;
+
+//Flags of hf_csv_sort.
+#define HF_CSV_SORT_KEEP_HEADER 1//the first row stays first, as it does when the dialect has a header
+
+//Value hf_csv_group_by computes for each group.
+typedef enum HF_CSV_aggregate_kind_e {
+    HF_CSV_AGGREGATE_COUNT,//rows of the group, column is ignored
+    HF_CSV_AGGREGATE_SUM,//sum of the numbers of column, 0 if there are none
+    HF_CSV_AGGREGATE_MIN,//smallest number of column, empty if there are none
+    HF_CSV_AGGREGATE_MAX,//largest number of column, empty if there are none
+    HF_CSV_AGGREGATE_MEAN,//mean of the numbers of column, empty if there are none
+} HF_CSV_aggregate_kind;
+
+typedef struct HF_CSV_aggregate_s {
+    HF_CSV_aggregate_kind kind;
+    size_t column;
+} HF_CSV_aggregate;
+
+//What an HF_CSV_condition checks.
+typedef enum HF_CSV_condition_kind_e {
+    HF_CSV_CONDITION_EQUALS,//value of column is value
+    HF_CSV_CONDITION_PREFIX,//value of column starts with value
+    HF_CSV_CONDITION_CONTAINS,//value of column contains value
+    HF_CSV_CONDITION_RANGE,//value of column is a number between minimum and maximum, both included
+    HF_CSV_CONDITION_AND,//every one of conditions holds, true if there are none
+    HF_CSV_CONDITION_OR,//any of conditions holds, false if there are none
+} HF_CSV_condition_kind;
+
+//Condition on the values of a row, for hf_csv_filter. Values never set are empty. Fields a kind doesn't list are ignored.
+typedef struct HF_CSV_condition_s {
+    HF_CSV_condition_kind kind;
+    size_t column;
+    const char* value;//null-terminated
+    double minimum;
+    double maximum;
+    const struct HF_CSV_condition_s* conditions;
+    size_t condition_count;
+} HF_CSV_condition;
+
+//Options of hf_csv_create_from_string_with_options and hf_csv_create_from_file_with_options. Zero-initialized options load everything.
+typedef struct HF_CSV_load_options_s {
+    const size_t* columns;//indices of the columns to keep, in the order they will be stored. NULL keeps every column
+    const char* const* names;//header names of the columns to keep, used instead of columns if not NULL. The header row is kept too
+    size_t column_count;//length of columns or names. Each column can only be kept once
+    //Called for every row with its kept values, which are NOT null-terminated. Returning false drops the row. Not called for the header row when keeping columns by name or with a header dialect
+    bool (*predicate)(void* user, size_t row, const HF_CSV_value* values, size_t count);
+    void* user;//passed to predicate untouched
+    size_t max_rows;//stops after this many rows of input, 0 reads all of them
+    const HF_CSV_allocator* allocator;//NULL uses the C library allocator
+    const HF_CSV_dialect* dialect;//NULL parses plain csv. The csv struct keeps the dialect to be saved with
+    HF_CSV_recovery recovery;//errors of the first row, which sets the amount of columns, are never recovered
+    HF_CSV_diagnostics* diagnostics;//if not NULL, receives every error found, recovered or not
+    const size_t* dictionary_columns;//kept columns encoded as by hf_csv_encode_column while parsing, so repeated values are never copied. NULL encodes none
+    size_t dictionary_column_count;//length of dictionary_columns
+} HF_CSV_load_options;
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+//Returns the dialect of plain csv files, using delimiter instead of commas: ',' for csv, '\t' for tsv, ';' for semicolon separated files.
+//Values are quoted with '"' and quotes escaped by doubling them, without comments, header or trimming. These three dialects have their own parsers, others share a slower one.
+HF_CSV_dialect hf_csv_dialect(char delimiter);
+
+//Sets the dialect csv is saved with by hf_csv_to_string and hf_csv_to_file, e.g. to convert a tsv file to csv.
+//Returns true on success, false if csv is invalid or dialect is not valid.
+bool hf_csv_set_dialect(HF_CSV* csv, const HF_CSV_dialect* dialect);
+
 //Creates a new csv struct with given dimensions.
 //returns a newly allocated HF_CSV struct on success, NULL if any of the dimensions is 0.
 HF_CSV* hf_csv_create(size_t rows, size_t columns);
 
-//Creates a csv struct from a file
+//Same as hf_csv_create, but every allocation of the csv goes through allocator, which is copied into the struct. NULL uses the C library allocator.
+HF_CSV* hf_csv_create_with_allocator(size_t rows, size_t columns, const HF_CSV_allocator* allocator);
+
+//Creates a csv struct from a file. The file is mapped into memory and stays mapped until the struct is destroyed, values are read from it in place whenever possible.
+//Values may contain null characters, see hf_csv_get_value_n.
 //returns a newly allocated HF_CSV struct on success, NULL if file does not exist.
 HF_CSV* hf_csv_create_from_file(const char* filename);
 
+//Same as hf_csv_create_from_file, but every allocation of the csv goes through allocator. NULL uses the C library allocator.
+HF_CSV* hf_csv_create_from_file_with_allocator(const char* filename, const HF_CSV_allocator* allocator);
+
+//Opens a file lazily. Only the start of every row is located on load, rows are decoded when their values are first read, and up to cache_rows decoded rows are kept (least recently used are dropped first).
+//Memory used depends on the rows being read rather than on the size of the file. Since rows are not validated on load, reading a malformed row returns NULL.
+//Values returned by hf_csv_get_value stay valid until cache_rows other rows are read. Any other operation parses the whole file first, and fails if it is malformed.
+//returns a newly allocated HF_CSV struct on success, NULL if file does not exist, first row is malformed or cache_rows is 0.
+HF_CSV* hf_csv_create_from_file_lazy(const char* filename, size_t cache_rows);
+
+//Same as hf_csv_create_from_file_lazy, but every allocation of the csv goes through allocator. NULL uses the C library allocator.
+HF_CSV* hf_csv_create_from_file_lazy_with_allocator(const char* filename, size_t cache_rows, const HF_CSV_allocator* allocator);
+
+//Opens a file that other processes keep appending rows to. Only rows ending with a line break are loaded, a partial last row (even inside an unterminated quoted value) is left for hf_csv_refresh.
+//returns a newly allocated HF_CSV struct on success, NULL if file does not exist, holds no complete row yet or is malformed.
+HF_CSV* hf_csv_create_from_file_tail(const char* filename);
+
+//Same as hf_csv_create_from_file_tail, but every allocation of the csv, including the ones of hf_csv_refresh, goes through allocator. NULL uses the C library allocator.
+HF_CSV* hf_csv_create_from_file_tail_with_allocator(const char* filename, const HF_CSV_allocator* allocator);
+
+//Appends to a csv opened with hf_csv_create_from_file_tail the rows completed in its file since it was loaded or last refreshed. Only the new bytes are read and parsed, and rows are added in place.
+//If added_rows is not NULL, the amount of rows added is saved to it.
+//Returns true on success, even if no row was added. Returns false if csv was not opened with hf_csv_create_from_file_tail, the file was truncated, or new rows are malformed or have a different column count; nothing is added then.
+bool hf_csv_refresh(HF_CSV* csv, size_t* added_rows);
+
+//Same as hf_csv_create_from_file, but large files are split in chunks parsed concurrently by up to threads threads.
+//returns a newly allocated HF_CSV struct on success, NULL if file does not exist or failed to parse.
+HF_CSV* hf_csv_create_from_file_parallel(const char* filename, size_t threads);
+
+//Same as hf_csv_create_from_file_parallel, but every allocation of the csv and of the parse goes through allocator. NULL uses the C library allocator.
+//Chunks are parsed on several threads at once, so allocator must be thread safe: a pool from hf_csv_pool_create is not.
+HF_CSV* hf_csv_create_from_file_parallel_with_allocator(const char* filename, size_t threads, const HF_CSV_allocator* allocator);
+
 //Creates a csv struct from a formatted string. Such string MUST be null-terminated.
 //returns a newly allocated HF_CSV struct on success, or NULL if failed to parse.
 HF_CSV* hf_csv_create_from_string(const char* string);
 
+//Same as hf_csv_create_from_string, but every allocation of the csv goes through allocator. NULL uses the C library allocator.
+HF_CSV* hf_csv_create_from_string_with_allocator(const char* string, const HF_CSV_allocator* allocator);
+
+//Creates a csv struct from length bytes of a formatted string. Such string does not need to be null-terminated, and may contain null characters.
+//returns a newly allocated HF_CSV struct on success, or NULL if failed to parse.
+HF_CSV* hf_csv_create_from_string_n(const char* string, size_t length);
+
+//Same as hf_csv_create_from_string_n, but every allocation of the csv goes through allocator. NULL uses the C library allocator.
+HF_CSV* hf_csv_create_from_string_n_with_allocator(const char* string, size_t length, const HF_CSV_allocator* allocator);
+
+//Same as hf_csv_create_from_string, but only keeps the columns and rows selected by options. Values of other columns are skipped without being unescaped, allocated or validated.
+//returns a newly allocated HF_CSV struct on success, or NULL if failed to parse, a kept column does not exist or every row was dropped.
+HF_CSV* hf_csv_create_from_string_with_options(const char* string, const HF_CSV_load_options* options);
+
+//Same as hf_csv_create_from_string_with_options, for a file. With max_rows set, only the start of the file is read.
+HF_CSV* hf_csv_create_from_file_with_options(const char* filename, const HF_CSV_load_options* options);
+
+//Same as hf_csv_create_from_file_with_options, but the file is read in blocks by up to read_ahead threads while the rows of the blocks already read are parsed, so reading and parsing overlap. Rows spanning blocks, even inside quoted values, are handled.
+//Memory used besides the csv is bounded to read_ahead + 1 blocks plus the longest row. Options that depend on earlier rows (kept columns, predicate, diagnostics and recovery) and dialects without the SIMD parser load the whole file first instead.
+//returns a newly allocated HF_CSV struct on success, NULL if file does not exist, can't be read or failed to parse.
+HF_CSV* hf_csv_create_from_file_streamed(const char* filename, size_t read_ahead, const HF_CSV_load_options* options);
+
+//Infers the type and width of every column from the rows of csv starting at first_row (1 to skip a header). Load with max_rows to only sample the start of a file.
+//schema must hold as many entries as csv has columns.
+//Returns true on success, false if csv is invalid or first_row is out of bounds.
+bool hf_csv_infer_schema(HF_CSV* csv, size_t first_row, HF_CSV_column_schema* schema);
+
+//Same as hf_csv_create_from_string, but large strings are split in chunks parsed concurrently by up to threads threads.
+//returns a newly allocated HF_CSV struct on success, or NULL if failed to parse.
+HF_CSV* hf_csv_create_from_string_parallel(const char* string, size_t threads);
+
+//Same as hf_csv_create_from_string_parallel, but every allocation of the csv and of the parse goes through allocator, which must be thread safe. NULL uses the C library allocator.
+HF_CSV* hf_csv_create_from_string_parallel_with_allocator(const char* string, size_t threads, const HF_CSV_allocator* allocator);
+
 //Destroys a previously created HF_CSV struct, freeing allocated memory.
 void hf_csv_destroy(HF_CSV* csv);
 
-//Allocates a new string containing the csv contents. Memory allocated by this fuction is of respinsability of the user and should later be freed with hf_csv_free_string.
+//Allocates a new string containing the csv contents, using the allocator of csv. Memory allocated by this fuction is of respinsability of the user and should later be freed with hf_csv_free_string.
 //Returns a valid null-terminated char* on success, or NULL on failure.
 char* hf_csv_to_string(HF_CSV* csv);
 
-//Frees a string previously allocated bys hf_csv_to_string.
+//Same as hf_csv_to_string, but large csv structs are split in chunks of rows sized and written concurrently by up to threads threads. Output is the same.
+char* hf_csv_to_string_parallel(HF_CSV* csv, size_t threads);
+
+//Frees a string previously allocated bys hf_csv_to_string. The csv it was created from does not need to exist anymore.
 void hf_csv_free_string(char* string);
 
+//Creates a pool allocator tuned for many small values. Small blocks are carved from large slabs and recycled by size, bigger ones are tracked individually.
+//A pool is NOT thread safe, and must not be shared by csv structs used from different threads.
+//Returns a newly allocated HF_CSV_pool on success, NULL on failure.
+HF_CSV_pool* hf_csv_pool_create(void);
+
+//Returns an allocator taking its memory from pool, to be passed to the create functions.
+HF_CSV_allocator hf_csv_pool_allocator(HF_CSV_pool* pool);
+
+//Releases every block allocated from pool at once. csv structs and strings allocated from it must not be used afterwards, and need not be destroyed.
+void hf_csv_pool_destroy(HF_CSV_pool* pool);
+
 //Saves csv contents to a file.
 //Returns true if operation was successful.
 bool hf_csv_to_file(HF_CSV* csv, const char* filename);
 
+//Saves csv contents, along with its indexes, to a binary snapshot file. The file is written aside and then replaces filename, so a csv loaded from it may be saved over it.
+//Snapshots use the byte order of the machine, and can only be loaded by the same version of the library.
+//Returns true if operation was successful.
+bool hf_csv_save_snapshot(HF_CSV* csv, const char* filename);
+
+//Loads a snapshot saved by hf_csv_save_snapshot. The file is mapped and used in place: nothing is parsed nor allocated per value, so loading takes constant time and values are read from disk on first access.
+//Searches on columns or rows indexed when saved are answered from the mapped indexes. Any other operation than reading values and searching first copies cell storage (not values) to memory.
+//Only the header is checked on load. verify also checks the checksum of the whole file and the layout of every value, which reads all of it, and should be set for files that may be corrupted.
+//returns a newly allocated HF_CSV struct on success, NULL if file does not exist or is not a valid snapshot.
+HF_CSV* hf_csv_load_snapshot(const char* filename, bool verify);
+
+//Same as hf_csv_load_snapshot, but every allocation of the csv goes through allocator. NULL uses the C library allocator.
+HF_CSV* hf_csv_load_snapshot_with_allocator(const char* filename, bool verify, const HF_CSV_allocator* allocator);
+
+//Stores every value of column once, in a dictionary of its distinct values, with cells only keeping a code into it. Meant for columns with few distinct values.
+//hf_csv_find_row on the column then compares codes instead of strings, and values set later are added to the dictionary. Values are still read as usual.
+//Dictionary values are only freed when csv is destroyed, even if no cell holds them anymore.
+//Returns true on success, also if column was already encoded. If distinct is not NULL, the amount of values in the dictionary is saved to it.
+bool hf_csv_encode_column(HF_CSV* csv, size_t column, size_t* distinct);
+
 //Search for row containing value in the specified column of csv. Value string MUST be null-terminated.
 //Returns true if value is found. If so, row index is saved to the provided row pointer.
 bool hf_csv_find_row(HF_CSV* csv, size_t column, const char* value, size_t* row);
 
+//Joins the rows of left with the rows of right holding the same value, at left_column and right_column respectively. Values are compared byte by byte, values never set are empty.
+//right is hashed on its column, then probed with every row of left, so the cost is linear in both tables. Rows come out in the order of left, and the matches of a row in the order of right.
+//If the dialect of a table has a header, its first row is not joined, and the result starts with the header of left followed by the one of right, if both have one.
+//Every value is copied to the result once: right rows matched many times, and left rows with many matches, share their copies. The result has the allocator and dialect of left.
+//Returns a newly allocated HF_CSV struct on success, NULL if a table is invalid, a column is out of bounds, allocation failed or the result would have no rows.
+HF_CSV* hf_csv_join(HF_CSV* left, size_t left_column, HF_CSV* right, size_t right_column, HF_CSV_join_kind kind);
+
+//Same as hf_csv_join, but left is split in chunks of rows probed and copied concurrently by up to threads threads. Result is the same.
+HF_CSV* hf_csv_join_parallel(HF_CSV* left, size_t left_column, HF_CSV* right, size_t right_column, HF_CSV_join_kind kind, size_t threads);
+
+//Orders the rows of csv by key_count keys, keeping rows with equal keys in their current order. Values never set are empty.
+//Only row pointers move. The prefix of the first key is computed once per row, so most comparisons never read values.
+//Returns true on success, false if csv is invalid, there are no keys, a key is invalid or allocation failed.
+bool hf_csv_sort(HF_CSV* csv, const HF_CSV_sort_key* keys, size_t key_count, unsigned flags);
+
+//Same as hf_csv_sort, but chunks of rows are sorted by up to threads threads, then merged pairwise in parallel. Result is the same.
+bool hf_csv_sort_parallel(HF_CSV* csv, const HF_CSV_sort_key* keys, size_t key_count, unsigned flags, size_t threads);
+
+//Groups the rows of csv holding the same values at the key_count columns of keys, in one hashed pass, and computes aggregate_count aggregates per group.
+//The result has one row per group, in order of first appearance, with the keys followed by the aggregates. Numbers are written with up to 17 significant digits and '.' as decimal point, whatever the locale.
+//If the dialect of csv has a header, its first row is not grouped, and the result starts with the names of the keys and aggregates, like "count" or "sum(price)". The result has the allocator and dialect of csv.
+//Returns a newly allocated HF_CSV struct on success, NULL if csv is invalid, there are neither keys nor aggregates, a column is out of bounds, allocation failed or the result would have no rows.
+HF_CSV* hf_csv_group_by(HF_CSV* csv, const size_t* keys, size_t key_count, const HF_CSV_aggregate* aggregates, size_t aggregate_count);
+
+//Selects the rows of csv where condition holds, setting bit (i % 64) of selection[i / 64] if row i is selected and clearing it otherwise. selection must hold (rows + 63) / 64 words.
+//Rows are evaluated a block at a time, one condition after another, and conditions only look at rows still undecided. Conditions on dictionary encoded columns are evaluated once per distinct value, and ranges compare the cached typed column.
+//If the dialect of csv has a header, its first row is never selected. If count is not NULL, the amount of selected rows is saved to it.
+//Returns true on success, false if csv or selection are invalid, a condition is invalid or has a column out of bounds, or allocation failed.
+bool hf_csv_filter(HF_CSV* csv, const HF_CSV_condition* condition, uint64_t* selection, size_t* count);
+
+//Same as hf_csv_filter, but blocks of rows are evaluated concurrently by up to threads threads. Result is the same.
+bool hf_csv_filter_parallel(HF_CSV* csv, const HF_CSV_condition* condition, uint64_t* selection, size_t* count, size_t threads);
+
+//Makes a table of the rows of csv selected in selection, laid out as by hf_csv_filter, preceded by the header if the dialect of csv has one.
+//Cells are not copied: the view shares them with csv, which must stay alive and unmodified while the view is used. Modifying the view first copies its values, after which it is independent.
+//Returns a newly allocated HF_CSV struct on success, NULL if csv or selection are invalid, allocation failed or no row would be selected and the dialect of csv has no header. When it has one, a view selecting no row holds just the header. It is freed with hf_csv_destroy.
+HF_CSV* hf_csv_view(HF_CSV* csv, const uint64_t* selection);
+
 //Search for column containing value in the specified row of csv. Value string MUST be null-terminated.
 //Returns true if value is found. If so, column index is saved to the provided column pointer.
 bool hf_csv_find_column(HF_CSV* csv, size_t row, const char* value, size_t* column);
 
+//Builds a hash index over the values of column, making hf_csv_find_row on that column O(1) on average. The index is kept up to date when csv is modified.
+//Returns true on success. If duplicates is not NULL, the amount of rows holding a value already found in a previous row is saved to it.
+bool hf_csv_build_index(HF_CSV* csv, size_t column, size_t* duplicates);
+
+//Same as hf_csv_build_index, but indexes the values of row (usually the header) for hf_csv_find_column.
+bool hf_csv_build_row_index(HF_CSV* csv, size_t row, size_t* duplicates);
+
 //Gets a value from csv at specified row and column.
 //This pointer may become invalid once the csv struct is modified in any way, and its contents should NOT be freed or modified directly.
-//Returns pointer to value if inside bounds of csv file, NULL otherwise.
+//Values read in place from a file mapping are copied and null-terminated the first time they are requested; the copy is published atomically, so several threads may
+//read csv at once with this function and hf_csv_get_value_n, unless it was opened with hf_csv_create_from_file_lazy.
+//Returns pointer to value if inside bounds of csv file, NULL if not or if allocation of the copy failed.
 const char* hf_csv_get_value(HF_CSV* csv, size_t row, size_t column);
 
+//Gets a value from csv at specified row and column, saving its length to the length pointer. Length is stored along with every value, so no scan is made.
+//Value may contain null characters and is NOT guaranteed to be null-terminated. Same lifetime rules as hf_csv_get_value apply.
+//Returns pointer to value if inside bounds of csv file, NULL otherwise.
+const char* hf_csv_get_value_n(HF_CSV* csv, size_t row, size_t column, size_t* length);
+
 //Sets a value at specified row and column. The value string MUST be null-terminated.
 bool hf_csv_set_value(HF_CSV* csv, size_t row, size_t column, const char* value);
 
+//Sets a value of length bytes at specified row and column. The value does not need to be null-terminated, and may contain null characters.
+bool hf_csv_set_value_n(HF_CSV* csv, size_t row, size_t column, const char* value, size_t length);
+
 //gets the num of rows and columns of a csv struct
 //Returns true if csv is valid, thus also making valid the values stored in the rows and columns pointers.
 bool hf_csv_get_size(HF_CSV* csv, size_t* rows, size_t* columns);
 
-//Resizes a csv struct. If size is smaller, values out of bounds will be discarded. If new size is bigger, new values will be empty.
+//Resizes a csv struct in place. If size is smaller, values out of bounds will be discarded. If new size is bigger, new values will be empty.
+//Remaining values are not copied, so pointers to them stay valid.
 //Returns true if operation was successful. Returns false if csv struct is invalid, size is maintained or any of the newly provided dimensions are 0.
 bool hf_csv_resize(HF_CSV* csv, size_t rows, size_t columns);
 
+//Adds an empty row after the last one. Storage is grown geometrically, so appending many rows takes amortized constant time.
+//Returns true if operation was successful.
+bool hf_csv_append_row(HF_CSV* csv);
+
+//Inserts an empty column before column, moving it and the following columns to the right. Passing the column count appends a column.
+//Returns true if operation was successful, false if csv is invalid or column is out of bounds.
+bool hf_csv_insert_column(HF_CSV* csv, size_t column);
+
+//Deletes count rows starting at row, moving the following rows up. Freed storage is reused by rows added later.
+//Returns true if operation was successful. Returns false if csv is invalid, count is 0, rows are out of bounds or no row would be left.
+bool hf_csv_delete_rows(HF_CSV* csv, size_t row, size_t count);
+
+//Converts the values of column from first_row on (1 to skip a header) to type. Numbers are converted 8 digits at a time.
+//Result is cached by csv, so later calls with the same arguments cost nothing, and stays valid until a value of the column is set, csv is resized or edited, or destroyed.
+//Returns a pointer to the typed column on success, NULL if csv is invalid, column or first_row are out of bounds, or allocation failed.
+const HF_CSV_column* hf_csv_get_column(HF_CSV* csv, size_t column, size_t first_row, HF_CSV_type type);
+
+//Same as hf_csv_get_column for count columns at once, converting columns[i] to types[i] and saving the result to columns_ptr[i].
+//Columns not cached yet are converted in a single pass over the rows.
+//Returns true if every column was converted.
+bool hf_csv_get_columns(HF_CSV* csv, const size_t* columns, const HF_CSV_type* types, size_t count, size_t first_row, const HF_CSV_column** columns_ptr);
+
+//Opens a file to be read one row at a time. Memory used by the reader only depends on the size of the largest row, not on the size of the file.
+//Returns a newly allocated HF_CSV_reader on success, NULL if file does not exist.
+HF_CSV_reader* hf_csv_reader_open(const char* filename);
+
+//Reads the next row of file. Values follow the same rules as hf_csv_create_from_file, and every row must have as many columns as the first one.
+//Values saved to values_ptr stay valid until the next call or until reader is closed, and should NOT be freed or modified directly.
+//Returns true if a row was read, false once there are no rows left or if file is malformed (see hf_csv_reader_error).
+bool hf_csv_reader_next_row(HF_CSV_reader* reader, const HF_CSV_value** values_ptr, size_t* columns_ptr);
+
+//Returns true if reader stopped because of malformed input or a failed read.
+bool hf_csv_reader_error(HF_CSV_reader* reader);
+
+//Closes reader and its file, freeing allocated memory.
+void hf_csv_reader_close(HF_CSV_reader* reader);
+
+//Creates a writer that saves rows to a file as they are written, without building the whole csv in memory.
+//Returns a newly allocated HF_CSV_writer on success, NULL if file can't be opened.
+HF_CSV_writer* hf_csv_writer_open(const char* filename);
+
+//Creates a writer that saves rows to an already open stream. The stream is flushed but NOT closed by hf_csv_writer_close.
+//Returns a newly allocated HF_CSV_writer on success, NULL if file is NULL.
+HF_CSV_writer* hf_csv_writer_open_stream(FILE* file);
+
+//Appends a row of count values. Values do not need to be null-terminated, a NULL value is written as empty.
+//Returns true if no write failed so far.
+bool hf_csv_writer_write_row(HF_CSV_writer* writer, const HF_CSV_value* values, size_t count);
+
+//Appends every row of csv.
+//Returns true if no write failed so far.
+bool hf_csv_writer_write_csv(HF_CSV_writer* writer, HF_CSV* csv);
+
+//Sets the dialect rows are written with, plain csv by default. Should be set before writing any row.
+//Returns true on success, false if writer is invalid or dialect is not valid.
+bool hf_csv_writer_set_dialect(HF_CSV_writer* writer, const HF_CSV_dialect* dialect);
+
+//Flushes pending rows and destroys writer, closing its file if it was opened by hf_csv_writer_open.
+//Returns true if every write was successful.
+bool hf_csv_writer_close(HF_CSV_writer* writer);
+
+//Wraps csv so that many threads can read it while others modify it. Readers acquire a version, which stays unchanged and valid
+//until released however the csv is modified meanwhile, and never block nor wait for writers. Writers copy the rows they change and
+//publish a new version, old ones are freed once the last reader holding them releases them. Writers are serialized by a mutex.
+//Up to max_readers versions can be held at the same time. csv is owned by the shared struct, and must not be used directly anymore.
+//Returns a newly allocated HF_CSV_shared on success, NULL on failure, in which case csv is left to the caller.
+HF_CSV_shared* hf_csv_shared_create(HF_CSV* csv, size_t max_readers);
+
+//Destroys shared and its csv. Every acquired version must have been released.
+void hf_csv_shared_destroy(HF_CSV_shared* shared);
+
+//Pins the latest version of shared, can be called from any thread. Lock-free, only retries while writers publish new versions.
+//Returns the version on success, NULL if shared is invalid or max_readers versions are already held.
+const HF_CSV_version* hf_csv_shared_acquire(HF_CSV_shared* shared);
+
+//Unpins version, which must not be used afterwards. Values read from it are freed once no reader holds them anymore.
+void hf_csv_shared_release(HF_CSV_shared* shared, const HF_CSV_version* version);
+
+//Same as hf_csv_get_size for a pinned version.
+bool hf_csv_version_get_size(const HF_CSV_version* version, size_t* rows, size_t* columns);
+
+//Same as hf_csv_get_value for a pinned version. Returned string is valid until version is released.
+const char* hf_csv_version_get_value(const HF_CSV_version* version, size_t row, size_t column);
+
+//Same as hf_csv_get_value_n for a pinned version. Returned string is valid until version is released.
+const char* hf_csv_version_get_value_n(const HF_CSV_version* version, size_t row, size_t column, size_t* length);
+
+//Same as hf_csv_set_value_n, publishing a new version. Only the changed row and its page of row pointers are copied.
+//Returns true on success, false on failure.
+bool hf_csv_shared_set_value_n(HF_CSV_shared* shared, size_t row, size_t column, const char* value, size_t length);
+
+//Same as hf_csv_set_value, publishing a new version.
+//Returns true on success, false on failure.
+bool hf_csv_shared_set_value(HF_CSV_shared* shared, size_t row, size_t column, const char* value);
+
+//Same as hf_csv_resize, publishing a new version. Changing the amount of columns copies every row.
+//Returns true on success, false on failure.
+bool hf_csv_shared_resize(HF_CSV_shared* shared, size_t rows, size_t columns);
+
+//Same as hf_csv_append_row, publishing a new version.
+//Returns true on success, false on failure.
+bool hf_csv_shared_append_row(HF_CSV_shared* shared);
+
 #ifdef __cplusplus
 }
 #endif
@@ -2,9 +2,51 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <stdint.h>
 
 #include "hf_csv.h"
 
+//allocator keeping the size of every block in front of it, to check the sizes reported by hf_csv
+static size_t live_bytes = 0;
+
+static void* counting_alloc(void* user, size_t size) {
+    (void)user;
+    size_t* block = (size_t*)malloc(sizeof(size_t) * 2 + size);
+    assert(block);
+    block[0] = size;
+    live_bytes += size;
+    return block + 2;
+}
+
+static void counting_free(void* user, void* block, size_t size) {
+    (void)user;
+    size_t* header = (size_t*)block - 2;
+    assert(header[0] == size);
+    live_bytes -= size;
+    free(header);
+}
+
+static void* counting_realloc(void* user, void* block, size_t old_size, size_t new_size) {
+    void* new_block = counting_alloc(user, new_size);
+    memcpy(new_block, block, old_size < new_size ? old_size : new_size);
+    counting_free(user, block, old_size);
+    return new_block;
+}
+
+//keeps rows whose first kept value has an even length
+static bool keep_even_values(void* user, size_t row, const HF_CSV_value* values, size_t count) {
+    (void)user;
+    (void)row;
+    return count > 0 && values[0].length % 2 == 0;
+}
+
+//keeps rows whose first value is an even number
+static bool keep_even_ids(void* user, size_t row, const HF_CSV_value* values, size_t count) {
+    (void)user;
+    (void)row;
+    return count > 0 && values[0].length > 0 && (values[0].value[values[0].length - 1] - '0') % 2 == 0;
+}
+
 int main(int argc, char* argv[]) {
     (void)argc;
     (void)argv;
@@ -105,5 +147,874 @@ int main(int argc, char* argv[]) {
         hf_csv_destroy(line_feed_csv);
     }
 
+    {//parallel parsing must match serial parsing
+        HF_CSV* serial = hf_csv_create_from_file("./res/loc.csv");
+        HF_CSV* parallel = hf_csv_create_from_file_parallel("./res/loc.csv", 4);
+        assert(serial && parallel);
+
+        char* serial_str = hf_csv_to_string(serial);
+        char* parallel_str = hf_csv_to_string(parallel);
+        assert(strcmp(serial_str, parallel_str) == 0);
+        hf_csv_free_string(serial_str);
+        hf_csv_free_string(parallel_str);
+
+        hf_csv_destroy(serial);
+        hf_csv_destroy(parallel);
+
+        HF_CSV* bad_column_count = hf_csv_create_from_file_parallel("./res/bad_column_count.csv", 4);
+        assert(!bad_column_count);
+        hf_csv_destroy(bad_column_count);
+    }
+
+    {//streaming reader
+        HF_CSV* loc = hf_csv_create_from_file("./res/loc.csv");
+        HF_CSV_reader* reader = hf_csv_reader_open("./res/loc.csv");
+        assert(loc && reader);
+
+        const HF_CSV_value* values;
+        size_t columns;
+        size_t row = 0;
+        while(hf_csv_reader_next_row(reader, &values, &columns)) {
+            for(size_t column = 0; column < columns; column++) {
+                assert(strcmp(values[column].value, hf_csv_get_value(loc, row, column)) == 0);
+            }
+            row++;
+        }
+        bool error = hf_csv_reader_error(reader);
+        assert(!error && row == 3);
+        hf_csv_reader_close(reader);
+        hf_csv_destroy(loc);
+
+        reader = hf_csv_reader_open("./res/bad_column_count.csv");
+        while(hf_csv_reader_next_row(reader, NULL, NULL)) {
+        }
+        error = hf_csv_reader_error(reader);
+        assert(error);
+        hf_csv_reader_close(reader);
+        (void)error;
+    }
+
+    {//streaming writer
+        HF_CSV_writer* writer = hf_csv_writer_open("./writer_result.csv");
+        assert(writer);
+
+        HF_CSV_value header[2] = { { "KEY", 3 }, { "VALUE", 5 } };
+        HF_CSV_value row[2] = { { "QUOTE", 5 }, { "say \"hi\", bye", 14 } };
+        bool ok = hf_csv_writer_write_row(writer, header, 2);
+        ok = hf_csv_writer_write_row(writer, row, 2) && ok;
+        ok = hf_csv_writer_close(writer) && ok;
+        assert(ok);
+
+        HF_CSV* written = hf_csv_create_from_file("./writer_result.csv");
+        assert(written);
+        assert(strcmp(hf_csv_get_value(written, 1, 1), "say \"hi\", bye") == 0);
+
+        //saving to file must produce the same contents as hf_csv_to_string
+        char* written_str = hf_csv_to_string(written);
+        ok = hf_csv_to_file(written, "./writer_result.csv");
+        assert(ok);
+        HF_CSV* saved = hf_csv_create_from_file("./writer_result.csv");
+        char* saved_str = hf_csv_to_string(saved);
+        assert(strcmp(written_str, saved_str) == 0);
+        hf_csv_free_string(written_str);
+        hf_csv_free_string(saved_str);
+
+        hf_csv_destroy(written);
+        hf_csv_destroy(saved);
+        (void)ok;
+    }
+
+    {//hash indexes
+        HF_CSV* loc = hf_csv_create_from_file("./res/loc.csv");
+        size_t duplicates = 1;
+        bool ok = hf_csv_build_index(loc, 0, &duplicates);
+        assert(ok && duplicates == 0);
+        ok = hf_csv_build_row_index(loc, 0, &duplicates);
+        assert(ok && duplicates == 0);
+
+        size_t row = 0;
+        ok = hf_csv_find_row(loc, 0, "MULTI_LINE", &row);
+        assert(ok && row == 2);
+        size_t column = 0;
+        ok = hf_csv_find_column(loc, 0, "PT", &column);
+        assert(ok && column == 2);
+        ok = hf_csv_find_row(loc, 0, "MISSING", &row);
+        assert(!ok);
+
+        //index follows modifications
+        hf_csv_set_value(loc, 1, 0, "MULTI_LINE");
+        ok = hf_csv_find_row(loc, 0, "MULTI_LINE", &row);
+        assert(ok && row == 1);
+        ok = hf_csv_find_row(loc, 0, "HELLO_WORLD", &row);
+        assert(!ok);
+        ok = hf_csv_build_index(loc, 0, &duplicates);
+        assert(ok && duplicates == 1);
+
+        hf_csv_resize(loc, 4, 3);
+        hf_csv_set_value(loc, 3, 0, "NEW_KEY");
+        ok = hf_csv_find_row(loc, 0, "NEW_KEY", &row);
+        assert(ok && row == 3);
+        ok = hf_csv_find_row(loc, 0, "", &row);
+        assert(!ok);
+
+        hf_csv_destroy(loc);
+        (void)ok;
+    }
+
+    {//binary-safe values
+        const char binary_src[] = "a,b\0c\r\n\"d\0\"\"\",e";
+        HF_CSV* binary = hf_csv_create_from_string_n(binary_src, sizeof(binary_src) - 1);
+        assert(binary);
+
+        size_t length = 0;
+        const char* value = hf_csv_get_value_n(binary, 0, 1, &length);
+        assert(length == 3 && memcmp(value, "b\0c", 3) == 0);
+        value = hf_csv_get_value_n(binary, 1, 0, &length);
+        assert(length == 3 && memcmp(value, "d\0\"", 3) == 0);
+
+        bool ok = hf_csv_set_value_n(binary, 1, 1, "x\0y", 3);
+        ok = hf_csv_to_file(binary, "./binary_result.csv") && ok;
+        assert(ok);
+
+        HF_CSV* loaded = hf_csv_create_from_file("./binary_result.csv");
+        assert(loaded);
+        value = hf_csv_get_value_n(loaded, 1, 1, &length);
+        assert(length == 3 && memcmp(value, "x\0y", 3) == 0);
+        value = hf_csv_get_value_n(loaded, 0, 1, &length);
+        assert(length == 3 && memcmp(value, "b\0c", 3) == 0);
+
+        hf_csv_destroy(binary);
+        hf_csv_destroy(loaded);
+        (void)value;
+        (void)ok;
+    }
+
+    {//in place editing
+        HF_CSV* edit = hf_csv_create_from_string("a,b\nc,d\n");
+        assert(edit);
+        const char* kept = hf_csv_get_value(edit, 1, 1);
+
+        bool ok = hf_csv_resize(edit, 3, 4);
+        assert(ok && hf_csv_get_value(edit, 1, 1) == kept);
+        assert(strcmp(hf_csv_get_value(edit, 2, 3), "") == 0);
+
+        for(size_t i = 0; i < 100; i++) {
+            ok = hf_csv_append_row(edit) && ok;
+        }
+        ok = hf_csv_insert_column(edit, 0) && ok;
+        assert(ok);
+        assert(strcmp(hf_csv_get_value(edit, 0, 1), "a") == 0);
+        assert(strcmp(hf_csv_get_value(edit, 0, 0), "") == 0);
+
+        ok = hf_csv_delete_rows(edit, 0, 1);
+        assert(ok);
+        ok = hf_csv_delete_rows(edit, 0, 102);
+        assert(!ok);
+        size_t rows = 0, columns = 0;
+        ok = hf_csv_get_size(edit, &rows, &columns);
+        assert(ok && rows == 102 && columns == 5);
+        assert(strcmp(hf_csv_get_value(edit, 0, 2), "d") == 0);
+
+        hf_csv_destroy(edit);
+        (void)kept;
+        (void)ok;
+    }
+
+    {//custom allocators
+        HF_CSV_allocator counting = { counting_alloc, counting_realloc, counting_free, NULL };
+        HF_CSV* counted = hf_csv_create_from_string_with_allocator("a,b\n\"c\"\"\",d", &counting);
+        assert(counted);
+        bool ok = hf_csv_set_value(counted, 0, 0, "longer value");
+        ok = hf_csv_append_row(counted) && hf_csv_insert_column(counted, 1) && ok;
+        assert(ok);
+        char* string = hf_csv_to_string(counted);
+        hf_csv_destroy(counted);
+        assert(live_bytes > 0);
+        assert(strcmp(string, "longer value,,b\r\n\"c\"\"\",,d\r\n,,") == 0);
+        hf_csv_free_string(string);
+        assert(live_bytes == 0);
+
+        HF_CSV* loaded[5];//every loader takes an allocator
+        loaded[0] = hf_csv_create_from_file_lazy_with_allocator("./res/loc.csv", 2, &counting);
+        loaded[1] = hf_csv_create_from_file_tail_with_allocator("./res/loc.csv", &counting);
+        loaded[2] = hf_csv_create_from_file_parallel_with_allocator("./res/loc.csv", 2, &counting);
+        loaded[3] = hf_csv_create_from_string_parallel_with_allocator("a,b\nc,d", 2, &counting);
+        loaded[4] = hf_csv_create_from_string_n_with_allocator("a,b\nc,d", 7, &counting);
+        ok = hf_csv_save_snapshot(loaded[2], "./allocator_snapshot.bin");
+        assert(ok);
+        HF_CSV* snapshot = hf_csv_load_snapshot_with_allocator("./allocator_snapshot.bin", true, &counting);
+        assert(snapshot && strcmp(hf_csv_get_value(snapshot, 0, 0), hf_csv_get_value(loaded[0], 0, 0)) == 0);
+        hf_csv_destroy(snapshot);
+        for(size_t i = 0; i < 5; i++) {
+            assert(loaded[i] && live_bytes > 0);
+            hf_csv_destroy(loaded[i]);
+        }
+        assert(live_bytes == 0);
+        remove("./allocator_snapshot.bin");
+
+        HF_CSV_pool* pool = hf_csv_pool_create();
+        assert(pool);
+        HF_CSV_allocator pool_allocator = hf_csv_pool_allocator(pool);
+        HF_CSV* pooled = hf_csv_create_from_file_with_allocator("./res/loc.csv", &pool_allocator);
+        assert(pooled);
+        ok = hf_csv_set_value(pooled, 0, 0, "pooled");
+        assert(ok && strcmp(hf_csv_get_value(pooled, 0, 0), "pooled") == 0);
+        hf_csv_pool_destroy(pool);//releases pooled without destroying it
+        (void)ok;
+    }
+
+    {//typed columns
+        HF_CSV* typed = hf_csv_create_from_string("id,price,active,day\n1,2.5,true,1970-01-02\n-12345678901,1e3,0,2000-02-29\nx,,maybe,2001-02-29\n");
+        assert(typed);
+
+        size_t columns[4] = { 0, 1, 2, 3 };
+        HF_CSV_type types[4] = { HF_CSV_TYPE_INT64, HF_CSV_TYPE_DOUBLE, HF_CSV_TYPE_BOOL, HF_CSV_TYPE_DATE };
+        const HF_CSV_column* result[4];
+        bool ok = hf_csv_get_columns(typed, columns, types, 4, 1, result);
+        assert(ok);
+        assert(result[0]->rows == 3 && result[0]->null_count == 1 && result[0]->validity[0] == 3);
+        assert(((const int64_t*)result[0]->values)[1] == -12345678901LL);
+        assert(((const double*)result[1]->values)[0] == 2.5 && ((const double*)result[1]->values)[1] == 1000.0);
+        assert(((const bool*)result[2]->values)[0] && !((const bool*)result[2]->values)[1] && result[2]->validity[0] == 3);
+        assert(((const int32_t*)result[3]->values)[0] == 1 && ((const int32_t*)result[3]->values)[1] == 11016 && result[3]->null_count == 1);
+
+        const HF_CSV_column* prices = hf_csv_get_column(typed, 1, 1, HF_CSV_TYPE_DOUBLE);
+        assert(prices == result[1]);
+        ok = hf_csv_set_value(typed, 3, 1, "0.125");
+        assert(ok);
+        prices = hf_csv_get_column(typed, 1, 1, HF_CSV_TYPE_DOUBLE);
+        assert(prices && prices->null_count == 0 && ((const double*)prices->values)[2] == 0.125);
+        prices = hf_csv_get_column(typed, 4, 1, HF_CSV_TYPE_DOUBLE);
+        assert(!prices);
+        char digits[256] = "0.";//values too long to be exact are still read
+        memset(digits + 2, '5', 200);
+        ok = hf_csv_set_value(typed, 3, 1, digits);
+        assert(ok);
+        prices = hf_csv_get_column(typed, 1, 1, HF_CSV_TYPE_DOUBLE);
+        assert(prices && prices->null_count == 0 && ((const double*)prices->values)[2] == 5.0 / 9.0);
+
+        hf_csv_destroy(typed);
+        (void)prices;
+        (void)ok;
+    }
+
+    {//projection and schema inference
+        const char* names[2] = { "PT", "KEY" };
+        HF_CSV_load_options options;
+        memset(&options, 0, sizeof(options));
+        options.names = names;
+        options.column_count = 2;
+        HF_CSV* projected = hf_csv_create_from_file_with_options("./res/loc.csv", &options);
+        assert(projected);
+        size_t rows = 0, columns = 0;
+        bool ok = hf_csv_get_size(projected, &rows, &columns);
+        assert(ok && rows == 3 && columns == 2);
+        assert(strcmp(hf_csv_get_value(projected, 0, 0), "PT") == 0);
+        assert(strcmp(hf_csv_get_value(projected, 2, 0), "Multi\nLinha") == 0);
+        assert(strcmp(hf_csv_get_value(projected, 2, 1), "MULTI_LINE") == 0);
+        hf_csv_destroy(projected);
+
+        names[1] = "MISSING";
+        projected = hf_csv_create_from_file_with_options("./res/loc.csv", &options);
+        assert(!projected);
+
+        size_t indices[2] = { 2, 0 };
+        memset(&options, 0, sizeof(options));
+        options.columns = indices;
+        options.column_count = 2;
+        options.predicate = keep_even_values;
+        projected = hf_csv_create_from_string_with_options("a,b,c\n1,x,22\n3,y,4\n5,\"z\",6666\n", &options);
+        assert(projected);
+        ok = hf_csv_get_size(projected, &rows, &columns);
+        assert(ok && rows == 2 && columns == 2);
+        assert(strcmp(hf_csv_get_value(projected, 0, 0), "22") == 0 && strcmp(hf_csv_get_value(projected, 1, 1), "5") == 0);
+        hf_csv_destroy(projected);
+
+        options.predicate = NULL;
+        options.max_rows = 3;
+        HF_CSV* sample = hf_csv_create_from_string_with_options("id,price,day,name\n1,2.5,2020-01-01,\"a,b\"\n2,,2020-01-02,c\n3,x,y,z\n", &options);
+        assert(sample);
+        ok = hf_csv_get_size(sample, &rows, &columns);
+        assert(ok && rows == 3 && columns == 2);
+        hf_csv_destroy(sample);
+
+        sample = hf_csv_create_from_string("id,price,day,name\n1,2.5,2020-01-01,\"a,b\"\n2,,2020-01-02,c\n");
+        HF_CSV_column_schema schema[4];
+        ok = hf_csv_infer_schema(sample, 1, schema);
+        assert(ok);
+        assert(schema[0].type == HF_CSV_TYPE_INT64 && schema[0].max_width == 1);
+        assert(schema[1].type == HF_CSV_TYPE_DOUBLE && schema[1].null_count == 1);
+        assert(schema[2].type == HF_CSV_TYPE_DATE);
+        assert(schema[3].type == HF_CSV_TYPE_TEXT && schema[3].max_width == 3);
+        hf_csv_destroy(sample);
+        (void)ok;
+    }
+
+    {//lazy loading
+        HF_CSV* lazy = hf_csv_create_from_file_lazy("./res/loc.csv", 1);
+        assert(lazy);
+        size_t rows = 0, columns = 0;
+        bool ok = hf_csv_get_size(lazy, &rows, &columns);
+        assert(ok && rows == 3 && columns == 3);
+        assert(strcmp(hf_csv_get_value(lazy, 2, 2), "Multi\nLinha") == 0);
+        assert(strcmp(hf_csv_get_value(lazy, 1, 0), "HELLO_WORLD") == 0);
+        assert(strcmp(hf_csv_get_value(lazy, 2, 0), "MULTI_LINE") == 0);
+
+        size_t row = 0;
+        ok = hf_csv_find_row(lazy, 0, "HELLO_WORLD", &row);//parses every row
+        assert(ok && row == 1);
+        ok = hf_csv_set_value(lazy, 1, 0, "CHANGED");
+        assert(ok && strcmp(hf_csv_get_value(lazy, 1, 0), "CHANGED") == 0);
+        hf_csv_destroy(lazy);
+
+        lazy = hf_csv_create_from_file_lazy("./res/loc.csv", 1);
+        ok = hf_csv_append_row(lazy) && hf_csv_get_size(lazy, &rows, &columns);
+        assert(ok && rows == 4);
+        assert(strcmp(hf_csv_get_value(lazy, 2, 0), "MULTI_LINE") == 0 && strcmp(hf_csv_get_value(lazy, 3, 0), "") == 0);
+        hf_csv_destroy(lazy);
+
+        //rows after the first are only checked once read or parsed
+        lazy = hf_csv_create_from_file_lazy("./res/bad_column_count.csv", 8);
+        assert(lazy);
+        assert(strcmp(hf_csv_get_value(lazy, 1, 2), "c") == 0);
+        assert(!hf_csv_get_value(lazy, 2, 0));
+        char* string = hf_csv_to_string(lazy);
+        assert(!string);
+        hf_csv_free_string(string);
+        hf_csv_destroy(lazy);
+        (void)ok;
+    }
+
+    {//snapshots
+        HF_CSV* loc = hf_csv_create_from_file("./res/loc.csv");
+        assert(loc);
+        bool ok = hf_csv_build_index(loc, 0, NULL);
+        ok = hf_csv_set_value_n(loc, 0, 1, "E\0N", 3) && ok;
+        ok = hf_csv_save_snapshot(loc, "./loc_snapshot.bin") && ok;
+        assert(ok);
+        char* expected = hf_csv_to_string(loc);
+        hf_csv_destroy(loc);
+
+        HF_CSV* snapshot = hf_csv_load_snapshot("./loc_snapshot.bin", true);
+        assert(snapshot);
+        size_t rows = 0, columns = 0, length = 0;
+        ok = hf_csv_get_size(snapshot, &rows, &columns);
+        assert(ok && rows == 3 && columns == 3);
+        assert(strcmp(hf_csv_get_value(snapshot, 2, 2), "Multi\nLinha") == 0);
+        const char* value = hf_csv_get_value_n(snapshot, 0, 1, &length);
+        assert(memcmp(value, "E\0N", 3) == 0 && length == 3);
+        size_t row = 0;
+        ok = hf_csv_find_row(snapshot, 0, "MULTI_LINE", &row);//answered by the saved index
+        assert(ok && row == 2);
+        ok = hf_csv_find_row(snapshot, 0, "MISSING", &row);
+        assert(!ok);
+        ok = hf_csv_find_row(snapshot, 1, "Hello World!", &row);
+        assert(ok && row == 1);
+
+        //editing copies cells, saved indexes keep following them
+        ok = hf_csv_set_value(snapshot, 1, 0, "CHANGED");
+        assert(ok);
+        ok = hf_csv_find_row(snapshot, 0, "CHANGED", &row);
+        assert(ok && row == 1);
+        ok = hf_csv_find_row(snapshot, 0, "HELLO_WORLD", &row);
+        assert(!ok);
+        ok = hf_csv_set_value(snapshot, 1, 0, "HELLO_WORLD");
+        assert(ok);
+        char* result = hf_csv_to_string(snapshot);
+        assert(result && strcmp(result, expected) == 0);
+        hf_csv_free_string(result);
+        hf_csv_free_string(expected);
+
+        ok = hf_csv_save_snapshot(snapshot, "./loc_snapshot.bin");//over its own mapping
+        assert(ok);
+        hf_csv_destroy(snapshot);
+        snapshot = hf_csv_load_snapshot("./loc_snapshot.bin", false);
+        assert(snapshot && strcmp(hf_csv_get_value(snapshot, 1, 0), "HELLO_WORLD") == 0);
+        hf_csv_destroy(snapshot);
+
+        snapshot = hf_csv_load_snapshot("./res/loc.csv", false);
+        assert(!snapshot);
+        snapshot = hf_csv_load_snapshot("./missing_snapshot.bin", false);
+        assert(!snapshot);
+        (void)value;
+        (void)ok;
+    }
+
+    {//growing files
+        FILE* log = fopen("./tail_result.csv", "wb");
+        assert(log);
+        fputs("id,message\r\n1,started\r\n2,\"half", log);
+        fflush(log);
+        HF_CSV* tail = hf_csv_create_from_file_tail("./tail_result.csv");
+        assert(tail);
+        size_t rows = 0, columns = 0, added = 0;
+        bool ok = hf_csv_get_size(tail, &rows, &columns);
+        assert(ok && rows == 2 && columns == 2);
+
+        fputs(" a\nline\"\r\n3,", log);//completes the quoted value, leaves another partial row
+        fflush(log);
+        ok = hf_csv_build_index(tail, 0, NULL);
+        assert(ok);
+        ok = hf_csv_refresh(tail, &added);
+        assert(ok && added == 1);
+        assert(strcmp(hf_csv_get_value(tail, 2, 1), "half a\nline") == 0);
+        ok = hf_csv_refresh(tail, &added);
+        assert(ok && added == 0);
+
+        fputs("done\r\n4,x,y\r\n", log);//column count of the last row does not match
+        fflush(log);
+        ok = hf_csv_refresh(tail, &added);
+        assert(!ok);
+        ok = hf_csv_get_size(tail, &rows, &columns);
+        assert(ok && rows == 3);
+        fclose(log);
+
+        size_t row = 0;
+        ok = hf_csv_find_row(tail, 0, "2", &row);
+        assert(ok && row == 2);
+        ok = hf_csv_refresh(NULL, NULL);
+        assert(!ok);
+        hf_csv_destroy(tail);
+
+        log = fopen("./tail_result.csv", "wb");
+        fputs("id,message\r\n1,started\r\n", log);
+        fclose(log);
+        tail = hf_csv_create_from_file_tail("./tail_result.csv");
+        log = fopen("./tail_result.csv", "ab");
+        fputs("2,next\r\n3,last\r\n", log);
+        fclose(log);
+        ok = hf_csv_refresh(tail, &added);
+        assert(ok && added == 2);
+        ok = hf_csv_find_row(tail, 1, "last", &row);
+        assert(ok && row == 3);
+        hf_csv_destroy(tail);
+        (void)ok;
+    }
+
+    {//parallel serialization
+        HF_CSV* big = hf_csv_create(40000, 3);
+        assert(big);
+        char value[96];
+        bool ok = true;
+        for(size_t row = 0; row < 40000; row++) {
+            snprintf(value, sizeof(value), "%zu", row);
+            ok = hf_csv_set_value(big, row, 0, value) && ok;
+            if(row % 3 == 0) {
+                snprintf(value, sizeof(value), "long value with \"quotes\", commas and\nnewlines past the first 64 bytes %zu", row);
+                ok = hf_csv_set_value(big, row, 1, value) && ok;
+            }
+            if(row % 7 == 0) {
+                ok = hf_csv_set_value(big, row, 2, "a\"b,c") && ok;
+            }
+        }
+        assert(ok);
+        char* serial = hf_csv_to_string(big);
+        char* parallel = hf_csv_to_string_parallel(big, 4);
+        assert(serial && parallel && strcmp(serial, parallel) == 0);
+        const char* expected = "0,\"long value with \"\"quotes\"\", commas and\nnewlines past the first 64 bytes 0\",\"a\"\"b,c\"\r\n1,,\r\n";
+        assert(strncmp(serial, expected, strlen(expected)) == 0);
+        hf_csv_free_string(serial);
+        hf_csv_free_string(parallel);
+        hf_csv_destroy(big);
+        (void)expected;
+        (void)ok;
+    }
+
+    {//dialects
+        HF_CSV_dialect tsv = hf_csv_dialect('\t');
+        HF_CSV_load_options options = {0};
+        options.dialect = &tsv;
+        HF_CSV* table = hf_csv_create_from_string_with_options("name\tcity\r\nAda\t\"London, UK\"\r\nLin\tOslo\r\n", &options);
+        assert(table);
+        size_t rows = 0, columns = 0;
+        bool ok = hf_csv_get_size(table, &rows, &columns);
+        assert(ok && rows == 3 && columns == 2);
+        assert(strcmp(hf_csv_get_value(table, 1, 1), "London, UK") == 0);
+
+        char* string = hf_csv_to_string(table);
+        assert(string && strcmp(string, "name\tcity\r\nAda\tLondon, UK\r\nLin\tOslo") == 0);
+        hf_csv_free_string(string);
+        HF_CSV_dialect semicolon = hf_csv_dialect(';');
+        ok = hf_csv_set_dialect(table, &semicolon);
+        assert(ok);
+        string = hf_csv_to_string(table);
+        assert(string && strcmp(string, "name;city\r\nAda;London, UK\r\nLin;Oslo") == 0);
+        hf_csv_free_string(string);
+        hf_csv_destroy(table);
+
+        HF_CSV_dialect custom = hf_csv_dialect('|');
+        custom.quote = '\'';
+        custom.escape = HF_CSV_ESCAPE_BACKSLASH;
+        custom.comment = '#';
+        custom.header = true;
+        custom.trim = true;
+        options.dialect = &custom;
+        options.predicate = keep_even_ids;
+        table = hf_csv_create_from_string_with_options("# exported rows\nid | note\n 1 | 'it\\'s | odd'\n# skipped\n2|  plain  \n4 | '  kept  '\n", &options);
+        assert(table);
+        ok = hf_csv_get_size(table, &rows, &columns);
+        assert(ok && rows == 3 && columns == 2);
+        assert(strcmp(hf_csv_get_value(table, 0, 1), "note") == 0);
+        assert(strcmp(hf_csv_get_value(table, 1, 1), "plain") == 0);
+        assert(strcmp(hf_csv_get_value(table, 2, 1), "  kept  ") == 0);
+
+        ok = hf_csv_set_value(table, 0, 0, "#id");
+        ok = hf_csv_set_value(table, 1, 1, "it's a\\b") && ok;
+        assert(ok);
+        string = hf_csv_to_string(table);
+        assert(string && strcmp(string, "'#id'|note\r\n2|'it\\'s a\\\\b'\r\n4|'  kept  '") == 0);
+        HF_CSV* parsed = hf_csv_create_from_string_with_options(string, &options);
+        assert(parsed && strcmp(hf_csv_get_value(parsed, 1, 1), "it's a\\b") == 0);
+        hf_csv_free_string(string);
+        hf_csv_destroy(parsed);
+
+        HF_CSV_dialect unquoted = hf_csv_dialect(',');
+        unquoted.quote = '\0';
+        ok = hf_csv_set_dialect(table, &unquoted);
+        assert(ok);
+        string = hf_csv_to_string(table);
+        assert(string && strcmp(string, "#id,note\r\n2,it's a\\b\r\n4,  kept  ") == 0);
+        hf_csv_free_string(string);
+        ok = hf_csv_set_value(table, 2, 1, "a,b");
+        assert(ok);
+        string = hf_csv_to_string(table);
+        assert(!string);//value holds the delimiter and can't be quoted
+        hf_csv_free_string(string);
+        ok = hf_csv_set_dialect(table, NULL);
+        assert(!ok);
+        custom.delimiter = '\'';
+        ok = hf_csv_set_dialect(table, &custom);
+        assert(!ok);
+        hf_csv_destroy(table);
+
+        HF_CSV_writer* writer = hf_csv_writer_open("./dialect_result.tsv");
+        assert(writer);
+        ok = hf_csv_writer_set_dialect(writer, &tsv);
+        HF_CSV_value values[] = { { "a\tb", 3 }, { "c", 1 } };
+        ok = hf_csv_writer_write_row(writer, values, 2) && ok;
+        ok = hf_csv_writer_close(writer) && ok;
+        assert(ok);
+        options.dialect = &tsv;
+        options.predicate = NULL;
+        table = hf_csv_create_from_file_with_options("./dialect_result.tsv", &options);
+        assert(table && strcmp(hf_csv_get_value(table, 0, 0), "a\tb") == 0);
+        hf_csv_destroy(table);
+        (void)ok;
+    }
+
+    {//concurrent reads
+        HF_CSV* table = hf_csv_create_from_string("key,text\r\nhello,Hello\r\nbye,Goodbye\r\n");
+        HF_CSV_shared* shared = hf_csv_shared_create(table, 2);
+        assert(shared);
+        const HF_CSV_version* before = hf_csv_shared_acquire(shared);
+        assert(before && strcmp(hf_csv_version_get_value(before, 1, 1), "Hello") == 0);
+
+        bool ok = hf_csv_shared_set_value(shared, 1, 1, "Hallo");
+        ok = hf_csv_shared_append_row(shared) && ok;
+        ok = hf_csv_shared_set_value(shared, 3, 0, "thanks") && ok;
+        assert(ok);
+        const HF_CSV_version* after = hf_csv_shared_acquire(shared);
+        const HF_CSV_version* third = hf_csv_shared_acquire(shared);
+        assert(after && !third);//both slots are held
+
+        //the first version is unchanged until released
+        size_t rows = 0, columns = 0, length = 0;
+        ok = hf_csv_version_get_size(before, &rows, &columns);
+        assert(ok && rows == 3 && columns == 2);
+        assert(strcmp(hf_csv_version_get_value(before, 1, 1), "Hello") == 0);
+        ok = hf_csv_version_get_size(after, &rows, &columns);
+        assert(ok && rows == 4 && columns == 2);
+        assert(strcmp(hf_csv_version_get_value(after, 1, 1), "Hallo") == 0);
+        const char* value = hf_csv_version_get_value_n(after, 3, 0, &length);
+        assert(strcmp(value, "thanks") == 0 && length == 6);
+        assert(strcmp(hf_csv_version_get_value(after, 3, 1), "") == 0);
+        assert(!hf_csv_version_get_value(after, 4, 0));
+        hf_csv_shared_release(shared, before);
+
+        ok = hf_csv_shared_resize(shared, 2, 3);
+        assert(ok);
+        ok = hf_csv_shared_set_value(shared, 2, 0, "gone");
+        assert(!ok);
+        assert(strcmp(hf_csv_version_get_value(after, 2, 1), "Goodbye") == 0);
+        hf_csv_shared_release(shared, after);
+        after = hf_csv_shared_acquire(shared);
+        ok = hf_csv_version_get_size(after, &rows, &columns);
+        assert(ok && rows == 2 && columns == 3);
+        assert(strcmp(hf_csv_version_get_value(after, 1, 1), "Hallo") == 0);
+        hf_csv_shared_release(shared, after);
+        hf_csv_shared_destroy(shared);
+        (void)third;
+        (void)value;
+        (void)ok;
+    }
+
+    {//parse diagnostics
+        HF_CSV_error errors[4];
+        HF_CSV_diagnostics diagnostics = { errors, 4, 0 };
+        HF_CSV_load_options options = {0};
+        options.diagnostics = &diagnostics;
+        HF_CSV* table = hf_csv_create_from_file_with_options("./res/bad_quote.csv", &options);
+        assert(!table);
+        assert(diagnostics.count == 1 && errors[0].kind == HF_CSV_ERROR_TEXT_AFTER_QUOTE);
+        assert(errors[0].offset == 32 && errors[0].line == 2 && errors[0].row == 1 && errors[0].column == 0);
+        table = hf_csv_create_from_file_with_options("./res/bad_column_count.csv", &options);
+        assert(!table);
+        assert(diagnostics.count == 1 && errors[0].kind == HF_CSV_ERROR_COLUMN_COUNT);
+        assert(errors[0].offset == 12 && errors[0].line == 3 && errors[0].row == 2 && errors[0].column == 2);
+        table = hf_csv_create_from_file_with_options("./res/missing.csv", &options);
+        assert(!table);
+        assert(diagnostics.count == 1 && errors[0].kind == HF_CSV_ERROR_IO);
+
+        //every error is found in one pass, lines count quoted newlines too
+        const char* feed = "id,text\n1,\"two\nlines\"\n2,x\"y\n3\n4,ok,extra\n5,\"open\n";
+        options.recovery = HF_CSV_RECOVERY_SKIP;
+        table = hf_csv_create_from_string_with_options(feed, &options);
+        assert(table);
+        size_t rows = 0, columns = 0;
+        bool ok = hf_csv_get_size(table, &rows, &columns);
+        assert(ok && rows == 2 && columns == 2);
+        assert(strcmp(hf_csv_get_value(table, 1, 1), "two\nlines") == 0);
+        hf_csv_destroy(table);
+        assert(diagnostics.count == 4);
+        assert(errors[0].kind == HF_CSV_ERROR_UNEXPECTED_QUOTE && errors[0].line == 4 && errors[0].row == 2 && errors[0].column == 1);
+        assert(errors[1].kind == HF_CSV_ERROR_COLUMN_COUNT && errors[1].line == 5 && errors[1].row == 3 && errors[1].column == 1);
+        assert(errors[2].kind == HF_CSV_ERROR_COLUMN_COUNT && errors[2].line == 6 && errors[2].column == 3);
+        assert(errors[3].kind == HF_CSV_ERROR_UNCLOSED_QUOTE && errors[3].line == 7 && errors[3].offset == strlen(feed) - 6);
+
+        options.recovery = HF_CSV_RECOVERY_PAD;
+        diagnostics.capacity = 1;
+        table = hf_csv_create_from_string_with_options(feed, &options);
+        assert(table && diagnostics.count == 4 && errors[0].kind == HF_CSV_ERROR_UNEXPECTED_QUOTE);
+        ok = hf_csv_get_size(table, &rows, &columns);
+        assert(ok && rows == 4 && columns == 2);
+        assert(strcmp(hf_csv_get_value(table, 2, 0), "3") == 0 && strcmp(hf_csv_get_value(table, 2, 1), "") == 0);
+        assert(strcmp(hf_csv_get_value(table, 3, 1), "ok") == 0);
+        hf_csv_destroy(table);
+
+        //the first row sets the amount of columns, so it can't be recovered
+        table = hf_csv_create_from_string_with_options("a,\"b\n1,2\n", &options);
+        assert(!table);
+        assert(diagnostics.count == 1 && errors[0].kind == HF_CSV_ERROR_UNCLOSED_QUOTE && errors[0].row == 0);
+        (void)feed;
+        (void)ok;
+    }
+
+    {//dictionary encoded columns
+        const size_t encoded[] = { 1 };
+        HF_CSV_load_options options = {0};
+        options.dictionary_columns = encoded;
+        options.dictionary_column_count = 1;
+        HF_CSV* table = hf_csv_create_from_string_with_options("id,country\n1,FR\n2,DE\n3,FR\n4,\n", &options);
+        assert(table);
+        assert(hf_csv_get_value(table, 1, 1) == hf_csv_get_value(table, 3, 1));//repeated values are stored once
+        size_t row = 0, distinct = 0;
+        bool ok = hf_csv_find_row(table, 1, "FR", &row);
+        assert(ok && row == 1);
+        ok = hf_csv_find_row(table, 1, "", &row);
+        assert(ok && row == 4);
+        ok = hf_csv_find_row(table, 1, "IT", &row);
+        assert(!ok);
+        ok = hf_csv_set_value(table, 2, 1, "FR") && hf_csv_set_value(table, 0, 1, "IT");
+        assert(ok);
+        ok = hf_csv_find_row(table, 1, "DE", &row);
+        assert(!ok);
+        ok = hf_csv_find_row(table, 1, "IT", &row);
+        assert(ok && row == 0);
+        ok = hf_csv_encode_column(table, 1, &distinct);
+        assert(ok && distinct == 5);
+
+        //dictionaries follow their column, new values are empty
+        ok = hf_csv_insert_column(table, 0) && hf_csv_append_row(table);
+        assert(ok);
+        assert(strcmp(hf_csv_get_value(table, 2, 2), "FR") == 0);
+        ok = hf_csv_find_row(table, 2, "", &row);
+        assert(ok && row == 4);
+        ok = hf_csv_encode_column(table, 0, &distinct);
+        assert(ok && distinct == 0);
+        ok = hf_csv_set_value(table, 3, 0, "x") && hf_csv_find_row(table, 0, "x", &row);
+        assert(ok && row == 3);
+        char* string = hf_csv_to_string(table);
+        assert(strcmp(string, ",id,IT\r\n,1,FR\r\n,2,FR\r\nx,3,FR\r\n,4,\r\n,,") == 0);
+        hf_csv_free_string(string);
+        hf_csv_destroy(table);
+
+        //only kept columns can be encoded
+        HF_CSV_error error;
+        HF_CSV_diagnostics diagnostics = { &error, 1, 0 };
+        const size_t kept[] = { 0 };
+        options.columns = kept;
+        options.column_count = 1;
+        options.diagnostics = &diagnostics;
+        table = hf_csv_create_from_string_with_options("a,b\n1,2\n", &options);
+        assert(!table);
+        assert(diagnostics.count == 1 && error.kind == HF_CSV_ERROR_INVALID_OPTIONS);
+        (void)ok;
+    }
+
+    {//joins
+        HF_CSV_dialect dialect = hf_csv_dialect(',');
+        dialect.header = true;
+        HF_CSV_load_options options = {0};
+        options.dialect = &dialect;
+        HF_CSV* orders = hf_csv_create_from_string_with_options("order,customer\n1,c2\n2,c9\n3,c1\n4,c2\n", &options);
+        HF_CSV* customers = hf_csv_create_from_string_with_options("id,name\nc1,Ann\nc2,Bob\nc2,Bobby\n", &options);
+        assert(orders && customers);
+
+        HF_CSV* joined = hf_csv_join(orders, 1, customers, 0, HF_CSV_JOIN_INNER);
+        char* string = hf_csv_to_string(joined);
+        assert(strcmp(string, "order,customer,id,name\r\n1,c2,c2,Bob\r\n1,c2,c2,Bobby\r\n3,c1,c1,Ann\r\n4,c2,c2,Bob\r\n4,c2,c2,Bobby") == 0);
+        assert(hf_csv_get_value(joined, 1, 0) == hf_csv_get_value(joined, 2, 0));//values are copied once
+        hf_csv_free_string(string);
+        hf_csv_destroy(joined);
+
+        joined = hf_csv_join_parallel(orders, 1, customers, 0, HF_CSV_JOIN_LEFT, 4);
+        size_t rows = 0, columns = 0;
+        bool ok = hf_csv_get_size(joined, &rows, &columns);
+        assert(ok && rows == 7 && columns == 4);
+        assert(strcmp(hf_csv_get_value(joined, 3, 0), "2") == 0 && strcmp(hf_csv_get_value(joined, 3, 3), "") == 0);
+        hf_csv_destroy(joined);
+
+        joined = hf_csv_join(orders, 1, customers, 0, HF_CSV_JOIN_SEMI);
+        ok = hf_csv_get_size(joined, &rows, &columns);
+        assert(ok && rows == 4 && columns == 2);
+        hf_csv_destroy(joined);
+        joined = hf_csv_join(orders, 1, customers, 0, HF_CSV_JOIN_ANTI);
+        ok = hf_csv_get_size(joined, &rows, &columns);
+        assert(ok && rows == 2 && columns == 2);
+        assert(strcmp(hf_csv_get_value(joined, 1, 1), "c9") == 0);
+        hf_csv_destroy(joined);
+        joined = hf_csv_join(orders, 2, customers, 0, HF_CSV_JOIN_INNER);
+        assert(!joined);
+        hf_csv_destroy(orders);
+        hf_csv_destroy(customers);
+        (void)ok;
+    }
+
+    {//sort and group by
+        HF_CSV* csv = hf_csv_create_from_string("file,size,kind\nfile10,2.5,a\nfile9,10,b\nFile2,x,a\nfile9,-1,a\n");
+        assert(csv);
+        HF_CSV_sort_key keys[] = { { 0, HF_CSV_COLLATION_NATURAL, false }, { 1, HF_CSV_COLLATION_NUMERIC, true } };
+        bool ok = hf_csv_sort(csv, keys, 2, HF_CSV_SORT_KEEP_HEADER);
+        assert(ok);
+        char* string = hf_csv_to_string(csv);
+        assert(strcmp(string, "file,size,kind\r\nFile2,x,a\r\nfile9,10,b\r\nfile9,-1,a\r\nfile10,2.5,a") == 0);
+        hf_csv_free_string(string);
+
+        keys[0].column = 1;//numbers first, ascending, then text
+        keys[0].collation = HF_CSV_COLLATION_NUMERIC;
+        ok = hf_csv_sort_parallel(csv, keys, 1, HF_CSV_SORT_KEEP_HEADER, 4);
+        assert(ok);
+        assert(strcmp(hf_csv_get_value(csv, 1, 1), "-1") == 0 && strcmp(hf_csv_get_value(csv, 4, 1), "x") == 0);
+        keys[0].column = 3;
+        ok = hf_csv_sort(csv, keys, 1, 0);
+        assert(!ok);
+
+        HF_CSV_dialect dialect = hf_csv_dialect(',');
+        dialect.header = true;
+        ok = hf_csv_set_dialect(csv, &dialect);
+        assert(ok);
+        const size_t group_keys[] = { 2 };
+        const HF_CSV_aggregate aggregates[] = { { HF_CSV_AGGREGATE_COUNT, 0 }, { HF_CSV_AGGREGATE_SUM, 1 }, { HF_CSV_AGGREGATE_MAX, 1 } };
+        HF_CSV* groups = hf_csv_group_by(csv, group_keys, 1, aggregates, 3);
+        string = hf_csv_to_string(groups);
+        assert(strcmp(string, "kind,count,sum(size),max(size)\r\na,3,1.5,2.5\r\nb,1,10,10") == 0);
+        hf_csv_free_string(string);
+        hf_csv_destroy(groups);
+        hf_csv_destroy(csv);
+        (void)ok;
+    }
+
+    {//filters and views
+        HF_CSV_dialect dialect = hf_csv_dialect(',');
+        dialect.header = true;
+        HF_CSV_load_options options = {0};
+        options.dialect = &dialect;
+        HF_CSV* csv = hf_csv_create_from_string_with_options("city,price\nParis,10\nParma,25.5\nRome,7\nPisa,x\n", &options);
+        assert(csv);
+        HF_CSV_condition cheap[2] = { { HF_CSV_CONDITION_PREFIX, 0, "Pa", 0, 0, NULL, 0 }, { HF_CSV_CONDITION_RANGE, 1, NULL, 0, 20, NULL, 0 } };
+        HF_CSV_condition either[2] = { { HF_CSV_CONDITION_AND, 0, NULL, 0, 0, cheap, 2 }, { HF_CSV_CONDITION_CONTAINS, 0, "om", 0, 0, NULL, 0 } };
+        HF_CSV_condition condition = { HF_CSV_CONDITION_OR, 0, NULL, 0, 0, either, 2 };
+        uint64_t selection[1];
+        size_t count = 0;
+        bool ok = hf_csv_filter(csv, &condition, selection, &count);
+        assert(ok && count == 2 && selection[0] == 0x0A);
+
+        HF_CSV* view = hf_csv_view(csv, selection);
+        char* string = hf_csv_to_string(view);
+        assert(strcmp(string, "city,price\r\nParis,10\r\nRome,7") == 0);
+        hf_csv_free_string(string);
+        assert(hf_csv_get_value(view, 1, 0) == hf_csv_get_value(csv, 1, 0));//cells are shared
+        ok = hf_csv_set_value(view, 1, 0, "Lyon");//until the view is modified
+        assert(ok);
+        assert(strcmp(hf_csv_get_value(csv, 1, 0), "Paris") == 0 && strcmp(hf_csv_get_value(view, 2, 0), "Rome") == 0);
+        hf_csv_destroy(view);
+
+        HF_CSV_condition nested = { HF_CSV_CONDITION_AND, 0, NULL, 0, 0, cheap, 2 };//an and directly within an and
+        HF_CSV_condition none[2] = { nested, { HF_CSV_CONDITION_EQUALS, 0, "Parma", 0, 0, NULL, 0 } };
+        condition.kind = HF_CSV_CONDITION_AND;
+        condition.conditions = none;
+        ok = hf_csv_filter(csv, &condition, selection, &count);
+        assert(ok && count == 0 && selection[0] == 0);
+        view = hf_csv_view(csv, selection);//just the header
+        string = hf_csv_to_string(view);
+        assert(strcmp(string, "city,price") == 0);
+        hf_csv_free_string(string);
+        hf_csv_destroy(view);
+
+        ok = hf_csv_encode_column(csv, 0, NULL);
+        assert(ok);
+        HF_CSV_condition pisa = { HF_CSV_CONDITION_EQUALS, 0, "Pisa", 0, 0, NULL, 0 };
+        ok = hf_csv_filter_parallel(csv, &pisa, selection, &count, 4);
+        assert(ok && count == 1 && selection[0] == 0x10);
+        pisa.column = 2;
+        ok = hf_csv_filter(csv, &pisa, selection, NULL);
+        assert(!ok);
+        hf_csv_destroy(csv);
+        (void)ok;
+    }
+
+    {//streamed loading
+        FILE* file = fopen("./stream_result.csv", "wb");
+        assert(file);
+        for(int i = 0; i < 40000; i++) {
+            fprintf(file, "%d,\"quoted, with a\nline break\",%s\n", i, i % 3 ? "a" : "\"\"\"b\"\"\"");
+        }
+        fputs("40000,\"", file);//a value longer than a block
+        for(int i = 0; i < 300000; i++) {
+            fputs("ab\n\"\"", file);
+        }
+        fputs("\",c\n40001,last,row", file);
+        fclose(file);
+
+        HF_CSV* expected = hf_csv_create_from_file("./stream_result.csv");
+        HF_CSV* csv = hf_csv_create_from_file_streamed("./stream_result.csv", 3, NULL);
+        assert(expected && csv);
+        char* expected_string = hf_csv_to_string(expected);
+        char* string = hf_csv_to_string(csv);
+        assert(strcmp(string, expected_string) == 0);
+        hf_csv_free_string(string);
+        hf_csv_free_string(expected_string);
+        hf_csv_destroy(csv);
+        hf_csv_destroy(expected);
+
+        size_t encoded[] = { 2 };
+        HF_CSV_load_options options = {0};
+        options.max_rows = 40001;
+        options.dictionary_columns = encoded;
+        options.dictionary_column_count = 1;
+        csv = hf_csv_create_from_file_streamed("./stream_result.csv", 0, &options);
+        size_t rows, columns;
+        bool ok = hf_csv_get_size(csv, &rows, &columns);
+        assert(ok && rows == 40001 && columns == 3);
+        assert(strlen(hf_csv_get_value(csv, 40000, 1)) == 300000 * 4 && strcmp(hf_csv_get_value(csv, 40000, 2), "c") == 0);
+        size_t row;
+        ok = hf_csv_find_row(csv, 2, "\"b\"", &row);
+        assert(ok && row == 0);
+        hf_csv_destroy(csv);
+        csv = hf_csv_create_from_file_streamed("./missing_stream_result.csv", 2, NULL);
+        assert(!csv);
+        (void)ok;
+    }
+
     return 0;
 }